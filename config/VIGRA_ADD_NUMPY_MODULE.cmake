@@ -74,7 +74,7 @@ FUNCTION(VIGRA_ADD_NUMPY_MODULE target)
         # TARGET_LINK_LIBRARIES(${TARGET_NAME} ${VIGRANUMPY_LIBRARIES} vigranumpy_core)
     # endif()
     
-    TARGET_LINK_LIBRARIES(${TARGET_NAME} ${VIGRANUMPY_LIBRARIES})
+    TARGET_LINK_LIBRARIES(${TARGET_NAME} ${VIGRANUMPY_LIBRARIES} ${THREADING_LIBRARIES})
     
     IF(PYTHON_PLATFORM MATCHES "^windows$")
         SET_TARGET_PROPERTIES(${TARGET_NAME} PROPERTIES OUTPUT_NAME "${LIBRARY_NAME}" 
@@ -0,0 +1,34 @@
+# - configure the compiler for the multi-threading functions of VIGRA
+#
+# The parallel algorithms (see include/vigra/threadpool.hxx) are based on
+# the C++11 threading facilities. This module
+# * raises CMAKE_CXX_STANDARD to 11 when neither CMAKE_CXX_STANDARD, nor the
+#   compiler's default, nor a '-std=' option in CMAKE_CXX_FLAGS already selects
+#   C++11 or later (a newer standard is never downgraded),
+# * finds the system's thread library and stores it in THREADING_LIBRARIES,
+#   which must be linked into every target using parallel VIGRA functions.
+#
+
+IF(NOT CMAKE_CXX_FLAGS MATCHES "-std=")
+    IF(DEFINED CMAKE_CXX_STANDARD)
+        SET(VIGRA_CXX_STANDARD ${CMAKE_CXX_STANDARD})
+    ELSEIF(DEFINED CMAKE_CXX_STANDARD_COMPUTED_DEFAULT)
+        SET(VIGRA_CXX_STANDARD ${CMAKE_CXX_STANDARD_COMPUTED_DEFAULT})
+    ELSE()
+        SET(VIGRA_CXX_STANDARD 98)
+    ENDIF()
+
+    IF(VIGRA_CXX_STANDARD EQUAL 98 OR VIGRA_CXX_STANDARD LESS 11)
+        IF(CMAKE_VERSION VERSION_LESS 3.1)
+            MESSAGE(WARNING "CMake 3.1 or later is needed to select C++11, "
+                            "multi-threading may be unavailable.")
+        ELSE()
+            SET(CMAKE_CXX_STANDARD 11)
+            SET(CMAKE_CXX_STANDARD_REQUIRED ON)
+        ENDIF()
+    ENDIF()
+ENDIF()
+
+SET(CMAKE_THREAD_PREFER_PTHREAD TRUE)
+FIND_PACKAGE(Threads)
+SET(THREADING_LIBRARIES ${CMAKE_THREAD_LIBS_INIT})
@@ -52,8 +52,10 @@
 #include "multi_math.hxx"
 #include "eigensystem.hxx"
 #include "histogram.hxx"
+#include "threadpool.hxx"
 #include <algorithm>
 #include <iostream>
+#include <vector>
 
 namespace vigra {
   
@@ -261,6 +263,19 @@ Pixel coordinates are always at index 0.
 
     \endcode
 
+    Merging is also the basis of multi-threaded feature extraction: When extractFeatures() is called 
+    with an additional \ref ParallelOptions argument, each thread processes blocks of the data with its 
+    own copy of the accumulator chain, and the copies are merged at the end. Chains that cannot be merged 
+    or require more than one pass are processed sequentially:
+
+    \code
+    using namespace vigra::acc;
+    vigra::MultiArray<2, double> data(...);
+    AccumulatorChain<double, Select<Mean, Variance> > a;
+
+    extractFeatures(data.begin(), data.end(), a, ParallelOptions().numThreads(4));
+    \endcode
+
 
     \anchor histogram
     Four kinds of <b>histograms</b> are currently implemented:
@@ -657,6 +672,68 @@ struct CollectAccumulatorNames<void>
     {}
 };
 
+    // Does the '+=' operator of accumulator TAG work? This is not the case
+    // for generic Central<> and Principal<> statistics, because they would
+    // need the data of both regions. Modifiers inherit the property of the
+    // statistic they modify.
+template <class TAG>
+struct AccumulatorSupportsMerge
+{
+    static const bool value = true;
+};
+
+template <template <class> class MODIFIER, class TAG>
+struct AccumulatorSupportsMerge<MODIFIER<TAG> >
+: public AccumulatorSupportsMerge<TAG>
+{};
+
+template <class TAG>
+struct AccumulatorSupportsMerge<Central<TAG> >
+{
+    static const bool value = false;
+};
+
+template <unsigned N>
+struct AccumulatorSupportsMerge<Central<PowerSum<N> > >
+{
+    static const bool value = (N >= 2 && N <= 4);
+};
+
+template <class TAG>
+struct AccumulatorSupportsMerge<Principal<TAG> >
+{
+    static const bool value = false;
+};
+
+template <>
+struct AccumulatorSupportsMerge<Principal<PowerSum<2> > >
+{
+    static const bool value = true;
+};
+
+template <>
+struct AccumulatorSupportsMerge<Principal<CoordinateSystem> >
+{
+    static const bool value = true;
+};
+
+    // Do all accumulators in the TypeList support merging?
+template <class Accumulators>
+struct AccumulatorsSupportMerge;
+
+template <class HEAD, class TAIL>
+struct AccumulatorsSupportMerge<TypeList<HEAD, TAIL> >
+{
+    static const bool value = AccumulatorSupportsMerge<HEAD>::value &&
+                              AccumulatorsSupportMerge<TAIL>::value;
+};
+
+template <>
+struct AccumulatorsSupportMerge<void>
+{
+    static const bool value = true;
+};
+
 template <class T>
 struct ApplyVisitorToTag;
 
@@ -1785,7 +1862,21 @@ class AccumulatorChainImpl
             vigra_precondition(false, message);
        }
     }
-    
+
+    /** Prepare the first pass as the first call to update() with data like 't' does,
+        i.e. determine the shape of the results (and the number of regions) without adding 't'.
+        Copies of a chain prepared in this way can collect disjoint parts of the data and be
+        merged afterwards. Returns false and leaves the chain unchanged if it has already seen data.
+    */
+    bool beginFirstPass(T const & t)
+    {
+        if(current_pass_ != 0)
+            return false;
+        current_pass_ = 1;
+        next_.resize(detail::shapeOf(t));
+        return true;
+    }
+
     /** Equivalent to merge(o) .
     */
     void operator+=(AccumulatorChainImpl const & o)
@@ -2722,6 +2813,102 @@ void extractFeatures(ITERATOR start, ITERATOR end, ACCUMULATOR & a)
             a.updatePassN(*i, k);
 }
 
+namespace detail {
+
+    // chains containing statistics that can't be merged are processed sequentially
+template <bool MERGEABLE>
+struct ExtractFeaturesParallel
+{
+    template <class ITERATOR, class ACCUMULATOR>
+    static void exec(ITERATOR start, ITERATOR end, ACCUMULATOR & a, 
+                     ParallelOptions const &)
+    {
+        extractFeatures(start, end, a);
+    }
+};
+
+template <>
+struct ExtractFeaturesParallel<true>
+{
+    template <class ITERATOR, class ACCUMULATOR>
+    static void exec(ITERATOR start, ITERATOR end, ACCUMULATOR & a, 
+                     ParallelOptions const & options)
+    {
+        MultiArrayIndex size = end - start;
+        // initialize 'a' like the first call to update() does, so that
+        // all copies have the same shape and number of regions
+        if(options.getActualNumThreads() <= 1 || size < 2 || 
+           a.passesRequired() != 1 || !a.beginFirstPass(*start))
+        {
+            extractFeatures(start, end, a);
+            return;
+        }
+        
+        // Each block of the range is owned by its own chain, independently of the thread
+        // executing it, and the chains are merged in block order. This makes the result
+        // reproducible for a given number of threads.
+        ThreadPool pool(options);
+        MultiArrayIndex nBlocks = std::min<MultiArrayIndex>(size, std::max<MultiArrayIndex>(1, pool.numThreads()));
+        std::vector<ACCUMULATOR> chains(nBlocks, a);
+        parallel_foreach(pool, nBlocks,
+            [&](int, MultiArrayIndex k)
+            {
+                ITERATOR i    = start + k*size / nBlocks,
+                         iend = start + (k+1)*size / nBlocks;
+                for(; i < iend; ++i)
+                    chains[k].updatePassN(*i, 1);
+            });
+        for(unsigned int k=0; k<chains.size(); ++k)
+            a.merge(chains[k]);
+    }
+};
+
+} // namespace detail
+
+/** Multi-threaded variant of extractFeatures().\n
+
+The range <tt>[start, end)</tt> (which must be given by random access iterators) is split into 
+one block of consecutive elements per thread of a \ref ThreadPool. Each block 
+is collected in its own copy of the accumulator chain 'a', and these copies are finally 
+merged into 'a' by means of the '+=' operator in the order of the blocks.
+This is only possible under the following conditions, otherwise the function falls back to 
+sequential execution:
+- all selected statistics support merging (e.g. <tt>Principal&lt;PowerSum&lt;3&gt; &gt;</tt> doesn't);
+  this is decided at compile time from the statistics in the chain,
+- the statistics can be computed in a single pass through the data,
+- 'a' has not yet seen any data (copies of 'a' would otherwise count these data several times).
+
+Since every thread needs its own set of region accumulators, memory consumption of an 
+\ref AccumulatorChainArray grows proportionally to the number of threads. Results may 
+deviate from sequential execution within numerical tolerances, because floating point 
+sums are computed in a different order. They are, however, reproducible when the 
+number of threads stays the same.
+
+Example of use:
+\code
+    vigra::MultiArray<3, double> data(...);
+    vigra::MultiArray<3, int> labels(...);
+    typedef vigra::CoupledIteratorType<3, double, int>::type Iterator;
+    typedef Iterator::value_type Handle;
+
+    AccumulatorChainArray<Handle,
+        Select<DataArg<1>, LabelArg<2>, Mean, Variance, RegionCenter> > a;
+
+    Iterator start = createCoupledIterator(data, labels);
+    Iterator end = start.getEndIterator();
+
+    extractFeatures(start, end, a, ParallelOptions().numThreads(8));
+\endcode
+*/
+template <class ITERATOR, class ACCUMULATOR>
+void extractFeatures(ITERATOR start, ITERATOR end, ACCUMULATOR & a, 
+                     ParallelOptions const & options)
+{
+    static const bool mergeable = 
+        detail::AccumulatorsSupportMerge<typename ACCUMULATOR::AccumulatorTags>::value;
+    detail::ExtractFeaturesParallel<mergeable>::exec(start, end, a, options);
+}
+
 /****************************************************************************/
 /*                                                                          */
 /*                          AccumulatorResultTraits                         */
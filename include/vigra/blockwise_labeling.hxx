@@ -0,0 +1,455 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2014 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_BLOCKWISE_LABELING_HXX
+#define VIGRA_BLOCKWISE_LABELING_HXX
+
+#include <functional>
+#include <string>
+
+#include "multi_array.hxx"
+#include "multi_array_chunked.hxx"
+#include "labelvolume.hxx"
+#include "union_find.hxx"
+#include "threadpool.hxx"
+
+namespace vigra {
+
+namespace detail {
+
+// Access to blocks of MultiArrayViews (in place) 
+// and ChunkedArrays (via a buffer)
+template <class T, class S, class U>
+inline MultiArrayView<3, T, StridedArrayTag>
+blockwiseCheckout(MultiArrayView<3, T, S> const & array,
+                  MultiArrayShape<3>::type const & start, MultiArrayShape<3>::type const & stop,
+                  MultiArray<3, U> &)
+{
+    return array.subarray(start, stop);
+}
+
+template <class T, class U>
+inline MultiArrayView<3, U, StridedArrayTag>
+blockwiseCheckout(ChunkedArray<3, T> const & array,
+                  MultiArrayShape<3>::type const & start, MultiArrayShape<3>::type const & stop,
+                  MultiArray<3, U> & buffer)
+{
+    buffer.reshape(stop - start);
+    array.checkoutSubarray(start, buffer);
+    return buffer;
+}
+
+template <class T, class S, class U>
+inline void
+blockwiseCommit(MultiArrayView<3, T, S> array, MultiArrayShape<3>::type const & start,
+                MultiArrayView<3, U, StridedArrayTag> const & block)
+{
+    MultiArrayView<3, T, S> target = array.subarray(start, start + block.shape());
+    if(target.data() != block.data())
+        target = block;
+}
+
+template <class T, class U>
+inline void
+blockwiseCommit(ChunkedArray<3, T> & array, MultiArrayShape<3>::type const & start,
+                MultiArrayView<3, U, StridedArrayTag> const & block)
+{
+    array.commitSubarray(start, block);
+}
+
+inline MultiArrayShape<3>::type
+blockwiseBlockIndex(MultiArrayIndex b, MultiArrayShape<3>::type const & blocks)
+{
+    MultiArrayShape<3>::type res;
+    res[0] = b % blocks[0];
+    b /= blocks[0];
+    res[1] = b % blocks[1];
+    res[2] = b / blocks[1];
+    return res;
+}
+
+/* Generic driver for block-wise connected components. The graph whose 
+   components are computed is defined by the 'Nodes' policy:
+   
+     - Nodes::node_type: the per-voxel data needed to decide connectivity
+     - Nodes::halo: the number of additional source voxels around a region 
+       that are needed to compute the node data of this region
+     - nodes(srcWithHalo, begin, end, buffer): return the node data of the
+       region [begin, end) of 'srcWithHalo', possibly using 'buffer' as storage
+     - nodes.label(nodeView, labelView): label the components of a single 
+       block by consecutive integers starting at 1 and return the count
+     - nodes.connected(a, b, direction): whether neighboring voxels with node
+       data 'a' and 'b', where 'b' lies in the given neighborhood direction of
+       'a', belong to the same component
+*/
+template <class SrcValue, class LabelValue,
+          class SrcArray, class DestArray,
+          class Neighborhood3D, class Nodes>
+unsigned int
+blockwiseLabelingImpl(SrcArray const & src, DestArray & dest,
+                      MultiArrayShape<3>::type blockShape,
+                      Neighborhood3D, Nodes const & nodes,
+                      ParallelOptions const & options,
+                      std::string const & function)
+{
+    typedef MultiArrayShape<3>::type Shape;
+    typedef typename Nodes::node_type NodeValue;
+
+    Shape shape = src.shape();
+    vigra_precondition(shape == dest.shape(),
+        function + "(): shape mismatch between input and output.");
+    vigra_precondition(blockShape[0] > 0 && blockShape[1] > 0 && blockShape[2] > 0,
+        function + "(): block shape must be positive.");
+    if(prod(shape) == 0)
+        return 0;
+
+    blockShape = min(blockShape, shape);
+    Shape blocks = (shape - Shape(1)) / blockShape + Shape(1),
+          blockStrides = detail::defaultStride<3>(blocks),
+          halo((MultiArrayIndex)Nodes::halo);
+    MultiArrayIndex blockCount = prod(blocks);
+    ThreadPool pool(options);
+
+    // pass 1: label all blocks independently, block b gets the labels 
+    // 1 ... offsets[b+1]-offsets[b], which are made globally unique 
+    // by adding offsets[b] after the prefix sum below
+    ArrayVector<MultiArrayIndex> offsets(blockCount + 1, 0);
+    parallel_foreach(pool, blockCount,
+        [&](int, MultiArrayIndex b)
+        {
+            Shape start = blockwiseBlockIndex(b, blocks)*blockShape,
+                  stop  = min(start + blockShape, shape),
+                  srcStart = max(start - halo, Shape()),
+                  srcStop  = min(stop + halo, shape);
+            MultiArray<3, SrcValue>   srcBuffer;
+            MultiArray<3, NodeValue>  nodeBuffer;
+            MultiArray<3, LabelValue> labelBuffer;
+            MultiArrayView<3, SrcValue, StridedArrayTag>   
+                srcBlock = blockwiseCheckout(src, srcStart, srcStop, srcBuffer);
+            MultiArrayView<3, NodeValue, StridedArrayTag>   
+                nodeBlock = nodes(srcBlock, start - srcStart, stop - srcStart, nodeBuffer);
+            MultiArrayView<3, LabelValue, StridedArrayTag> 
+                labelBlock = blockwiseCheckout(dest, start, stop, labelBuffer);
+            offsets[b+1] = nodes.label(nodeBlock, labelBlock);
+            blockwiseCommit(dest, start, labelBlock);
+        });
+    for(MultiArrayIndex b = 0; b < blockCount; ++b)
+        offsets[b+1] += offsets[b];
+
+    // pass 2: find equivalent labels across the block faces. A pair of neighboring
+    // voxels in different blocks straddles at least one face, so it suffices to 
+    // check the neighbors of each block's last slice along each axis which 
+    // lie in the next slice (including the diagonal neighbors in adjacent blocks).
+    // All tasks merge the equivalences into the same lock-free union-find array.
+    ArrayVector<int> forward[3];
+    for(int k = 0; k < (int)Neighborhood3D::DirectionCount; ++k)
+    {
+        Shape diff(Neighborhood3D::diff(k));
+        for(int d = 0; d < 3; ++d)
+            if(diff[d] == 1)
+                forward[d].push_back(k);
+    }
+
+    ConcurrentUnionFindArray<MultiArrayIndex> regions(offsets[blockCount] + 1);
+    parallel_foreach(pool, 3*blockCount,
+        [&](int, MultiArrayIndex task)
+        {
+            MultiArrayIndex b = task / 3;
+            int d = (int)(task % 3);
+            Shape blockIndex = blockwiseBlockIndex(b, blocks);
+            if(blockIndex[d] == blocks[d] - 1)
+                return;
+            Shape start = blockIndex*blockShape,
+                  stop  = min(start + blockShape, shape);
+
+            // the block's last slice and the next slice, enlarged 
+            // by one voxel along the other axes
+            Shape slabStart = max(start - Shape(1), Shape()),
+                  slabStop  = min(stop + Shape(1), shape);
+            slabStart[d] = stop[d] - 1;
+            slabStop[d]  = stop[d] + 1;
+            Shape srcStart = max(slabStart - halo, Shape()),
+                  srcStop  = min(slabStop + halo, shape);
+            MultiArray<3, SrcValue>   srcBuffer;
+            MultiArray<3, NodeValue>  nodeBuffer;
+            MultiArray<3, LabelValue> labelBuffer;
+            MultiArrayView<3, SrcValue, StridedArrayTag>   
+                srcSlab = blockwiseCheckout(src, srcStart, srcStop, srcBuffer);
+            MultiArrayView<3, NodeValue, StridedArrayTag>   
+                nodeSlab = nodes(srcSlab, slabStart - srcStart, slabStop - srcStart, nodeBuffer);
+            MultiArrayView<3, LabelValue, StridedArrayTag> 
+                labelSlab = blockwiseCheckout(dest, slabStart, slabStop, labelBuffer);
+
+            Shape slabShape = slabStop - slabStart,
+                  begin = start - slabStart,
+                  end   = stop - slabStart;
+            begin[d] = 0;
+            end[d]   = 1;
+            Shape p;
+            for(p[2] = begin[2]; p[2] < end[2]; ++p[2])
+            {
+                for(p[1] = begin[1]; p[1] < end[1]; ++p[1])
+                {
+                    for(p[0] = begin[0]; p[0] < end[0]; ++p[0])
+                    {
+                        MultiArrayIndex label = offsets[b] + labelSlab[p];
+                        for(unsigned int k = 0; k < forward[d].size(); ++k)
+                        {
+                            Shape q = p + Shape(Neighborhood3D::diff(forward[d][k]));
+                            if(q[0] < 0 || q[0] >= slabShape[0] ||
+                               q[1] < 0 || q[1] >= slabShape[1] ||
+                               q[2] < 0 || q[2] >= slabShape[2] ||
+                               !nodes.connected(nodeSlab[p], nodeSlab[q], forward[d][k]))
+                                continue;
+                            MultiArrayIndex neighborBlock = 
+                                dot((slabStart + q) / blockShape, blockStrides);
+                            regions.makeUnion(label, offsets[neighborBlock] + labelSlab[q]);
+                        }
+                    }
+                }
+            }
+        });
+
+    unsigned int count = (unsigned int)regions.makeContiguous();
+
+    // pass 3: replace the block labels with the final, consecutive labels
+    parallel_foreach(pool, blockCount,
+        [&](int, MultiArrayIndex b)
+        {
+            Shape start = blockwiseBlockIndex(b, blocks)*blockShape,
+                  stop  = min(start + blockShape, shape);
+            MultiArray<3, LabelValue> labelBuffer;
+            MultiArrayView<3, LabelValue, StridedArrayTag> 
+                labelBlock = blockwiseCheckout(dest, start, stop, labelBuffer);
+            typename MultiArrayView<3, LabelValue, StridedArrayTag>::iterator 
+                i = labelBlock.begin(), end = labelBlock.end();
+            for(; i != end; ++i)
+                *i = static_cast<LabelValue>(regions[offsets[b] + *i]);
+            blockwiseCommit(dest, start, labelBlock);
+        });
+    return count;
+}
+
+// node policy for labelVolumeBlockwise(): neighbors are connected when their values are equal
+template <class T, class Neighborhood3D, class EqualityFunctor>
+struct BlockwiseLabelingNodes
+{
+    typedef T node_type;
+    enum { halo = 0 };
+
+    EqualityFunctor equal_;
+
+    BlockwiseLabelingNodes(EqualityFunctor const & equal)
+    : equal_(equal)
+    {}
+
+    MultiArrayView<3, T, StridedArrayTag>
+    operator()(MultiArrayView<3, T, StridedArrayTag> const & src,
+               MultiArrayShape<3>::type const & begin, MultiArrayShape<3>::type const & end,
+               MultiArray<3, T> &) const
+    {
+        return src.subarray(begin, end);
+    }
+
+    template <class Label>
+    unsigned int
+    label(MultiArrayView<3, T, StridedArrayTag> const & src,
+          MultiArrayView<3, Label, StridedArrayTag> labels) const
+    {
+        return labelVolume(srcMultiArrayRange(src), destMultiArray(labels),
+                           Neighborhood3D(), equal_);
+    }
+
+    bool connected(T const & a, T const & b, int) const
+    {
+        return equal_(a, b);
+    }
+};
+
+template <class SrcValue, class LabelValue,
+          class SrcArray, class DestArray,
+          class Neighborhood3D, class EqualityFunctor>
+inline unsigned int
+labelVolumeBlockwiseImpl(SrcArray const & src, DestArray & dest,
+                         MultiArrayShape<3>::type const & blockShape,
+                         Neighborhood3D neighborhood, EqualityFunctor equal,
+                         ParallelOptions const & options)
+{
+    return blockwiseLabelingImpl<SrcValue, LabelValue>(src, dest, blockShape, neighborhood,
+                   BlockwiseLabelingNodes<SrcValue, Neighborhood3D, EqualityFunctor>(equal),
+                   options, "labelVolumeBlockwise");
+}
+
+} // namespace detail
+
+/** \addtogroup Labeling
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*                 labelVolumeBlockwise                 */
+/*                                                      */
+/********************************************************/
+
+/** \brief Find the connected components of a segmented volume block by block and in parallel.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+
+        template <class T1, class S1, class T2, class S2,
+                  class Neighborhood3D, class EqualityFunctor>
+        unsigned int labelVolumeBlockwise(MultiArrayView<3, T1, S1> const & src,
+                                          MultiArrayView<3, T2, S2> dest,
+                                          Neighborhood3D neighborhood, EqualityFunctor equal,
+                                          MultiArrayShape<3>::type const & blockShape = MultiArrayShape<3>::type(64),
+                                          ParallelOptions const & options = ParallelOptions());
+
+        template <class T1, class S1, class T2, class S2, class Neighborhood3D>
+        unsigned int labelVolumeBlockwise(MultiArrayView<3, T1, S1> const & src,
+                                          MultiArrayView<3, T2, S2> dest,
+                                          Neighborhood3D neighborhood,
+                                          MultiArrayShape<3>::type const & blockShape = MultiArrayShape<3>::type(64),
+                                          ParallelOptions const & options = ParallelOptions());
+
+        // chunked arrays, the blocks are the chunks of 'dest'
+        template <class T1, class T2, class Neighborhood3D, class EqualityFunctor>
+        unsigned int labelVolumeBlockwise(ChunkedArray<3, T1> const & src, ChunkedArray<3, T2> & dest,
+                                          Neighborhood3D neighborhood, EqualityFunctor equal,
+                                          ParallelOptions const & options = ParallelOptions());
+
+        template <class T1, class T2, class Neighborhood3D>
+        unsigned int labelVolumeBlockwise(ChunkedArray<3, T1> const & src, ChunkedArray<3, T2> & dest,
+                                          Neighborhood3D neighborhood,
+                                          ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    The result is the same partition as computed by \ref labelVolume(), but the 
+    computation is organized in three passes which only access one block 
+    at a time:
+
+    <ol>
+    <li> All blocks are labeled independently by labelVolume(), in parallel.
+    <li> For every pair of adjacent blocks, the two voxel slices along their common 
+         face are compared in order to find equivalent labels. The equivalences 
+         are merged in a global union-find structure.
+    <li> All blocks are relabeled with the final labels, in parallel.
+    </ol>
+
+    Since each pass only needs the current block or two boundary slices, the
+    function also works on \ref ChunkedArray "ChunkedArrays" that are too large
+    for the main memory. Region numbers form a consecutive sequence starting 
+    with one, but the numbering generally differs from the one computed by 
+    labelVolume() (regions are numbered in the order in which the blocks are 
+    visited). The destination's value type must be large enough to hold the 
+    label count of the largest block.
+
+    Return:  the number of regions found (= largest region label)
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_labeling.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8>  src(Shape3(w,h,d));
+    MultiArray<3, UInt32> dest(src.shape());
+    
+    // find 6-connected regions with 8 threads in blocks of 128^3 voxels
+    unsigned int max_region_label = 
+        labelVolumeBlockwise(src, dest, NeighborCode3DSix(), Shape3(128), 
+                             ParallelOptions().numThreads(8));
+
+    // the same for volumes that don't fit into the main memory
+    ChunkedArrayHDF5<3, UInt8>  chunked_src(file, "data", Shape3(64));
+    ChunkedArrayHDF5<3, UInt32> chunked_dest(file, "labels", chunked_src.shape(), Shape3(64));
+    max_region_label = labelVolumeBlockwise(chunked_src, chunked_dest, NeighborCode3DSix());
+    \endcode
+*/
+doxygen_overloaded_function(template <...> unsigned int labelVolumeBlockwise)
+
+template <class T1, class S1, class T2, class S2,
+          class Neighborhood3D, class EqualityFunctor>
+inline unsigned int
+labelVolumeBlockwise(MultiArrayView<3, T1, S1> const & src,
+                     MultiArrayView<3, T2, S2> dest,
+                     Neighborhood3D neighborhood, EqualityFunctor equal,
+                     MultiArrayShape<3>::type const & blockShape = MultiArrayShape<3>::type(64),
+                     ParallelOptions const & options = ParallelOptions())
+{
+    return detail::labelVolumeBlockwiseImpl<T1, T2>(src, dest, blockShape, 
+                                                    neighborhood, equal, options);
+}
+
+template <class T1, class S1, class T2, class S2, class Neighborhood3D>
+inline unsigned int
+labelVolumeBlockwise(MultiArrayView<3, T1, S1> const & src,
+                     MultiArrayView<3, T2, S2> dest,
+                     Neighborhood3D neighborhood,
+                     MultiArrayShape<3>::type const & blockShape = MultiArrayShape<3>::type(64),
+                     ParallelOptions const & options = ParallelOptions())
+{
+    return detail::labelVolumeBlockwiseImpl<T1, T2>(src, dest, blockShape, 
+                                                    neighborhood, std::equal_to<T1>(), options);
+}
+
+template <class T1, class T2, class Neighborhood3D, class EqualityFunctor>
+inline unsigned int
+labelVolumeBlockwise(ChunkedArray<3, T1> const & src, ChunkedArray<3, T2> & dest,
+                     Neighborhood3D neighborhood, EqualityFunctor equal,
+                     ParallelOptions const & options = ParallelOptions())
+{
+    return detail::labelVolumeBlockwiseImpl<T1, T2>(src, dest, dest.chunkShape(), 
+                                                    neighborhood, equal, options);
+}
+
+template <class T1, class T2, class Neighborhood3D>
+inline unsigned int
+labelVolumeBlockwise(ChunkedArray<3, T1> const & src, ChunkedArray<3, T2> & dest,
+                     Neighborhood3D neighborhood,
+                     ParallelOptions const & options = ParallelOptions())
+{
+    return detail::labelVolumeBlockwiseImpl<T1, T2>(src, dest, dest.chunkShape(), 
+                                                    neighborhood, std::equal_to<T1>(), options);
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_LABELING_HXX
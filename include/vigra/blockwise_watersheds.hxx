@@ -0,0 +1,207 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2014 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+#ifndef VIGRA_BLOCKWISE_WATERSHEDS_HXX
+#define VIGRA_BLOCKWISE_WATERSHEDS_HXX
+
+#include "blockwise_labeling.hxx"
+#include "watersheds3d.hxx"
+
+namespace vigra {
+
+namespace detail {
+
+// node policy for watersheds3DBlockwise(): the node data are the direction bits
+// of preparewatersheds3D(), and neighbors are connected when either one 
+// points to the other. Computing the bits requires a halo of one voxel.
+template <class T, class Neighborhood3D>
+struct BlockwiseWatershedNodes
+{
+    typedef int node_type;
+    enum { halo = 1 };
+
+    unsigned int opposite_[Neighborhood3D::DirectionCount];
+
+    BlockwiseWatershedNodes()
+    {
+        for(int k = 0; k < (int)Neighborhood3D::DirectionCount; ++k)
+            for(int j = 0; j < (int)Neighborhood3D::DirectionCount; ++j)
+                if(Neighborhood3D::diff(j) == -Neighborhood3D::diff(k))
+                    opposite_[k] = Neighborhood3D::directionBit((typename Neighborhood3D::Direction)j);
+    }
+
+    MultiArrayView<3, int, StridedArrayTag>
+    operator()(MultiArrayView<3, T, StridedArrayTag> const & src,
+               MultiArrayShape<3>::type const & begin, MultiArrayShape<3>::type const & end,
+               MultiArray<3, int> & buffer) const
+    {
+        // the bits are only correct where all neighbors are inside 'src'
+        // or outside the volume, i.e. in the region [begin, end)
+        buffer.reshape(src.shape());
+        preparewatersheds3D(src.traverser_begin(), src.shape(), 
+                            StandardConstValueAccessor<T>(),
+                            buffer.traverser_begin(), StandardValueAccessor<int>(),
+                            Neighborhood3D());
+        return buffer.subarray(begin, end);
+    }
+
+    template <class Label>
+    unsigned int
+    label(MultiArrayView<3, int, StridedArrayTag> const & bits,
+          MultiArrayView<3, Label, StridedArrayTag> labels) const
+    {
+        return watershedLabeling3D(bits.traverser_begin(), bits.shape(), 
+                                   StandardConstValueAccessor<int>(),
+                                   labels.traverser_begin(), StandardValueAccessor<Label>(),
+                                   Neighborhood3D());
+    }
+
+    bool connected(int a, int b, int direction) const
+    {
+        return (a & Neighborhood3D::directionBit((typename Neighborhood3D::Direction)direction)) != 0 ||
+               (b & opposite_[direction]) != 0;
+    }
+};
+
+} // namespace detail
+
+/** \addtogroup SeededRegionGrowing
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*                 watersheds3DBlockwise                */
+/*                                                      */
+/********************************************************/
+
+/** \brief Union-find watersheds of a volume, computed block by block and in parallel.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+
+        template <class T1, class S1, class T2, class S2, class Neighborhood3D>
+        unsigned int watersheds3DBlockwise(MultiArrayView<3, T1, S1> const & src,
+                                           MultiArrayView<3, T2, S2> dest,
+                                           Neighborhood3D neighborhood,
+                                           MultiArrayShape<3>::type const & blockShape = MultiArrayShape<3>::type(64),
+                                           ParallelOptions const & options = ParallelOptions());
+
+        // chunked arrays, the blocks are the chunks of 'dest'
+        template <class T1, class T2, class Neighborhood3D>
+        unsigned int watersheds3DBlockwise(ChunkedArray<3, T1> const & src, ChunkedArray<3, T2> & dest,
+                                           Neighborhood3D neighborhood,
+                                           ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    This function computes the same segmentation as \ref watersheds3D(), but 
+    divides the volume into blocks which are processed in parallel:
+
+    <ol>
+    <li> For each block, the direction of steepest descent of every voxel is 
+         computed from the block plus a halo of one voxel, so that it is the 
+         same as for the entire volume. The block is then labeled independently 
+         by following these directions.
+    <li> Regions touching the common face of two adjacent blocks are merged 
+         when a voxel on one side descends into a voxel on the other side. 
+         The equivalences are collected in a global lock-free union-find 
+         structure.
+    <li> All blocks are relabeled with the final labels, in parallel.
+    </ol>
+
+    Since the direction of each voxel only depends on its neighborhood, 
+    the resulting partition into regions is identical to the one of 
+    watersheds3D() (including the treatment of plateaus) and independent 
+    of the block shape and the number of threads. Region numbers form a
+    consecutive sequence starting with one. They are deterministic, but 
+    generally differ from the numbering of watersheds3D(). The destination's 
+    value type must be large enough to hold the label count of the largest block.
+    
+    Since each pass only needs the current block (or two boundary slices) 
+    plus a small halo, the function also works on \ref ChunkedArray "ChunkedArrays" 
+    that are too large for the main memory.
+
+    Return:  the number of regions found (= largest region label)
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_watersheds.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float>  boundaries(Shape3(w,h,d));
+    MultiArray<3, UInt32> labels(boundaries.shape());
+    
+    // 26-connected watersheds with 8 threads in blocks of 128^3 voxels
+    unsigned int max_region_label = 
+        watersheds3DBlockwise(boundaries, labels, NeighborCode3DTwentySix(), Shape3(128), 
+                              ParallelOptions().numThreads(8));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> unsigned int watersheds3DBlockwise)
+
+template <class T1, class S1, class T2, class S2, class Neighborhood3D>
+inline unsigned int
+watersheds3DBlockwise(MultiArrayView<3, T1, S1> const & src,
+                      MultiArrayView<3, T2, S2> dest,
+                      Neighborhood3D neighborhood,
+                      MultiArrayShape<3>::type const & blockShape = MultiArrayShape<3>::type(64),
+                      ParallelOptions const & options = ParallelOptions())
+{
+    return detail::blockwiseLabelingImpl<T1, T2>(src, dest, blockShape, neighborhood,
+                        detail::BlockwiseWatershedNodes<T1, Neighborhood3D>(),
+                        options, "watersheds3DBlockwise");
+}
+
+template <class T1, class T2, class Neighborhood3D>
+inline unsigned int
+watersheds3DBlockwise(ChunkedArray<3, T1> const & src, ChunkedArray<3, T2> & dest,
+                      Neighborhood3D neighborhood,
+                      ParallelOptions const & options = ParallelOptions())
+{
+    return detail::blockwiseLabelingImpl<T1, T2>(src, dest, dest.chunkShape(), neighborhood,
+                        detail::BlockwiseWatershedNodes<T1, Neighborhood3D>(),
+                        options, "watersheds3DBlockwise");
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_WATERSHEDS_HXX
@@ -47,6 +47,8 @@
 #ifndef VIGRA_CODEC_HXX
 #define VIGRA_CODEC_HXX
 
+#include <cstddef>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -171,6 +173,20 @@ namespace vigra
           return 0;
         }
 
+        // File positions of all images in a multi-image file (e.g. the directory
+        // offsets of a multi-page TIFF). Passing them to another decoder of the
+        // same file lets its setImageIndex() jump to any image without searching
+        // the file. Codecs without such positions return an empty vector and
+        // ignore setImageOffsets().
+        virtual std::vector<UInt64> getImageOffsets() const
+        {
+          return std::vector<UInt64>();
+        }
+
+        virtual void setImageOffsets(std::vector<UInt64> const &)
+        {
+        }
+
         virtual unsigned int getWidth() const = 0;
         virtual unsigned int getHeight() const = 0;
         virtual unsigned int getNumBands() const = 0;
@@ -203,6 +219,71 @@ namespace vigra
         virtual const void * currentScanlineOfBand( unsigned int ) const = 0;
         virtual void nextScanline() = 0;
 
+        // restrict decoding to the region of interest [upperLeft, upperLeft + size).
+        // This must be called before the first call to nextScanline(). Codecs that can
+        // skip the data outside the ROI return true, and their scanlines then refer to
+        // the ROI's rows and start at its left border. The default returns false, i.e.
+        // the caller must skip the unwanted data itself.
+        virtual bool setRegionOfInterest( const vigra::Diff2D & /*upperLeft*/,
+                                          const vigra::Size2D & /*size*/ )
+        {
+            return false;
+        }
+
+        // decode the next 'height' scanlines into a caller-provided buffer. Sample
+        // 'band' of pixel (x, y) is stored at byte offset
+        // x*pixelStride + y*rowStride + band*bandStride from 'dest', and the rows
+        // start at sample 'offset' of the codec's scanlines (i.e. at pixel
+        // offset / getOffset()). The samples are copied unchanged, so 'dest' must
+        // hold values of type getPixelType(). Rows are copied by a single memcpy()
+        // when the destination layout matches the codec's interleaved scanlines.
+        // Codecs may override this to decode directly into 'dest'. Afterwards,
+        // currentScanlineOfBand() is undefined until the next call to nextScanline().
+        virtual void readScanlines( void * dest, unsigned int width, unsigned int height,
+                                    unsigned int bands, std::ptrdiff_t pixelStride,
+                                    std::ptrdiff_t bandStride, std::ptrdiff_t rowStride,
+                                    unsigned int offset = 0 )
+        {
+            const std::string type = getPixelType();
+            const std::ptrdiff_t size = ( type == "UINT8" || type == "INT8" ) ? 1
+                                      : ( type == "UINT16" || type == "INT16" ) ? 2
+                                      : ( type == "DOUBLE" ) ? 8 : 4;
+            const std::ptrdiff_t step = getOffset() * size;
+
+            UInt8 * row = static_cast<UInt8 *>(dest);
+            std::vector<const UInt8 *> scanlines(bands);
+            for ( unsigned int y = 0; y < height; ++y, row += rowStride )
+            {
+                nextScanline();
+
+                bool interleaved = pixelStride == step && ( bands == 1 || bandStride == size );
+                for ( unsigned int b = 0; b < bands; ++b )
+                {
+                    scanlines[b] = static_cast<const UInt8 *>(currentScanlineOfBand(b)) + offset * size;
+                    interleaved = interleaved && scanlines[b] == scanlines[0] + b * size;
+                }
+
+                if ( interleaved && step == (std::ptrdiff_t)bands * size )
+                {
+                    std::memcpy( row, scanlines[0], width * step );
+                    continue;
+                }
+
+                for ( unsigned int b = 0; b < bands; ++b )
+                {
+                    const UInt8 * s = scanlines[b];
+                    UInt8 * d = row + b * bandStride;
+                    if ( pixelStride == size && step == size )
+                    {
+                        std::memcpy( d, s, width * size );
+                        continue;
+                    }
+                    for ( unsigned int x = 0; x < width; ++x, s += step, d += pixelStride )
+                        std::memcpy( d, s, size );
+                }
+            }
+        }
+
         typedef ArrayVector<unsigned char> ICCProfile;
 
         const ICCProfile & getICCProfile() const
@@ -250,6 +331,11 @@ namespace vigra
         {
         }
 
+        // request tiled storage (ignored by codecs that do not support tiles)
+        virtual void setTileSize( const vigra::Size2D & /*size*/ )
+        {
+        }
+
         typedef ArrayVector<unsigned char> ICCProfile;
 
         virtual void setICCProfile(const ICCProfile & /* data */)
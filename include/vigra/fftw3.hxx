@@ -649,6 +649,17 @@ struct MultiMathOperand<FFTWComplex<Real> >
         return v_;
     }
 
+    template <class SHAPE>
+    bool isContiguous(SHAPE const &) const
+    {
+        return true;
+    }
+    
+    FFTWComplex<Real> const & flat(MultiArrayIndex) const
+    {
+        return v_;
+    }
+
     void inc(unsigned int /*LEVEL*/) const
     {}
 
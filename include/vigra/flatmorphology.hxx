@@ -130,6 +130,7 @@ namespace vigra {
     radius >= 0
     \endcode
     
+    \see vigra::multiBoxRankOrderFilter() for a constant-time rank filter with box-shaped windows
 */
 doxygen_overloaded_function(template <...> void discRankOrderFilter)
 
@@ -75,9 +75,17 @@
 #include "multi_impex.hxx"
 #include "utilities.hxx"
 #include "error.hxx"
+#include "threadpool.hxx"
 
 #include <algorithm>
 
+// direct chunk I/O (H5Dwrite_chunk(), H5Dread_chunk()) is available since HDF5 1.10.3
+#if defined(H5_HAVE_FILTER_DEFLATE) && \
+    (H5_VERS_MAJOR > 1 || (H5_VERS_MAJOR == 1 && (H5_VERS_MINOR > 10 || \
+                          (H5_VERS_MINOR == 10 && H5_VERS_RELEASE >= 3))))
+# define VIGRA_HDF5_DIRECT_CHUNK_IO
+#endif
+
 namespace vigra {
 
 /** \addtogroup VigraHDF5Impex Import/Export of Images and Arrays in HDF5 Format
@@ -501,6 +509,14 @@ void HDF5_ls_insert(void*, const std::string &);
 VIGRA_EXPORT H5O_type_t HDF5_get_type(hid_t, const char*);
 extern "C" VIGRA_EXPORT herr_t HDF5_ls_inserter_callback(hid_t, const char*, const H5L_info_t*, void*);
 
+// zlib compression of a single chunk in the format of HDF5's deflate filter,
+// used for parallel compression in HDF5File::write() and HDF5File::read().
+// HDF5_deflate_chunk() resizes dest when necessary and returns the compressed size.
+VIGRA_EXPORT std::size_t HDF5_deflate_chunk(const char * src, std::size_t srcSize,
+                                            int level, ArrayVector<char> & dest);
+VIGRA_EXPORT void HDF5_inflate_chunk(const char * src, std::size_t srcSize,
+                                     char * dest, std::size_t destSize);
+
 /********************************************************/
 /*                                                      */
 /*                     HDF5File                         */
@@ -1113,6 +1129,34 @@ class HDF5File
         write_(datasetName, array, detail::getH5DataType<T>(), 1, chunkSize, compression);
     }
 
+        /** \brief Write multi arrays, compressing the chunks in parallel.
+
+            Like the previous function, but when <tt>chunkSize</tt> and <tt>compression</tt>
+            are both active, the chunks are deflate-compressed concurrently with the number
+            of threads given by <tt>options</tt> and then written to the file as they are
+            (direct chunk I/O), bypassing HDF5's serial filter pipeline. The dataset is
+            created with the standard deflate filter, so the file remains readable by any
+            HDF5 tool. Without chunks or compression, or if the HDF5 library is older than
+            1.10.3, this function behaves like the previous one.
+
+            \code
+            HDF5File file("probabilities.h5", HDF5File::New);
+            MultiArray<3, float> probs(Shape3(2000, 2000, 1000));
+            ...
+            file.write("probs", probs, Shape3(64, 64, 64), 5, ParallelOptions().numThreads(8));
+            \endcode
+        */
+    template<unsigned int N, class T>
+    inline void write(std::string datasetName, const MultiArrayView<N, T, UnstridedArrayTag> & array,
+                      typename MultiArrayShape<N>::type chunkSize, int compression,
+                      ParallelOptions const & options)
+    {
+        // make datasetName clean
+        datasetName = get_absolute_path(datasetName);
+
+        write_(datasetName, array, detail::getH5DataType<T>(), 1, chunkSize, compression, options);
+    }
+
         /** \brief Write a multi array into a larger volume.
             blockOffset determines the position, where array is written.
 
@@ -1164,6 +1208,17 @@ class HDF5File
         write_(datasetName, array, detail::getH5DataType<T>(), SIZE, chunkSize, compression);
     }
 
+    template<unsigned int N, class T, int SIZE>
+    inline void write(std::string datasetName, const MultiArrayView<N, TinyVector<T, SIZE>, UnstridedArrayTag> & array,
+                      typename MultiArrayShape<N>::type chunkSize, int compression,
+                      ParallelOptions const & options)
+    {
+        // make datasetName clean
+        datasetName = get_absolute_path(datasetName);
+
+        write_(datasetName, array, detail::getH5DataType<T>(), SIZE, chunkSize, compression, options);
+    }
+
         /** \brief Write array vectors.
           
             Compression can be activated by setting 
@@ -1217,6 +1272,17 @@ class HDF5File
         write_(datasetName, array, detail::getH5DataType<T>(), 3, chunkSize, compression);
     }
 
+    template<unsigned int N, class T>
+    inline void write(std::string datasetName, const MultiArrayView<N, RGBValue<T>, UnstridedArrayTag> & array,
+                      typename MultiArrayShape<N>::type chunkSize, int compression,
+                      ParallelOptions const & options)
+    {
+        // make datasetName clean
+        datasetName = get_absolute_path(datasetName);
+
+        write_(datasetName, array, detail::getH5DataType<T>(), 3, chunkSize, compression, options);
+    }
+
     template<unsigned int N, class T>
     inline void writeBlock(std::string datasetName, typename MultiArrayShape<N>::type blockOffset, const MultiArrayView<N, RGBValue<T>, UnstridedArrayTag> & array)
     {
@@ -1266,6 +1332,24 @@ class HDF5File
         read_(datasetName, array, detail::getH5DataType<T>(), 1);
     }
 
+        /** \brief Read data into a multi array, decompressing the chunks in parallel.
+
+            Like the previous function, but when the dataset is chunked and compressed
+            with the deflate filter only (as created by \ref write()), the compressed
+            chunks are read as they are (direct chunk I/O) and decompressed concurrently
+            with the number of threads given by <tt>options</tt>. Other datasets, or HDF5
+            libraries older than 1.10.3, fall back to the serial code path.
+        */
+    template<unsigned int N, class T>
+    inline void read(std::string datasetName, MultiArrayView<N, T, UnstridedArrayTag> & array,
+                     ParallelOptions const & options)
+    {
+        // make datasetName clean
+        datasetName = get_absolute_path(datasetName);
+
+        read_(datasetName, array, detail::getH5DataType<T>(), 1, options);
+    }
+
         /** \brief Read data into a MultiArray. Resize MultiArray to the correct size.
             If the first character of datasetName is a "/", the path will be interpreted as absolute path,
             otherwise it will be interpreted as path relative to the current group.
@@ -1371,6 +1455,16 @@ class HDF5File
         read_(datasetName, array, detail::getH5DataType<T>(), SIZE);
     }
 
+    template<unsigned int N, class T, int SIZE>
+    inline void read(std::string datasetName, MultiArrayView<N, TinyVector<T, SIZE>, UnstridedArrayTag> & array,
+                     ParallelOptions const & options)
+    {
+        // make datasetName clean
+        datasetName = get_absolute_path(datasetName);
+
+        read_(datasetName, array, detail::getH5DataType<T>(), SIZE, options);
+    }
+
     // non-scalar (TinyVector) MultiArray
     template<unsigned int N, class T, int SIZE>
     inline void readAndResize(std::string datasetName, MultiArray<N, TinyVector<T, SIZE> > & array)
@@ -1414,6 +1508,16 @@ class HDF5File
         read_(datasetName, array, detail::getH5DataType<T>(), 3);
     }
 
+    template<unsigned int N, class T>
+    inline void read(std::string datasetName, MultiArrayView<N, RGBValue<T>, UnstridedArrayTag> & array,
+                     ParallelOptions const & options)
+    {
+        // make datasetName clean
+        datasetName = get_absolute_path(datasetName);
+
+        read_(datasetName, array, detail::getH5DataType<T>(), 3, options);
+    }
+
     // non-scalar (RGBValue) MultiArray
     template<unsigned int N, class T>
     inline void readAndResize(std::string datasetName, MultiArray<N, RGBValue<T> > & array)
@@ -2005,7 +2109,8 @@ class HDF5File
                        const hid_t datatype, 
                        const int numBandsOfType, 
                        typename MultiArrayShape<N>::type &chunkSize, 
-                       int compressionParameter = 0)
+                       int compressionParameter = 0,
+                       ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
     {
         std::string groupname = SplitString(datasetName).first();
         std::string setname = SplitString(datasetName).last();
@@ -2055,6 +2160,15 @@ class HDF5File
         HDF5Handle datasetHandle(H5Dcreate(groupHandle, setname.c_str(), datatype, dataspace,H5P_DEFAULT, plist, H5P_DEFAULT), 
                                  &H5Dclose, "HDF5File::write(): Can not create dataset.");
 
+#ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        // compress the chunks in parallel and write them directly
+        if(chunkSize[0] > 0 && compressionParameter > 0 && options.getActualNumThreads() > 0)
+        {
+            writeChunks_(datasetHandle, array, numBandsOfType, chunkSize, compressionParameter, options);
+            return;
+        }
+#endif
+
         // Write the data to the HDF5 dataset as is
         herr_t write_status = H5Dwrite(datasetHandle, datatype, H5S_ALL,
                                        H5S_ALL, H5P_DEFAULT, array.data());
@@ -2063,6 +2177,231 @@ class HDF5File
                                         "failed.");
     }
 
+#ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        /* compute the array region covered by chunk number 'index' (in scan order)
+           and the chunk's offset in file coordinates
+        */
+    template<unsigned int N>
+    static void chunkRegion_(MultiArrayIndex index,
+                             typename MultiArrayShape<N>::type const & chunkCount,
+                             typename MultiArrayShape<N>::type const & chunkSize,
+                             typename MultiArrayShape<N>::type const & shape,
+                             const int numBandsOfType,
+                             typename MultiArrayShape<N>::type & start,
+                             typename MultiArrayShape<N>::type & stop,
+                             ArrayVector<hsize_t> & fileOffset)
+    {
+        typename MultiArrayShape<N>::type chunkIndex;
+        detail::ScanOrderToCoordinate<N>::exec(index, chunkCount, chunkIndex);
+        start = chunkIndex * chunkSize;
+        stop = min(start + chunkSize, shape);
+
+        fileOffset.resize(0);
+        for(int k = N-1; k >= 0; --k)
+            fileOffset.push_back(start[k]);
+        if(numBandsOfType > 1)
+            fileOffset.push_back(0);
+    }
+
+        /* low-level function to compress the chunks of a dataset in parallel
+           and write them with direct chunk I/O. The memory layout of a VIGRA
+           array chunk is identical to the C-order layout of the corresponding
+           HDF5 chunk, so the chunks only need to be copied, not transposed.
+        */
+    template<unsigned int N, class T>
+    void writeChunks_(hid_t datasetHandle,
+                      const MultiArrayView<N, T, UnstridedArrayTag> & array,
+                      const int numBandsOfType,
+                      typename MultiArrayShape<N>::type const & chunkSize,
+                      int compressionParameter,
+                      ParallelOptions const & options)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+
+        Shape chunkCount = (array.shape() + chunkSize - Shape(1)) / chunkSize;
+        MultiArrayIndex totalCount = prod(chunkCount);
+        std::size_t chunkBytes = prod(chunkSize) * sizeof(T);
+
+        // compress a batch of chunks in parallel, then write the batch sequentially
+        // (the HDF5 library must only be called from a single thread)
+        ThreadPool pool(options);
+        MultiArrayIndex batchSize = detail::parallelTaskCount(pool);
+        ArrayVector<ArrayVector<char> > buffers(batchSize);
+        ArrayVector<std::size_t> sizes(batchSize);
+        ArrayVector<hsize_t> fileOffset;
+
+        for(MultiArrayIndex first = 0; first < totalCount; first += batchSize)
+        {
+            MultiArrayIndex count = std::min(batchSize, totalCount - first);
+            parallel_foreach(pool, count,
+                [&](int, MultiArrayIndex k)
+                {
+                    Shape start, stop;
+                    ArrayVector<hsize_t> unused;
+                    chunkRegion_<N>(first + k, chunkCount, chunkSize, array.shape(),
+                                    numBandsOfType, start, stop, unused);
+                    // HDF5 always stores complete chunks, pad border chunks with zeros
+                    MultiArray<N, T> chunk(chunkSize);
+                    chunk.subarray(Shape(), stop - start) = array.subarray(start, stop);
+                    sizes[k] = HDF5_deflate_chunk((const char *)chunk.data(), chunkBytes,
+                                                  compressionParameter, buffers[k]);
+                });
+
+            for(MultiArrayIndex k = 0; k < count; ++k)
+            {
+                Shape start, stop;
+                chunkRegion_<N>(first + k, chunkCount, chunkSize, array.shape(),
+                                numBandsOfType, start, stop, fileOffset);
+                herr_t status = H5Dwrite_chunk(datasetHandle, H5P_DEFAULT, 0, fileOffset.begin(),
+                                               sizes[k], buffers[k].data());
+                vigra_postcondition(status >= 0,
+                    "HDF5File::write(): Unable to write compressed chunk.");
+            }
+        }
+    }
+
+        /* low-level function to read the chunks of a dataset with direct chunk I/O
+           and decompress them in parallel. Returns false (without reading anything)
+           when the dataset is not chunked or uses other filters than deflate.
+        */
+    template<unsigned int N, class T>
+    bool readChunks_(hid_t datasetHandle,
+                     MultiArrayView<N, T, UnstridedArrayTag> array,
+                     const hid_t datatype, const int numBandsOfType,
+                     ParallelOptions const & options)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+
+        HDF5Handle plist(H5Dget_create_plist(datasetHandle), &H5Pclose,
+                         "HDF5File::read(): unable to get property list.");
+        if(H5Pget_layout(plist) != H5D_CHUNKED || H5Pget_nfilters(plist) != 1)
+            return false;
+        unsigned int filterFlags = 0;
+        size_t filterParameterCount = 0;
+        if(H5Pget_filter2(plist, 0, &filterFlags, &filterParameterCount, NULL, 0, NULL, NULL) != H5Z_FILTER_DEFLATE)
+            return false;
+
+        // chunks are decompressed into the array as they are, so no type conversion may be needed
+        HDF5Handle fileType(H5Dget_type(datasetHandle), &H5Tclose,
+                            "HDF5File::read(): unable to get dataset type.");
+        if(H5Tequal(fileType, datatype) <= 0)
+            return false;
+
+        const int offset = (numBandsOfType > 1)
+                              ? 1
+                              : 0;
+        ArrayVector<hsize_t> cSize(N + offset);
+        if(H5Pget_chunk(plist, N + offset, cSize.begin()) != int(N + offset) ||
+           (offset && cSize[N] != static_cast<hsize_t>(numBandsOfType)))
+            return false;
+        Shape chunkSize;
+        for(unsigned int k = 0; k < N; ++k)
+            chunkSize[k] = (MultiArrayIndex)cSize[N-1-k];
+
+        Shape chunkCount = (array.shape() + chunkSize - Shape(1)) / chunkSize;
+        MultiArrayIndex totalCount = prod(chunkCount);
+        std::size_t chunkBytes = prod(chunkSize) * sizeof(T);
+
+        // read a batch of chunks sequentially, then decompress the batch in parallel
+        ThreadPool pool(options);
+        MultiArrayIndex batchSize = detail::parallelTaskCount(pool);
+        ArrayVector<ArrayVector<char> > buffers(batchSize);
+        ArrayVector<hsize_t> sizes(batchSize);
+        ArrayVector<uint32_t> filterMasks(batchSize);
+        ArrayVector<hsize_t> fileOffset;
+
+        for(MultiArrayIndex first = 0; first < totalCount; first += batchSize)
+        {
+            MultiArrayIndex count = std::min(batchSize, totalCount - first);
+            for(MultiArrayIndex k = 0; k < count; ++k)
+            {
+                Shape start, stop;
+                chunkRegion_<N>(first + k, chunkCount, chunkSize, array.shape(),
+                                numBandsOfType, start, stop, fileOffset);
+                // fails (quietly) for chunks that were never written
+                sizes[k] = 0;
+                H5E_BEGIN_TRY
+                {
+                    H5Dget_chunk_storage_size(datasetHandle, fileOffset.begin(), &sizes[k]);
+                }
+                H5E_END_TRY;
+                if(sizes[k] == 0)
+                {
+                    // chunk was never written, let HDF5 supply the fill value
+                    readRegion_(datasetHandle, array, datatype, numBandsOfType, start, stop);
+                    continue;
+                }
+                if(buffers[k].size() < sizes[k])
+                    buffers[k].resize(sizes[k]);
+                herr_t status = H5Dread_chunk(datasetHandle, H5P_DEFAULT, fileOffset.begin(),
+                                              &filterMasks[k], buffers[k].data());
+                vigra_postcondition(status >= 0,
+                    "HDF5File::read(): Unable to read compressed chunk.");
+            }
+
+            parallel_foreach(pool, count,
+                [&](int, MultiArrayIndex k)
+                {
+                    if(sizes[k] == 0)
+                        return;
+                    Shape start, stop;
+                    ArrayVector<hsize_t> unused;
+                    chunkRegion_<N>(first + k, chunkCount, chunkSize, array.shape(),
+                                    numBandsOfType, start, stop, unused);
+                    MultiArray<N, T> chunk(chunkSize);
+                    if(filterMasks[k] & 1)
+                    {
+                        // the (optional) deflate filter was skipped for this chunk
+                        vigra_postcondition(sizes[k] == chunkBytes,
+                            "HDF5File::read(): Uncompressed chunk has wrong size.");
+                        std::memcpy(chunk.data(), buffers[k].data(), chunkBytes);
+                    }
+                    else
+                    {
+                        HDF5_inflate_chunk(buffers[k].data(), sizes[k],
+                                           (char *)chunk.data(), chunkBytes);
+                    }
+                    array.subarray(start, stop) = chunk.subarray(Shape(), stop - start);
+                });
+        }
+        return true;
+    }
+
+        /* read the box [start, stop) of a dataset into the same box of array
+        */
+    template<unsigned int N, class T>
+    void readRegion_(hid_t datasetHandle,
+                     MultiArrayView<N, T, UnstridedArrayTag> array,
+                     const hid_t datatype, const int numBandsOfType,
+                     typename MultiArrayShape<N>::type const & start,
+                     typename MultiArrayShape<N>::type const & stop)
+    {
+        ArrayVector<hsize_t> shape, boxStart, boxShape;
+        for(int k = N-1; k >= 0; --k)
+        {
+            shape.push_back(array.shape(k));
+            boxStart.push_back(start[k]);
+            boxShape.push_back(stop[k] - start[k]);
+        }
+        if(numBandsOfType > 1)
+        {
+            shape.push_back(numBandsOfType);
+            boxStart.push_back(0);
+            boxShape.push_back(numBandsOfType);
+        }
+
+        HDF5Handle memspace(H5Screate_simple(shape.size(), shape.begin(), NULL), &H5Sclose,
+                            "HDF5File::read(): unable to create memory dataspace.");
+        HDF5Handle filespace(H5Dget_space(datasetHandle), &H5Sclose,
+                             "HDF5File::read(): unable to get dataspace.");
+        H5Sselect_hyperslab(memspace, H5S_SELECT_SET, boxStart.begin(), NULL, boxShape.begin(), NULL);
+        H5Sselect_hyperslab(filespace, H5S_SELECT_SET, boxStart.begin(), NULL, boxShape.begin(), NULL);
+        herr_t status = H5Dread(datasetHandle, datatype, memspace, filespace, H5P_DEFAULT, array.data());
+        vigra_postcondition(status >= 0,
+            "HDF5File::read(): Unable to read dataset region.");
+    }
+#endif
+
         /* Write single value as dataset.
            This functions allows to write data of atomic datatypes (int, long, double)
            as a dataset in the HDF5 file. So it is not necessary to create a MultiArray
@@ -2089,7 +2428,8 @@ class HDF5File
     template<unsigned int N, class T>
     inline void read_(std::string datasetName, 
                       MultiArrayView<N, T, UnstridedArrayTag> array, 
-                      const hid_t datatype, const int numBandsOfType)
+                      const hid_t datatype, const int numBandsOfType,
+                      ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
     {
         //Prepare to read without using HDF5ImportInfo
         ArrayVector<hsize_t> dimshape = getDatasetShape(datasetName);
@@ -2114,6 +2454,13 @@ class HDF5File
             vigra_precondition(dimshape[0] == static_cast<hsize_t>(numBandsOfType),
                                "HDF5File::read(): Band count doesn't match destination array compound type.");
 
+#ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        // decompress the chunks in parallel if the dataset permits
+        if(options.getActualNumThreads() > 0 &&
+           readChunks_(datasetHandle, array, datatype, numBandsOfType, options))
+            return;
+#endif
+
         // simply read in the data as is
         H5Dread( datasetHandle, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, array.data() ); // .data() possible since void pointer!
     }
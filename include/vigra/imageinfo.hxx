@@ -339,6 +339,19 @@ class ImageExportInfo
          **/
     VIGRA_EXPORT ImageExportInfo & setCanvasSize(const Size2D & size);
 
+        /** Store the image in tiles of the given size rather than in strips.
+
+            Currently only supported by TIFF files, where both the tile width
+            and height must be multiples of 16. Tiled files allow to read
+            regions of interest efficiently (see \ref importImageRegion()).
+            The default <tt>Size2D(0,0)</tt> means that no tiles are used.
+         **/
+    VIGRA_EXPORT ImageExportInfo & setTileSize(const Size2D & size);
+
+        /** Get the tile size set by setTileSize().
+         **/
+    VIGRA_EXPORT Size2D getTileSize() const;
+
         /**
           ICC profiles (handled as raw data so far).
           see getICCProfile()/setICCProfile()
@@ -360,7 +373,7 @@ class ImageExportInfo
     float m_x_res, m_y_res;
     Diff2D m_pos;
     ICCProfile m_icc_profile;
-    Size2D m_canvas_size;
+    Size2D m_canvas_size, m_tile_size;
     double fromMin_, fromMax_, toMin_, toMax_;
 };
 
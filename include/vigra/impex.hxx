@@ -49,6 +49,7 @@
 #define VIGRA_IMPEX_HXX
 
 #include "stdimage.hxx"
+#include "imageiterator.hxx"
 #include "imageinfo.hxx"
 #include "impexbase.hxx"
 
@@ -59,23 +60,152 @@ namespace vigra
 */
     namespace detail
     {
+        // Position the decoder at the first row of the region of interest and
+        // return the position of the ROI's first pixel within each scanline
+        // (in samples, i.e. in units of ValueType).
+        inline unsigned
+        seek_region_of_interest(Decoder* decoder,
+                                const Diff2D& roi_upper_left, const Size2D& roi_size)
+        {
+            if (roi_upper_left == Diff2D(0, 0) &&
+                roi_size == Size2D(decoder->getWidth(), decoder->getHeight()))
+            {
+                return 0U;
+            }
+
+            // let the codec skip the data outside the ROI if it can
+            if (decoder->setRegionOfInterest(roi_upper_left, roi_size))
+            {
+                return 0U;
+            }
+
+            for (int y = 0; y != roi_upper_left.y; ++y)
+            {
+                decoder->nextScanline();
+            }
+            return static_cast<unsigned>(roi_upper_left.x) * decoder->getOffset();
+        }
+
+
+        // Destinations that Decoder::readScanlines() can fill directly: images
+        // whose pixels lie in memory at fixed strides (BasicImage, BasicImageView,
+        // MultiArrayView<2, ...>), accessed by the default accessor of a pixel type
+        // whose components have the decoder's ValueType.
+        template <class ImageIterator>
+        struct IsStridedImageMemory
+        {
+            typedef VigraFalseType type;
+        };
+
+        template <class T>
+        struct IsStridedImageMemory<BasicImageIterator<T, T**> >
+        {
+            typedef VigraTrueType type;
+        };
+
+        template <class T>
+        struct IsStridedImageMemory<ImageIterator<T> >
+        {
+            typedef VigraTrueType type;
+        };
+
+        template <class T>
+        struct IsStridedImageMemory<StridedImageIterator<T> >
+        {
+            typedef VigraTrueType type;
+        };
+
+        template <class ImageAccessor, class ValueType>
+        struct IsPlainComponentAccessor
+        {
+            typedef VigraFalseType type;
+        };
+
+        template <class T>
+        struct IsPlainComponentAccessor<StandardAccessor<T>, T>
+        {
+            typedef VigraTrueType type;
+        };
+
+        template <class T>
+        struct IsPlainComponentAccessor<StandardValueAccessor<T>, T>
+        {
+            typedef VigraTrueType type;
+        };
+
+        template <class T, int SIZE>
+        struct IsPlainComponentAccessor<VectorAccessor<TinyVector<T, SIZE> >, T>
+        {
+            typedef VigraTrueType type;
+        };
+
+        template <class T, unsigned int R, unsigned int G, unsigned int B>
+        struct IsPlainComponentAccessor<RGBAccessor<RGBValue<T, R, G, B> >, T>
+        {
+            typedef VigraTrueType type;
+        };
+
+        template <class ValueType, class ImageIterator, class ImageAccessor>
+        struct IsBulkReadable
+        : public And<typename IsStridedImageMemory<ImageIterator>::type,
+                     typename IsPlainComponentAccessor<ImageAccessor, ValueType>::type>
+        {};
+
+
+        // Decode the region of interest straight into the destination's memory.
+        template <class ValueType, class ImageIterator>
+        void
+        read_image_block(Decoder* decoder,
+                         const Diff2D& roi_upper_left, const Size2D& roi_size,
+                         unsigned bands, ImageIterator image_iterator)
+        {
+            const unsigned roi_offset(seek_region_of_interest(decoder, roi_upper_left, roi_size));
+
+            UInt8* const data = reinterpret_cast<UInt8*>(&*image_iterator);
+            const std::ptrdiff_t pixel_stride =
+                reinterpret_cast<UInt8*>(&image_iterator[Diff2D(1, 0)]) - data;
+            const std::ptrdiff_t row_stride = roi_size.y > 1
+                ? reinterpret_cast<UInt8*>(&image_iterator[Diff2D(0, 1)]) - data
+                : 0;
+
+            decoder->readScanlines(data, roi_size.x, roi_size.y, bands,
+                                   pixel_stride, sizeof(ValueType), row_stride,
+                                   roi_offset);
+        }
+
+
         template <class ValueType,
                   class ImageIterator, class ImageAccessor>
         void
         read_image_band(Decoder* decoder,
-                        ImageIterator image_iterator, ImageAccessor image_accessor)
+                        const Diff2D& roi_upper_left, const Size2D& roi_size,
+                        ImageIterator image_iterator, ImageAccessor,
+                        /* isBulkReadable? */ VigraTrueType)
+        {
+            read_image_block<ValueType>(decoder, roi_upper_left, roi_size, 1U, image_iterator);
+        }
+
+
+        template <class ValueType,
+                  class ImageIterator, class ImageAccessor>
+        void
+        read_image_band(Decoder* decoder,
+                        const Diff2D& roi_upper_left, const Size2D& roi_size,
+                        ImageIterator image_iterator, ImageAccessor image_accessor,
+                        /* isBulkReadable? */ VigraFalseType)
         {
             typedef typename ImageIterator::row_iterator ImageRowIterator;
 
-            const unsigned width(decoder->getWidth());
-            const unsigned height(decoder->getHeight());
+            const unsigned width(roi_size.x);
+            const unsigned height(roi_size.y);
             const unsigned offset(decoder->getOffset());
+            const unsigned roi_offset(seek_region_of_interest(decoder, roi_upper_left, roi_size));
 
             for (unsigned y = 0U; y != height; ++y)
             {
                 decoder->nextScanline();
 
-                const ValueType* scanline = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0));
+                const ValueType* scanline = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0)) + roi_offset;
 
                 ImageRowIterator is(image_iterator.rowIterator());
                 const ImageRowIterator is_end(is + width);
@@ -92,18 +222,48 @@ namespace vigra
         }
 
 
+        template <class ValueType,
+                  class ImageIterator, class ImageAccessor>
+        void
+        read_image_band(Decoder* decoder,
+                        const Diff2D& roi_upper_left, const Size2D& roi_size,
+                        ImageIterator image_iterator, ImageAccessor image_accessor)
+        {
+            typedef typename IsBulkReadable<ValueType, ImageIterator, ImageAccessor>::type is_bulk_readable;
+
+            read_image_band<ValueType>(decoder, roi_upper_left, roi_size,
+                                       image_iterator, image_accessor, is_bulk_readable());
+        }
+
+
         template <class ValueType,
                   class ImageIterator, class ImageAccessor>
         void
         read_image_bands(Decoder* decoder,
-                         ImageIterator image_iterator, ImageAccessor image_accessor)
+                         const Diff2D& roi_upper_left, const Size2D& roi_size,
+                         ImageIterator image_iterator, ImageAccessor image_accessor,
+                         /* isBulkReadable? */ VigraTrueType)
+        {
+            read_image_block<ValueType>(decoder, roi_upper_left, roi_size,
+                                        image_accessor.size(image_iterator), image_iterator);
+        }
+
+
+        template <class ValueType,
+                  class ImageIterator, class ImageAccessor>
+        void
+        read_image_bands(Decoder* decoder,
+                         const Diff2D& roi_upper_left, const Size2D& roi_size,
+                         ImageIterator image_iterator, ImageAccessor image_accessor,
+                         /* isBulkReadable? */ VigraFalseType)
         {
             typedef typename ImageIterator::row_iterator ImageRowIterator;
 
-            const unsigned width(decoder->getWidth());
-            const unsigned height(decoder->getHeight());
+            const unsigned width(roi_size.x);
+            const unsigned height(roi_size.y);
             const unsigned offset(decoder->getOffset());
             const unsigned accessor_size(image_accessor.size(image_iterator));
+            const unsigned roi_offset(seek_region_of_interest(decoder, roi_upper_left, roi_size));
 
             // OPTIMIZATION: Specialization for the most common case
             // of an RGB-image, i.e. 3 channels.
@@ -117,9 +277,9 @@ namespace vigra
                 {
                     decoder->nextScanline();
 
-                    scanline_0 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0));
-                    scanline_1 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(1));
-                    scanline_2 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(2));
+                    scanline_0 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(0)) + roi_offset;
+                    scanline_1 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(1)) + roi_offset;
+                    scanline_2 = static_cast<const ValueType*>(decoder->currentScanlineOfBand(2)) + roi_offset;
 
                     ImageRowIterator is(image_iterator.rowIterator());
                     const ImageRowIterator is_end(is + width);
@@ -150,7 +310,7 @@ namespace vigra
 
                     for (unsigned i = 0U; i != accessor_size; ++i)
                     {
-                        scanlines[i] = static_cast<const ValueType*>(decoder->currentScanlineOfBand(i));
+                        scanlines[i] = static_cast<const ValueType*>(decoder->currentScanlineOfBand(i)) + roi_offset;
                     }
 
                     ImageRowIterator is(image_iterator.rowIterator());
@@ -172,79 +332,105 @@ namespace vigra
         }
 
 
-        template <class ImageIterator, class ImageAccessor>
+        template <class ValueType,
+                  class ImageIterator, class ImageAccessor>
         void
-        importImage(const ImageImportInfo& import_info,
-                    ImageIterator image_iterator, ImageAccessor image_accessor,
-                    /* isScalar? */ VigraTrueType)
+        read_image_bands(Decoder* decoder,
+                         const Diff2D& roi_upper_left, const Size2D& roi_size,
+                         ImageIterator image_iterator, ImageAccessor image_accessor)
         {
-            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
+            typedef typename IsBulkReadable<ValueType, ImageIterator, ImageAccessor>::type is_bulk_readable;
+
+            read_image_bands<ValueType>(decoder, roi_upper_left, roi_size,
+                                        image_iterator, image_accessor, is_bulk_readable());
+        }
 
+
+        // Read the region of interest of the decoder's current image.
+        template <class ImageIterator, class ImageAccessor>
+        void
+        read_image(Decoder* decoder,
+                   const Diff2D& roi_upper_left, const Size2D& roi_size,
+                   ImageIterator image_iterator, ImageAccessor image_accessor,
+                   /* isScalar? */ VigraTrueType)
+        {
             switch (pixel_t_of_string(decoder->getPixelType()))
             {
             case UNSIGNED_INT_8:
-                read_image_band<UInt8>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt8>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_16:
-                read_image_band<UInt16>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt16>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_32:
-                read_image_band<UInt32>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt32>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_16:
-                read_image_band<Int16>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<Int16>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_32:
-                read_image_band<Int32>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<Int32>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_32:
-                read_image_band<float>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<float>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_64:
-                read_image_band<double>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<double>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             default:
-                vigra_fail("detail::importImage<scalar>: not reached");
+                vigra_fail("detail::read_image<scalar>: not reached");
             }
-
-            decoder->close();
         }
 
 
+        // Read the region of interest of the decoder's current image.
         template <class ImageIterator, class ImageAccessor>
         void
-        importImage(const ImageImportInfo& import_info,
-                    ImageIterator image_iterator, ImageAccessor image_accessor,
-                    /* isScalar? */ VigraFalseType)
+        read_image(Decoder* decoder,
+                   const Diff2D& roi_upper_left, const Size2D& roi_size,
+                   ImageIterator image_iterator, ImageAccessor image_accessor,
+                   /* isScalar? */ VigraFalseType)
         {
-            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
-
             switch (pixel_t_of_string(decoder->getPixelType()))
             {
             case UNSIGNED_INT_8:
-                read_image_bands<UInt8>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt8>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_16:
-                read_image_bands<UInt16>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt16>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_32:
-                read_image_bands<UInt32>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt32>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_16:
-                read_image_bands<Int16>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<Int16>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_32:
-                read_image_bands<Int32>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<Int32>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_32:
-                read_image_bands<float>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<float>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_64:
-                read_image_bands<double>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<double>(decoder, roi_upper_left, roi_size, image_iterator, image_accessor);
                 break;
             default:
-                vigra_fail("vigra::detail::importImage<non-scalar>: not reached");
+                vigra_fail("vigra::detail::read_image<non-scalar>: not reached");
             }
+        }
+
+
+        template <class ImageIterator, class ImageAccessor, class IsScalar>
+        void
+        importImage(const ImageImportInfo& import_info,
+                    const Diff2D& roi_upper_left, const Size2D& roi_size,
+                    ImageIterator image_iterator, ImageAccessor image_accessor,
+                    IsScalar is_scalar)
+        {
+            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
+
+            read_image(decoder.get(), roi_upper_left, roi_size,
+                       image_iterator, image_accessor, is_scalar);
 
             decoder->close();
         }
@@ -690,6 +876,7 @@ namespace vigra
         typedef typename NumericTraits<ImageValueType>::isScalar is_scalar;
 
         detail::importImage(import_info,
+                    Diff2D(0, 0), import_info.size(),
                     image_iterator, image_accessor,
                     is_scalar());
     }
@@ -704,6 +891,101 @@ namespace vigra
                     image.first, image.second);
     }
 
+    /*!
+     * \brief Read a rectangular region of the image specified by the
+     * given \ref vigra::ImageImportInfo object.
+     *
+     * The region of interest <tt>[upperLeft, lowerRight)</tt> is written
+     * to the destination, which must therefore have the size
+     * <tt>lowerRight - upperLeft</tt>. Codecs that support random access
+     * (currently TIFF) decode only the strips or tiles overlapping the ROI,
+     * which is much faster than reading the entire image when the
+     * ROI is small. The other codecs read up to the last row of the ROI
+     * and discard the rest.
+     *
+     * <B>Declarations</B>
+     *
+     * Pass arguments explicitly:
+     * \code
+     * namespace vigra {
+     *     template <class ImageIterator, class Accessor>
+     *     void
+     *     importImageRegion(const ImageImportInfo& importInfo,
+     *                       const Diff2D& upperLeft, const Diff2D& lowerRight,
+     *                       ImageIterator imageIterator, Accessor imageAccessor)
+     * }
+     * \endcode
+     *
+     * Use argument objects in conjunction with \ref ArgumentObjectFactories :
+     * \code
+     * namespace vigra {
+     *     template <class ImageIterator, class Accessor>
+     *     void
+     *     importImageRegion(const ImageImportInfo& importInfo,
+     *                       const Diff2D& upperLeft, const Diff2D& lowerRight,
+     *                       const pair<ImageIterator, Accessor>& image)
+     * }
+     * \endcode
+     *
+     * <B>Usage</B>
+     *
+     * <B>\#include \<vigra/impex.hxx\></B>
+     *
+     * Namespace: vigra
+     *
+     * \code
+     *     ImageImportInfo info("slide.tif");
+     *
+     *     // read a 512x512 region from the middle of a huge (tiled) image
+     *     Diff2D upperLeft(info.width() / 2, info.height() / 2),
+     *            lowerRight(upperLeft + Diff2D(512, 512));
+     *     UInt16Image image(512, 512);
+     *
+     *     importImageRegion(info, upperLeft, lowerRight, destImage(image));
+     * \endcode
+     *
+     * <B>Preconditions</B>
+     *
+     * \code
+     * 0 <= upperLeft.x < lowerRight.x <= importInfo.width()
+     * 0 <= upperLeft.y < lowerRight.y <= importInfo.height()
+     * \endcode
+     */
+    doxygen_overloaded_function(template <...> inline void importImageRegion)
+
+
+    template <class ImageIterator, class ImageAccessor>
+    inline void
+    importImageRegion(const ImageImportInfo& import_info,
+                      const Diff2D& upper_left, const Diff2D& lower_right,
+                      ImageIterator image_iterator, ImageAccessor image_accessor)
+    {
+        typedef typename ImageAccessor::value_type ImageValueType;
+        typedef typename NumericTraits<ImageValueType>::isScalar is_scalar;
+
+        vigra_precondition(0 <= upper_left.x && upper_left.x < lower_right.x &&
+                           lower_right.x <= import_info.width() &&
+                           0 <= upper_left.y && upper_left.y < lower_right.y &&
+                           lower_right.y <= import_info.height(),
+                           "importImageRegion(): region of interest out of range.");
+
+        detail::importImage(import_info,
+                    upper_left, Size2D(lower_right.x - upper_left.x, lower_right.y - upper_left.y),
+                    image_iterator, image_accessor,
+                    is_scalar());
+    }
+
+
+    template <class ImageIterator, class ImageAccessor>
+    inline void
+    importImageRegion(const ImageImportInfo& import_info,
+                      const Diff2D& upper_left, const Diff2D& lower_right,
+                      const vigra::pair<ImageIterator, ImageAccessor>& image)
+    {
+        importImageRegion(import_info, upper_left, lower_right,
+                          image.first, image.second);
+    }
+
     /*!
      * \brief Write an image given a \ref vigra::ImageExportInfo object.
      *
@@ -281,8 +281,11 @@ unsigned int labelVolume(SrcIterator s_Iter, SrcShape srcShape, SrcAccessor sa,
                         
                         }
                         */
+                        // the border type cannot express that a voxel is at the left and 
+                        // right (or top and bottom) border at the same time, so check 
+                        // explicitly for volumes of width or height 1 
                         //   colors equal???
-                        if(equal(sa(xs), sa(xs, *nc)))
+                        if(x + (*nc)[0] < w && y + (*nc)[1] < h && equal(sa(xs), sa(xs, *nc)))
                         {
                             currentLabel = label.makeUnion(label[da(xd,*nc)], currentLabel);
                         }
@@ -564,8 +567,11 @@ unsigned int labelVolumeWithBackground(SrcIterator s_Iter, SrcShape srcShape, Sr
                     int j=0;
                     while(nc.direction() != Neighborhood3D::Error)
                     {
+                        // the border type cannot express that a voxel is at the left and 
+                        // right (or top and bottom) border at the same time, so check 
+                        // explicitly for volumes of width or height 1 
                         //   colors equal???
-                        if(equal(sa(xs), sa(xs, *nc)))
+                        if(x + (*nc)[0] < w && y + (*nc)[1] < h && equal(sa(xs), sa(xs, *nc)))
                         {
                             currentLabel = label.makeUnion(label[da(xd,*nc)], currentLabel);
                         }
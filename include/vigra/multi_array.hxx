@@ -588,13 +588,6 @@ swapDataImpl(SrcIterator s, Shape const & shape, DestIterator d, MetaInt<N>)
 /*                                                      */
 /********************************************************/
 
-// forward declarations
-
-template <unsigned int N, class T, class C = UnstridedArrayTag>
-class MultiArrayView;
-template <unsigned int N, class T, class A = std::allocator<T> >
-class MultiArray;
-
 namespace multi_math {
 
 template <class T>
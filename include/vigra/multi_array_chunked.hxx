@@ -0,0 +1,919 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2014 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_ARRAY_CHUNKED_HXX
+#define VIGRA_MULTI_ARRAY_CHUNKED_HXX
+
+#include <list>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+
+#include "multi_array.hxx"
+#include "threading.hxx"
+
+namespace vigra {
+
+/** \addtogroup MultiArrayChunked Chunked arrays
+
+    Arrays which are too large for the main memory.
+*/
+//@{
+
+/** \brief Options for ChunkedArray and its subclasses.
+
+    <b>\#include</b> \<vigra/multi_array_chunked.hxx\><br>
+    Namespace: vigra
+*/
+class ChunkedArrayOptions
+{
+  public:
+        /** Initialize with default options:
+            fill value 0, automatic cache size, no compression.
+        */
+    ChunkedArrayOptions()
+    : fill_value(0.0),
+      cache_max(-1),
+      compression_level(0)
+    {}
+
+        /** Value of all elements that have never been written.
+
+            Default: 0
+        */
+    ChunkedArrayOptions & fillValue(double v)
+    {
+        fill_value = v;
+        return *this;
+    }
+
+        /** Maximum number of chunks held in memory.
+
+            If <tt>v</tt> is negative, the cache can hold one line of chunks
+            along the longest axis of the chunk grid. Chunks that are currently
+            in use (e.g. referenced by a chunk iterator) are never evicted,
+            so that the cache may temporarily become larger.
+
+            Default: -1
+        */
+    ChunkedArrayOptions & cacheMax(int v)
+    {
+        cache_max = v;
+        return *this;
+    }
+
+        /** Compression level (0 = none, 1 ... 9) of the backing store.
+
+            Only used by backends that support compression (e.g. ChunkedArrayHDF5).
+
+            Default: 0
+        */
+    ChunkedArrayOptions & compression(int v)
+    {
+        compression_level = v;
+        return *this;
+    }
+
+    double fill_value;
+    int cache_max;
+    int compression_level;
+};
+
+template <unsigned int N, class T>
+class ChunkedArray;
+
+namespace detail {
+
+template <class Shape>
+inline bool
+allLess(Shape const & l, Shape const & r)
+{
+    for(int k=0; k<(int)Shape::static_size; ++k)
+        if(!(l[k] < r[k]))
+            return false;
+    return true;
+}
+
+template <class Shape>
+inline bool
+allLessEqual(Shape const & l, Shape const & r)
+{
+    for(int k=0; k<(int)Shape::static_size; ++k)
+        if(!(l[k] <= r[k]))
+            return false;
+    return true;
+}
+
+// MultiArrayView that can be bound to different data
+// (assignment of views copies the data instead)
+template <unsigned int N, class T>
+class RebindableView
+: public MultiArrayView<N, T, StridedArrayTag>
+{
+  public:
+    template <class Stride>
+    void rebind(MultiArrayView<N, T, Stride> const & v)
+    {
+        this->m_shape  = v.shape();
+        this->m_stride = v.stride();
+        this->m_ptr    = const_cast<T *>(v.data());
+    }
+
+    void reset()
+    {
+        this->m_shape  = typename MultiArrayShape<N>::type();
+        this->m_stride = typename MultiArrayShape<N>::type();
+        this->m_ptr    = 0;
+    }
+};
+
+} // namespace detail
+
+/** \brief Iterate over the chunks of a ChunkedArray that intersect a region of interest.
+
+    Dereferencing the iterator gives a MultiArrayView to the part of the current
+    chunk that lies inside the region of interest. The chunk is locked in the
+    cache as long as the iterator refers to it. Use chunkStart() to get the
+    coordinates of the view's first element in the ChunkedArray.
+
+    <b>\#include</b> \<vigra/multi_array_chunked.hxx\><br>
+    Namespace: vigra
+*/
+template <unsigned int N, class T>
+class ChunkIterator
+{
+  public:
+    typedef typename MultiArrayShape<N>::type           shape_type;
+    typedef MultiArrayView<N, T, StridedArrayTag>       view_type;
+    typedef view_type                                   value_type;
+    typedef view_type const &                           reference;
+    typedef view_type const *                           pointer;
+    typedef std::forward_iterator_tag                   iterator_category;
+    typedef MultiArrayIndex                             difference_type;
+
+    ChunkIterator()
+    : array_(0),
+      write_(false),
+      at_end_(true)
+    {}
+
+    ChunkIterator(ChunkedArray<N, T> * array,
+                  shape_type const & start, shape_type const & stop,
+                  bool write)
+    : array_(array),
+      start_(start),
+      stop_(stop),
+      write_(write),
+      at_end_(true)
+    {
+        vigra_precondition(detail::allLessEqual(shape_type(), start) &&
+                           detail::allLess(start, stop) &&
+                           detail::allLessEqual(stop, array->shape()),
+            "ChunkIterator(): invalid region of interest.");
+        chunk_begin_ = start / array->chunkShape();
+        chunk_end_   = (stop - shape_type(1)) / array->chunkShape() + shape_type(1);
+        current_ = chunk_begin_;
+        at_end_ = false;
+        acquire();
+    }
+
+    ChunkIterator(ChunkIterator const & other)
+    : array_(other.array_),
+      start_(other.start_),
+      stop_(other.stop_),
+      chunk_begin_(other.chunk_begin_),
+      chunk_end_(other.chunk_end_),
+      current_(other.current_),
+      write_(other.write_),
+      at_end_(other.at_end_)
+    {
+        acquire();
+    }
+
+    ChunkIterator & operator=(ChunkIterator const & other)
+    {
+        if(this != &other)
+        {
+            release();
+            array_ = other.array_;
+            start_ = other.start_;
+            stop_  = other.stop_;
+            chunk_begin_ = other.chunk_begin_;
+            chunk_end_ = other.chunk_end_;
+            current_ = other.current_;
+            write_ = other.write_;
+            at_end_ = other.at_end_;
+            acquire();
+        }
+        return *this;
+    }
+
+    ~ChunkIterator()
+    {
+        release();
+    }
+
+    ChunkIterator & operator++()
+    {
+        release();
+        for(unsigned int k=0; k<N; ++k)
+        {
+            if(++current_[k] < chunk_end_[k])
+            {
+                acquire();
+                return *this;
+            }
+            current_[k] = chunk_begin_[k];
+        }
+        at_end_ = true;
+        return *this;
+    }
+
+    reference operator*() const
+    {
+        return view_;
+    }
+
+    pointer operator->() const
+    {
+        return &view_;
+    }
+
+    bool operator==(ChunkIterator const & other) const
+    {
+        if(at_end_ || other.at_end_)
+            return at_end_ == other.at_end_;
+        return array_ == other.array_ && current_ == other.current_;
+    }
+
+    bool operator!=(ChunkIterator const & other) const
+    {
+        return !operator==(other);
+    }
+
+        /** Coordinates of the current chunk in the chunk grid.
+        */
+    shape_type const & chunkIndex() const
+    {
+        return current_;
+    }
+
+        /** Coordinates of the first element of the current view in the ChunkedArray.
+        */
+    shape_type chunkStart() const
+    {
+        return max(start_, current_*array_->chunkShape());
+    }
+
+        /** Coordinates beyond the last element of the current view in the ChunkedArray.
+        */
+    shape_type chunkStop() const
+    {
+        return min(stop_, (current_ + shape_type(1))*array_->chunkShape());
+    }
+
+  private:
+    void acquire()
+    {
+        if(at_end_)
+            return;
+        shape_type chunkOffset = current_*array_->chunkShape();
+        MultiArrayView<N, T> chunk = array_->acquireChunk(current_, write_);
+        view_.rebind(chunk.subarray(chunkStart() - chunkOffset, chunkStop() - chunkOffset));
+    }
+
+    void release()
+    {
+        if(at_end_)
+            return;
+        array_->releaseChunk(current_);
+        view_.reset();
+    }
+
+    ChunkedArray<N, T> * array_;
+    shape_type start_, stop_, chunk_begin_, chunk_end_, current_;
+    detail::RebindableView<N, T> view_;
+    bool write_, at_end_;
+};
+
+/** \brief Base class of arrays which are stored in chunks and loaded on demand.
+
+    A ChunkedArray is divided into chunks of equal shape (except at the upper
+    borders). At any time, only a limited number of chunks is held in memory. When
+    this number is exceeded, the least recently used chunk that is not currently
+    locked is written back to the backing store (if it was modified) and
+    released. Subclasses implement the backing store by overriding loadChunk()
+    and storeChunk():
+
+    <ul>
+    <li> \ref ChunkedArrayTmpFile stores the chunks in an anonymous temporary file.
+    <li> \ref ChunkedArrayHDF5 (in \<vigra/multi_array_chunked_hdf5.hxx\>) stores
+         the chunks in a chunked and optionally compressed HDF5 dataset.
+    </ul>
+
+    Single elements can be accessed by getItem() and setItem(), but this is slow.
+    Data should rather be transferred in blocks via checkoutSubarray() and
+    commitSubarray(), or processed chunk by chunk via chunk_begin() and
+    chunk_end(). The latter allows algorithms to stream arrays that are far bigger
+    than the main memory. All functions are thread-safe. The chunk cache is not
+    locked while chunks are transferred from or to the backing store, so threads
+    working on chunks in memory are not blocked by another thread's I/O. Subclasses
+    must therefore make loadChunk() and storeChunk() thread-safe themselves.
+
+    <b>Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_array_chunked.hxx\><br>
+    Namespace: vigra
+
+    \code
+    typedef ChunkedArrayTmpFile<3, float>::shape_type Shape;
+    ChunkedArrayTmpFile<3, float> array(Shape(2000, 2000, 2000), Shape(64, 64, 64),
+                                        ChunkedArrayOptions().cacheMax(1000));
+
+    // fill the array block by block
+    MultiArray<3, float> block(Shape(500, 500, 100));
+    for(int z = 0; z < 2000; z += 100)
+    {
+        ... // compute block for slices z ... z+99
+        array.commitSubarray(Shape(0, 0, z), block);
+    }
+
+    // compute the mean of a region of interest chunk by chunk
+    double sum = 0.0;
+    Shape start(100, 100, 100), stop(1900, 1900, 1900);
+    ChunkedArrayTmpFile<3, float>::chunk_iterator i   = array.chunk_begin(start, stop),
+                                                  end = array.chunk_end(start, stop);
+    for(; i != end; ++i)
+        sum += i->sum<double>();
+    double mean = sum / prod(stop - start);
+
+    // copy a region of interest into main memory and smooth it
+    MultiArray<3, float> roi(Shape(200, 200, 200)), smoothed(roi.shape());
+    array.checkoutSubarray(Shape(500, 500, 500), roi);
+    gaussianSmoothMultiArray(roi, smoothed, 2.0);
+    \endcode
+
+    Algorithms that need a context around each chunk (e.g. convolution) can check
+    out a chunk enlarged by the required border, process it in main memory, and
+    commit the interior of the result.
+*/
+template <unsigned int N, class T>
+class ChunkedArray
+{
+  public:
+    typedef T                                   value_type;
+    typedef typename MultiArrayShape<N>::type   shape_type;
+    typedef MultiArrayView<N, T>                view_type;
+    typedef ChunkIterator<N, T>                 chunk_iterator;
+
+        /** Create a chunked array of the given shape and chunk shape.
+        */
+    ChunkedArray(shape_type const & shape, shape_type const & chunk_shape,
+                 ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : shape_(shape),
+      chunk_shape_(checkedChunkShape(shape, chunk_shape)),
+      chunk_array_shape_((shape - shape_type(1)) / chunk_shape_ + shape_type(1)),
+      fill_value_(detail::RequiresExplicitCast<T>::cast(options.fill_value)),
+      cache_max_(options.cache_max < 0
+                    ? (int)max(chunk_array_shape_)
+                    : std::max(options.cache_max, 1)),
+      handles_(prod(chunk_array_shape_))
+    {}
+
+    virtual ~ChunkedArray()
+    {
+        for(unsigned int k=0; k<handles_.size(); ++k)
+            delete [] handles_[k].pointer_;
+    }
+
+        /** Shape of the array.
+        */
+    shape_type const & shape() const
+    {
+        return shape_;
+    }
+
+        /** Shape of the array along the given axis.
+        */
+    MultiArrayIndex shape(int d) const
+    {
+        return shape_[d];
+    }
+
+        /** Number of elements.
+        */
+    MultiArrayIndex size() const
+    {
+        return prod(shape_);
+    }
+
+        /** Shape of the chunks (except at the upper borders).
+        */
+    shape_type const & chunkShape() const
+    {
+        return chunk_shape_;
+    }
+
+        /** Shape of the chunk at the given position in the chunk grid.
+        */
+    shape_type chunkShape(shape_type const & chunkIndex) const
+    {
+        return min(chunk_shape_, shape_ - chunkIndex*chunk_shape_);
+    }
+
+        /** Number of chunks along each axis.
+        */
+    shape_type const & chunkArrayShape() const
+    {
+        return chunk_array_shape_;
+    }
+
+        /** Maximum number of chunks in the cache.
+        */
+    int cacheMaxSize() const
+    {
+        return cache_max_;
+    }
+
+        /** Change the maximum number of chunks in the cache.
+        */
+    void setCacheMaxSize(int c)
+    {
+        threading::unique_lock<threading::mutex> lock(mutex_);
+        cache_max_ = std::max(c, 1);
+        cleanCache(lock);
+    }
+
+        /** Number of chunks currently held in memory.
+        */
+    int cacheSize() const
+    {
+        threading::lock_guard<threading::mutex> lock(mutex_);
+        return cache_.size();
+    }
+
+        /** Read the element at the given point.
+        */
+    value_type getItem(shape_type const & point) const
+    {
+        vigra_precondition(isInside(point),
+            "ChunkedArray::getItem(): index out of bounds.");
+        shape_type chunkIndex = point / chunk_shape_;
+        view_type chunk = const_cast<ChunkedArray *>(this)->acquireChunk(chunkIndex, false);
+        value_type res = chunk[point - chunkIndex*chunk_shape_];
+        const_cast<ChunkedArray *>(this)->releaseChunk(chunkIndex);
+        return res;
+    }
+
+        /** Write the element at the given point.
+        */
+    void setItem(shape_type const & point, value_type const & v)
+    {
+        vigra_precondition(isInside(point),
+            "ChunkedArray::setItem(): index out of bounds.");
+        shape_type chunkIndex = point / chunk_shape_;
+        view_type chunk = acquireChunk(chunkIndex, true);
+        chunk[point - chunkIndex*chunk_shape_] = v;
+        releaseChunk(chunkIndex);
+    }
+
+        /** Copy the block starting at <tt>start</tt> with the shape of <tt>subarray</tt>
+            into <tt>subarray</tt>.
+        */
+    template <class U, class Stride>
+    void checkoutSubarray(shape_type const & start,
+                          MultiArrayView<N, U, Stride> & subarray) const
+    {
+        shape_type stop = start + subarray.shape();
+        chunk_iterator i = const_cast<ChunkedArray *>(this)->chunk_cbegin(start, stop),
+                       end = const_cast<ChunkedArray *>(this)->chunk_end(start, stop);
+        for(; i != end; ++i)
+            subarray.subarray(i.chunkStart() - start, i.chunkStop() - start) = *i;
+    }
+
+        /** Copy <tt>subarray</tt> into the block starting at <tt>start</tt>.
+        */
+    template <class U, class Stride>
+    void commitSubarray(shape_type const & start,
+                        MultiArrayView<N, U, Stride> const & subarray)
+    {
+        shape_type stop = start + subarray.shape();
+        chunk_iterator i = chunk_begin(start, stop),
+                       end = chunk_end(start, stop);
+        for(; i != end; ++i)
+        {
+            typename chunk_iterator::view_type chunk = *i;
+            chunk = subarray.subarray(i.chunkStart() - start, i.chunkStop() - start);
+        }
+    }
+
+        /** Iterator over the chunks intersecting the region of interest
+            <tt>[start, stop)</tt>. All visited chunks are marked as modified.
+        */
+    chunk_iterator chunk_begin(shape_type const & start, shape_type const & stop)
+    {
+        return chunk_iterator(this, start, stop, true);
+    }
+
+        /** Iterator over the chunks intersecting the region of interest
+            <tt>[start, stop)</tt> for read-only access. Modifications of the
+            chunks are lost when the chunks are evicted from the cache.
+        */
+    chunk_iterator chunk_cbegin(shape_type const & start, shape_type const & stop)
+    {
+        return chunk_iterator(this, start, stop, false);
+    }
+
+        /** End iterator corresponding to chunk_begin() and chunk_cbegin().
+        */
+    chunk_iterator chunk_end(shape_type const &, shape_type const &)
+    {
+        return chunk_iterator();
+    }
+
+        /** Write all modified chunks to the backing store.
+
+            Errors of the backing store are reported by an exception. Call this
+            function before the array is destroyed if you need to know whether
+            all data were written, because destructors silently ignore errors.
+        */
+    void flush()
+    {
+        threading::unique_lock<threading::mutex> lock(mutex_);
+        std::vector<MultiArrayIndex> cached(cache_.begin(), cache_.end());
+        for(unsigned int k=0; k<cached.size(); ++k)
+        {
+            ChunkHandle & h = handles_[cached[k]];
+            waitWhileBusy(h, lock);
+            if(h.pointer_ != 0 && h.dirty_)
+                storeChunkUnlocked(cached[k], h, lock);
+        }
+    }
+
+        /** Lock the given chunk in the cache (loading it if necessary) and return
+            a view to its data. When <tt>write</tt> is true, the chunk is marked
+            as modified and will be written back upon eviction. Every call must
+            be matched by a call to releaseChunk().
+
+            The internal mutex is not held while a chunk is read from or written to
+            the backing store, so that other threads can meanwhile access the chunks
+            already in memory. Threads requesting a chunk whose I/O is in progress
+            wait until it is finished.
+        */
+    view_type acquireChunk(shape_type const & chunkIndex, bool write)
+    {
+        threading::unique_lock<threading::mutex> lock(mutex_);
+        MultiArrayIndex index = scanOrderIndex(chunkIndex);
+        ChunkHandle & h = handles_[index];
+        shape_type shape = chunkShape(chunkIndex);
+        waitWhileBusy(h, lock);
+        ++h.refcount_;
+        if(h.pointer_ == 0)
+        {
+            h.busy_ = true;
+            T * p = 0;
+            lock.unlock();
+            try
+            {
+                p = new T[prod(shape)];
+                view_type chunk(shape, p);
+                loadChunk(chunkIndex, chunk);
+            }
+            catch(...)
+            {
+                delete [] p;
+                lock.lock();
+                --h.refcount_;
+                h.busy_ = false;
+                chunk_ready_.notify_all();
+                throw;
+            }
+            lock.lock();
+            h.pointer_ = p;
+            h.busy_ = false;
+            chunk_ready_.notify_all();
+            cache_.push_front(index);
+        }
+        else
+        {
+            cache_.splice(cache_.begin(), cache_, h.cache_position_);
+        }
+        h.cache_position_ = cache_.begin();
+        if(write)
+            h.dirty_ = true;
+        try
+        {
+            cleanCache(lock);
+        }
+        catch(...)
+        {
+            // the caller never gets the chunk, so it must not remain locked
+            --h.refcount_;
+            throw;
+        }
+        return view_type(shape, h.pointer_);
+    }
+
+        /** Unlock a chunk locked by acquireChunk().
+
+            The chunk is not evicted immediately (this happens in the next
+            call to acquireChunk()), so that this function never throws.
+        */
+    void releaseChunk(shape_type const & chunkIndex)
+    {
+        threading::lock_guard<threading::mutex> lock(mutex_);
+        --handles_[scanOrderIndex(chunkIndex)].refcount_;
+    }
+
+  protected:
+        /** Fill the given chunk from the backing store.
+            May be called concurrently for different chunks.
+        */
+    virtual void loadChunk(shape_type const & chunkIndex, view_type & chunk) = 0;
+
+        /** Write the given chunk to the backing store.
+            May be called concurrently for different chunks.
+        */
+    virtual void storeChunk(shape_type const & chunkIndex, view_type const & chunk) = 0;
+
+        /** Value of elements that have never been written.
+        */
+    value_type fillValue() const
+    {
+        return fill_value_;
+    }
+
+        /** Write back and release all chunks. Must be called in the destructor
+            of subclasses whose backing store persists (the base class destructor
+            can no longer call storeChunk()). Since exceptions must not escape
+            from destructors, errors are reported to the caller, who should ignore
+            them in a destructor.
+        */
+    void releaseAllChunks()
+    {
+        flush();
+        threading::lock_guard<threading::mutex> lock(mutex_);
+        for(std::list<MultiArrayIndex>::iterator i = cache_.begin(); i != cache_.end(); ++i)
+        {
+            ChunkHandle & h = handles_[*i];
+            delete [] h.pointer_;
+            h.pointer_ = 0;
+        }
+        cache_.clear();
+    }
+
+  private:
+    struct ChunkHandle
+    {
+        ChunkHandle()
+        : pointer_(0),
+          refcount_(0),
+          dirty_(false),
+          busy_(false)
+        {}
+
+        T * pointer_;
+        int refcount_;
+        bool dirty_;
+        bool busy_;     // the chunk is being loaded or stored
+        std::list<MultiArrayIndex>::iterator cache_position_;
+    };
+
+    static shape_type checkedChunkShape(shape_type const & shape, shape_type const & chunk_shape)
+    {
+        vigra_precondition(detail::allLess(shape_type(), shape),
+            "ChunkedArray(): shape must be positive.");
+        vigra_precondition(detail::allLess(shape_type(), chunk_shape),
+            "ChunkedArray(): chunk shape must be positive.");
+        return min(chunk_shape, shape);
+    }
+
+    ChunkedArray(ChunkedArray const &);             // not implemented
+    ChunkedArray & operator=(ChunkedArray const &); // not implemented
+
+    bool isInside(shape_type const & p) const
+    {
+        return detail::allLessEqual(shape_type(), p) && detail::allLess(p, shape_);
+    }
+
+    MultiArrayIndex scanOrderIndex(shape_type const & chunkIndex) const
+    {
+        MultiArrayIndex res = 0, stride = 1;
+        for(unsigned int k=0; k<N; ++k)
+        {
+            res += stride*chunkIndex[k];
+            stride *= chunk_array_shape_[k];
+        }
+        return res;
+    }
+
+    shape_type chunkIndexFromScanOrder(MultiArrayIndex index) const
+    {
+        shape_type res;
+        for(unsigned int k=0; k<N; ++k)
+        {
+            res[k] = index % chunk_array_shape_[k];
+            index /= chunk_array_shape_[k];
+        }
+        return res;
+    }
+
+    void waitWhileBusy(ChunkHandle & h, threading::unique_lock<threading::mutex> & lock)
+    {
+        while(h.busy_)
+            chunk_ready_.wait(lock);
+    }
+
+    // write a dirty chunk to the backing store without holding the mutex
+    // ('lock' must own the mutex upon entry and owns it again upon exit);
+    // the chunk is only marked clean when nobody holds it
+    void storeChunkUnlocked(MultiArrayIndex index, ChunkHandle & h,
+                            threading::unique_lock<threading::mutex> & lock)
+    {
+        shape_type chunkIndex = chunkIndexFromScanOrder(index);
+        view_type chunk(chunkShape(chunkIndex), h.pointer_);
+        h.busy_ = true;
+        // a chunk that is still acquired may be modified after this call
+        // (e.g. by a writer holding it during flush()), so it remains dirty
+        h.dirty_ = h.refcount_ > 0;
+        lock.unlock();
+        try
+        {
+            storeChunk(chunkIndex, chunk);
+        }
+        catch(...)
+        {
+            lock.lock();
+            h.dirty_ = true;
+            h.busy_ = false;
+            chunk_ready_.notify_all();
+            throw;
+        }
+        lock.lock();
+        h.busy_ = false;
+        chunk_ready_.notify_all();
+    }
+
+    // evict least recently used, unlocked chunks until the cache
+    // is small enough ('lock' must own the mutex)
+    void cleanCache(threading::unique_lock<threading::mutex> & lock)
+    {
+        while((int)cache_.size() > cache_max_)
+        {
+            // the list may change while the mutex is released for I/O,
+            // so search it from the end every time
+            std::list<MultiArrayIndex>::iterator i = cache_.end();
+            while(i != cache_.begin())
+            {
+                --i;
+                ChunkHandle & h = handles_[*i];
+                if(h.refcount_ == 0 && !h.busy_)
+                    break;
+                if(i == cache_.begin())
+                    return;  // all chunks are in use
+            }
+
+            MultiArrayIndex index = *i;
+            ChunkHandle & h = handles_[index];
+            if(h.dirty_)
+            {
+                storeChunkUnlocked(index, h, lock);
+                // the chunk may have been acquired in the meantime
+                if(h.refcount_ > 0)
+                    continue;
+            }
+            cache_.erase(h.cache_position_);
+            delete [] h.pointer_;
+            h.pointer_ = 0;
+        }
+    }
+
+    shape_type shape_, chunk_shape_, chunk_array_shape_;
+    value_type fill_value_;
+    int cache_max_;
+    std::vector<ChunkHandle> handles_;
+    std::list<MultiArrayIndex> cache_;
+    mutable threading::mutex mutex_;
+    threading::condition_variable chunk_ready_;
+};
+
+/** \brief ChunkedArray whose chunks are swapped out to an anonymous temporary file.
+
+    The file is created by <tt>std::tmpfile()</tt> and deleted automatically
+    when the array is destroyed. Every chunk occupies a fixed slot in the file,
+    which is only written when the chunk is evicted after modification.
+    Chunks that were never written are initialized with the fill value.
+
+    <b>\#include</b> \<vigra/multi_array_chunked.hxx\><br>
+    Namespace: vigra
+*/
+template <unsigned int N, class T>
+class ChunkedArrayTmpFile
+: public ChunkedArray<N, T>
+{
+  public:
+    typedef ChunkedArray<N, T>              base_type;
+    typedef typename base_type::shape_type  shape_type;
+    typedef typename base_type::view_type   view_type;
+
+    ChunkedArrayTmpFile(shape_type const & shape, shape_type const & chunk_shape,
+                        ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : base_type(shape, chunk_shape, options),
+      file_(std::tmpfile()),
+      stored_(prod(this->chunkArrayShape()), false)
+    {
+        vigra_postcondition(file_ != 0,
+            "ChunkedArrayTmpFile(): unable to create temporary file.");
+        vigra_precondition((double)prod(this->chunkArrayShape())*prod(this->chunkShape())*sizeof(T) <
+                               (double)std::numeric_limits<long>::max(),
+            "ChunkedArrayTmpFile(): array too large for the file offset type.");
+    }
+
+    ~ChunkedArrayTmpFile()
+    {
+        // the file is deleted anyway, so modified chunks need not be written back
+        // (the base class destructor frees the chunks in memory)
+        std::fclose(file_);
+    }
+
+  protected:
+    virtual void loadChunk(shape_type const & chunkIndex, view_type & chunk)
+    {
+        MultiArrayIndex index = slot(chunkIndex);
+        threading::lock_guard<threading::mutex> lock(io_mutex_);
+        if(!stored_[index])
+        {
+            chunk.init(this->fillValue());
+            return;
+        }
+        std::size_t count = chunk.size();
+        vigra_postcondition(std::fseek(file_, offset(index), SEEK_SET) == 0 &&
+                            std::fread(chunk.data(), sizeof(T), count, file_) == count,
+            "ChunkedArrayTmpFile: unable to read chunk from temporary file.");
+    }
+
+    virtual void storeChunk(shape_type const & chunkIndex, view_type const & chunk)
+    {
+        MultiArrayIndex index = slot(chunkIndex);
+        std::size_t count = chunk.size();
+        threading::lock_guard<threading::mutex> lock(io_mutex_);
+        vigra_postcondition(std::fseek(file_, offset(index), SEEK_SET) == 0 &&
+                            std::fwrite(chunk.data(), sizeof(T), count, file_) == count,
+            "ChunkedArrayTmpFile: unable to write chunk to temporary file.");
+        stored_[index] = true;
+    }
+
+  private:
+    MultiArrayIndex slot(shape_type const & chunkIndex) const
+    {
+        return dot(chunkIndex, detail::defaultStride<N>(this->chunkArrayShape()));
+    }
+
+    long offset(MultiArrayIndex slot) const
+    {
+        return (long)(slot*prod(this->chunkShape())*sizeof(T));
+    }
+
+    std::FILE * file_;
+    std::vector<bool> stored_;
+    threading::mutex io_mutex_;     // seek and read/write must not be interleaved
+};
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_ARRAY_CHUNKED_HXX
@@ -0,0 +1,187 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2014 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_ARRAY_CHUNKED_HDF5_HXX
+#define VIGRA_MULTI_ARRAY_CHUNKED_HDF5_HXX
+
+#include <string>
+
+#include "multi_array_chunked.hxx"
+#include "hdf5impex.hxx"
+
+namespace vigra {
+
+/** \addtogroup MultiArrayChunked
+*/
+//@{
+
+namespace detail {
+
+    // serializes the HDF5 calls of all ChunkedArrayHDF5 objects in the process
+inline threading::mutex & chunkedArrayHDF5Mutex()
+{
+    static threading::mutex mutex;
+    return mutex;
+}
+
+} // namespace detail
+
+/** \brief ChunkedArray whose chunks are stored in an HDF5 dataset.
+
+    The dataset is created with the chunk shape of the array, so that every
+    chunk of the ChunkedArray corresponds to exactly one HDF5 chunk and is read or
+    written by a single I/O operation. When a compression level is given
+    in the ChunkedArrayOptions, the dataset is compressed by HDF5's deflate
+    filter. Unlike \ref ChunkedArrayTmpFile, the data persist after the
+    array is destroyed and can be reopened later.
+
+    The HDF5File must remain open during the lifetime of the array. Modified
+    chunks are written back when they are evicted from the cache, when
+    flush() is called, and in the destructor. The destructor ignores errors,
+    so call flush() explicitly when you need to know whether all data were
+    written. Since the HDF5 library is not thread-safe, all ChunkedArrayHDF5
+    objects of the process share one mutex, so that only one thread at a time
+    calls into HDF5, even when several arrays refer to the same HDF5File.
+    Other code using the file concurrently must not run at the same time.
+
+    <b>Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_array_chunked_hdf5.hxx\><br>
+    Namespace: vigra
+
+    \code
+    HDF5File file("data.h5", HDF5File::New);
+    {
+        ChunkedArrayHDF5<3, float> array(file, "volume",
+                                         Shape3(2000, 2000, 2000), Shape3(64, 64, 64),
+                                         ChunkedArrayOptions().compression(5));
+        ... // fill the array
+    }
+
+    // open the dataset again
+    ChunkedArrayHDF5<3, float> array(file, "volume", Shape3(64, 64, 64));
+    \endcode
+*/
+template <unsigned int N, class T>
+class ChunkedArrayHDF5
+: public ChunkedArray<N, T>
+{
+  public:
+    typedef ChunkedArray<N, T>              base_type;
+    typedef typename base_type::shape_type  shape_type;
+    typedef typename base_type::view_type   view_type;
+
+        /** Create a new dataset <tt>dataset</tt> in <tt>file</tt> (an existing
+            dataset of the same name is replaced).
+        */
+    ChunkedArrayHDF5(HDF5File & file, std::string const & dataset,
+                     shape_type const & shape, shape_type const & chunk_shape,
+                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : base_type(shape, chunk_shape, options),
+      file_(file),
+      dataset_(dataset)
+    {
+        threading::lock_guard<threading::mutex> lock(detail::chunkedArrayHDF5Mutex());
+        file_.createDataset<N, T>(dataset_, shape, this->fillValue(),
+                                  this->chunkShape(), options.compression_level);
+    }
+
+        /** Open the existing dataset <tt>dataset</tt> in <tt>file</tt>.
+            The chunk shape should be equal to the chunk shape of the dataset.
+        */
+    ChunkedArrayHDF5(HDF5File & file, std::string const & dataset,
+                     shape_type const & chunk_shape,
+                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : base_type(datasetShape(file, dataset), chunk_shape, options),
+      file_(file),
+      dataset_(dataset)
+    {}
+
+    ~ChunkedArrayHDF5()
+    {
+        // exceptions must not escape from the destructor,
+        // call flush() beforehand to find out about errors
+        try
+        {
+            this->releaseAllChunks();
+            threading::lock_guard<threading::mutex> lock(detail::chunkedArrayHDF5Mutex());
+            file_.flushToDisk();
+        }
+        catch(...)
+        {}
+    }
+
+        /** Name of the underlying dataset.
+        */
+    std::string const & datasetName() const
+    {
+        return dataset_;
+    }
+
+  protected:
+    virtual void loadChunk(shape_type const & chunkIndex, view_type & chunk)
+    {
+        threading::lock_guard<threading::mutex> lock(detail::chunkedArrayHDF5Mutex());
+        file_.readBlock(dataset_, chunkIndex*this->chunkShape(), chunk.shape(), chunk);
+    }
+
+    virtual void storeChunk(shape_type const & chunkIndex, view_type const & chunk)
+    {
+        threading::lock_guard<threading::mutex> lock(detail::chunkedArrayHDF5Mutex());
+        file_.writeBlock(dataset_, chunkIndex*this->chunkShape(), chunk);
+    }
+
+  private:
+    static shape_type datasetShape(HDF5File & file, std::string const & dataset)
+    {
+        threading::lock_guard<threading::mutex> lock(detail::chunkedArrayHDF5Mutex());
+        ArrayVector<hsize_t> s = file.getDatasetShape(dataset);
+        vigra_precondition(s.size() == N,
+            "ChunkedArrayHDF5(): dataset has wrong dimension.");
+        shape_type shape;
+        for(unsigned int k=0; k<N; ++k)
+            shape[k] = s[k];
+        return shape;
+    }
+
+    HDF5File & file_;
+    std::string dataset_;
+};
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_ARRAY_CHUNKED_HDF5_HXX
@@ -0,0 +1,306 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2014 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_ARRAY_MMAP_HXX
+#define VIGRA_MULTI_ARRAY_MMAP_HXX
+
+#include <string>
+#include <cstddef>
+
+#include "multi_array.hxx"
+
+#ifdef _MSC_VER
+# include "windows.h"
+#else
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace vigra {
+
+/** \brief MultiArray whose data reside in a memory-mapped raw file.
+
+    The file is interpreted as an array of the given shape and element type in
+    scan order (first index varies fastest), starting at the given byte offset
+    (e.g. to skip a file header). Mapping is instantaneous regardless of the file
+    size: the operating system loads pages lazily upon first access, keeps only
+    the recently used pages in memory, and shares them among all processes
+    mapping the same file.
+
+    The <tt>mode</tt> determines how the file is opened:
+
+    <DL>
+    <DT><b>MappedMultiArray::ReadOnly</b><DD> Open an existing file. The array may still
+            be modified, but the changes are private to this object and never written
+            to the file (copy-on-write).
+    <DT><b>MappedMultiArray::ReadWrite</b><DD> Open an existing file. Changes are written
+            to the file (at the latest when the array is destroyed) and are visible to other
+            processes mapping the same file.
+    <DT><b>MappedMultiArray::Create</b><DD> Like <tt>ReadWrite</tt>, but create the file
+            if it doesn't exist, and enlarge it if it is too small for the array.
+            Newly allocated file contents are zero.
+    </DL>
+
+    The object cannot be copied (the mapping has a unique owner). Since it is derived
+    from \ref MultiArrayView, it can be passed to all functions accepting a view.
+    Note that the byte order of the data is not converted.
+
+    <b>Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_array_mmap.hxx\><br>
+    Namespace: vigra
+
+    \code
+    // a 2048x2048x1024 float volume with a 512 byte header
+    MappedMultiArray<3, float> volume("volume.raw", Shape3(2048, 2048, 1024),
+                                      MappedMultiArray<3, float>::ReadOnly, 512);
+
+    // only the pages touched by the subarray are loaded
+    MultiArray<3, float> roi(volume.subarray(Shape3(1000, 1000, 500), Shape3(1100, 1100, 600)));
+    \endcode
+*/
+template <unsigned int N, class T>
+class MappedMultiArray
+: public MultiArrayView<N, T>
+{
+  public:
+    typedef MultiArrayView<N, T>                    view_type;
+    typedef typename view_type::difference_type     difference_type;
+
+    enum Mode { ReadOnly, ReadWrite, Create };
+
+        /** Map the file <tt>filename</tt>, interpreting the bytes starting at
+            <tt>byteOffset</tt> as an array of the given <tt>shape</tt>.
+            <tt>byteOffset</tt> must be a multiple of <tt>alignof(T)</tt>.
+        */
+    MappedMultiArray(std::string const & filename, difference_type const & shape,
+                     Mode mode = ReadOnly, std::ptrdiff_t byteOffset = 0)
+    : mode_(mode),
+      mapping_(0),
+      mapping_size_(0)
+#ifdef _MSC_VER
+      , file_(INVALID_HANDLE_VALUE),
+      map_handle_(0)
+#else
+      , file_(-1)
+#endif
+    {
+        vigra_precondition(prod(shape) > 0,
+            "MappedMultiArray(): shape must be positive.");
+        vigra_precondition(byteOffset >= 0,
+            "MappedMultiArray(): byteOffset must be non-negative.");
+        // the mapping starts at a page boundary, so the offset determines the alignment
+        vigra_precondition(byteOffset % alignof(T) == 0,
+            "MappedMultiArray(): byteOffset must be a multiple of the alignment of the element type.");
+
+        std::size_t dataSize = prod(shape)*sizeof(T);
+        try
+        {
+            map(filename, (std::size_t)byteOffset, dataSize);
+        }
+        catch(...)
+        {
+            unmap();
+            throw;
+        }
+
+        this->m_shape  = shape;
+        this->m_stride = detail::defaultStride<N>(shape);
+    }
+
+        /** Write back all changes (unless opened in <tt>ReadOnly</tt> mode)
+            and unmap the file.
+        */
+    ~MappedMultiArray()
+    {
+        unmap();
+    }
+
+        /** Write changes to the file now (no-op in <tt>ReadOnly</tt> mode).
+        */
+    void flush()
+    {
+        if(mode_ == ReadOnly)
+            return;
+#ifdef _MSC_VER
+        bool success = FlushViewOfFile(mapping_, 0) != 0;
+#else
+        bool success = msync(mapping_, mapping_size_, MS_SYNC) == 0;
+#endif
+        vigra_postcondition(success,
+            "MappedMultiArray::flush(): unable to write data to file.");
+    }
+
+        /** The mode the file was opened with.
+        */
+    Mode mode() const
+    {
+        return mode_;
+    }
+
+        /** Assign the contents of another array (the shapes must match).
+        */
+    template <class U, class Stride>
+    MappedMultiArray & operator=(MultiArrayView<N, U, Stride> const & rhs)
+    {
+        view_type::operator=(rhs);
+        return *this;
+    }
+
+  private:
+    MappedMultiArray(MappedMultiArray const &);             // not implemented
+    MappedMultiArray & operator=(MappedMultiArray const &); // not implemented
+
+#ifdef _MSC_VER
+
+    void map(std::string const & filename, std::size_t byteOffset, std::size_t dataSize)
+    {
+        DWORD access      = mode_ == ReadOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+        DWORD disposition = mode_ == Create ? OPEN_ALWAYS : OPEN_EXISTING;
+        file_ = CreateFileA(filename.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE, 0,
+                            disposition, FILE_ATTRIBUTE_NORMAL, 0);
+        vigra_precondition(file_ != INVALID_HANDLE_VALUE,
+            "MappedMultiArray(): unable to open file '" + filename + "'.");
+
+        unsigned __int64 required = (unsigned __int64)byteOffset + dataSize;
+        LARGE_INTEGER fileSize;
+        vigra_postcondition(GetFileSizeEx(file_, &fileSize) != 0,
+            "MappedMultiArray(): unable to determine file size.");
+        vigra_precondition(mode_ == Create || (unsigned __int64)fileSize.QuadPart >= required,
+            "MappedMultiArray(): file is too small for the requested shape.");
+
+        // CreateFileMapping() enlarges the file when necessary
+        DWORD protect = mode_ == ReadOnly ? PAGE_WRITECOPY : PAGE_READWRITE;
+        unsigned __int64 mapSize = std::max(required, (unsigned __int64)fileSize.QuadPart);
+        map_handle_ = CreateFileMappingA(file_, 0, protect,
+                                         (DWORD)(mapSize >> 32), (DWORD)(mapSize & 0xFFFFFFFF), 0);
+        vigra_postcondition(map_handle_ != 0,
+            "MappedMultiArray(): unable to create file mapping.");
+
+        // the offset must be a multiple of the allocation granularity
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        std::size_t alignedOffset = byteOffset - byteOffset % info.dwAllocationGranularity;
+        mapping_size_ = dataSize + (byteOffset - alignedOffset);
+        DWORD viewAccess = mode_ == ReadOnly ? FILE_MAP_COPY : FILE_MAP_WRITE;
+        mapping_ = MapViewOfFile(map_handle_, viewAccess,
+                                 (DWORD)((unsigned __int64)alignedOffset >> 32),
+                                 (DWORD)(alignedOffset & 0xFFFFFFFF), mapping_size_);
+        vigra_postcondition(mapping_ != 0,
+            "MappedMultiArray(): unable to map file into memory.");
+        this->m_ptr = reinterpret_cast<T *>(static_cast<char *>(mapping_) + (byteOffset - alignedOffset));
+    }
+
+    void unmap()
+    {
+        if(mapping_ != 0)
+            UnmapViewOfFile(mapping_);
+        if(map_handle_ != 0)
+            CloseHandle(map_handle_);
+        if(file_ != INVALID_HANDLE_VALUE)
+            CloseHandle(file_);
+        mapping_ = 0;
+        map_handle_ = 0;
+        file_ = INVALID_HANDLE_VALUE;
+        this->m_ptr = 0;
+    }
+
+#else
+
+    void map(std::string const & filename, std::size_t byteOffset, std::size_t dataSize)
+    {
+        int flags = mode_ == ReadOnly
+                       ? O_RDONLY
+                       : mode_ == ReadWrite
+                           ? O_RDWR
+                           : O_RDWR | O_CREAT;
+        file_ = open(filename.c_str(), flags, 0644);
+        vigra_precondition(file_ != -1,
+            "MappedMultiArray(): unable to open file '" + filename + "'.");
+
+        off_t required = (off_t)(byteOffset + dataSize);
+        struct stat info;
+        vigra_postcondition(fstat(file_, &info) == 0,
+            "MappedMultiArray(): unable to determine file size.");
+        if(info.st_size < required)
+        {
+            vigra_precondition(mode_ == Create,
+                "MappedMultiArray(): file is too small for the requested shape.");
+            vigra_postcondition(ftruncate(file_, required) == 0,
+                "MappedMultiArray(): unable to enlarge file.");
+        }
+
+        // the offset must be a multiple of the page size
+        std::size_t pageSize = (std::size_t)sysconf(_SC_PAGESIZE);
+        std::size_t alignedOffset = byteOffset - byteOffset % pageSize;
+        mapping_size_ = dataSize + (byteOffset - alignedOffset);
+        void * mapping = mmap(0, mapping_size_, PROT_READ | PROT_WRITE,
+                              mode_ == ReadOnly ? MAP_PRIVATE : MAP_SHARED,
+                              file_, (off_t)alignedOffset);
+        vigra_postcondition(mapping != MAP_FAILED,
+            "MappedMultiArray(): unable to map file into memory.");
+        mapping_ = mapping;
+        this->m_ptr = reinterpret_cast<T *>(static_cast<char *>(mapping_) + (byteOffset - alignedOffset));
+    }
+
+    void unmap()
+    {
+        if(mapping_ != 0)
+            munmap(mapping_, mapping_size_);
+        if(file_ != -1)
+            close(file_);
+        mapping_ = 0;
+        file_ = -1;
+        this->m_ptr = 0;
+    }
+
+#endif
+
+    Mode mode_;
+    void * mapping_;
+    std::size_t mapping_size_;
+#ifdef _MSC_VER
+    HANDLE file_, map_handle_;
+#else
+    int file_;
+#endif
+};
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_ARRAY_MMAP_HXX
@@ -38,6 +38,8 @@
 #ifndef VIGRA_MULTI_CONVOLUTION_H
 #define VIGRA_MULTI_CONVOLUTION_H
 
+#include <functional>
+#include <utility>
 #include "separableconvolution.hxx"
 #include "array_vector.hxx"
 #include "multi_array.hxx"
@@ -49,6 +51,7 @@
 #include "functorexpression.hxx"
 #include "tinyvector.hxx"
 #include "algorithm.hxx"
+#include "threadpool.hxx"
 
 namespace vigra
 {
@@ -332,13 +335,16 @@ class ConvolutionOptions
     ParamVec outer_scale;
     double window_ratio;
     Shape from_point, to_point;
+    Shape block_shape;
+    int n_threads;
      
     ConvolutionOptions()
     : sigma_eff(0.0),
       sigma_d(0.0),
       step_size(1.0),
       outer_scale(0.0),
-      window_ratio(0.0)
+      window_ratio(0.0),
+      n_threads(1)
     {}
 
     typedef typename detail::WrapDoubleIteratorTriple<ParamIt, ParamIt, ParamIt>
@@ -482,6 +488,45 @@ class ConvolutionOptions
         to_point = to;
         return *this;
     }
+
+        /** Number of threads used for the convolution. 
+
+            If <tt>n > 1</tt>, the array is split into blocks (see blockShape())
+            which are processed concurrently. Each block is enlarged by a halo
+            of the kernel radius, so that the result is bit-identical to the
+            single-threaded computation on the entire array. When a subarray() 
+            is given, the single-threaded computation processes the axes in a 
+            different order, so that the results are only identical up to rounding.
+            The special values <tt>ParallelOptions::Auto</tt>
+            and <tt>ParallelOptions::Nice</tt> select the global default number of 
+            threads and half the number of hardware threads respectively 
+            (see \ref ParallelOptions). The multi-threaded convolution
+            cannot work in-place. When the source and destination arrays overlap,
+            the single-threaded computation is used instead.
+            
+            Default: <tt>1</tt> (i.e. single-threaded computation)
+        */
+    ConvolutionOptions<dim> & numThreads(int n)
+    {
+        n_threads = n;
+        return *this;
+    }
+
+        /** Shape of the blocks used by multi-threaded convolution (see numThreads()). 
+
+            Larger blocks reduce the overhead of the halo around each block, 
+            smaller blocks balance the load between the threads better.
+            
+            Default: <tt>Shape()</tt> (i.e. 128 pixels along each axis)
+        */
+    ConvolutionOptions<dim> & blockShape(Shape const & shape)
+    {
+        for(int k=0; k<(int)dim; ++k)
+            vigra_precondition(shape[k] >= 0,
+                "ConvolutionOptions::blockShape(): block shape must not be negative.");
+        block_shape = shape;
+        return *this;
+    }
 };
 
 namespace detail
@@ -645,6 +690,120 @@ internalSeparableConvolveSubarray(
     copyMultiArray(tmp.traverser_begin()+dstart, stop-start, acc, di, dest);              
 }
 
+/********************************************************/
+/*                                                      */
+/*         internalSeparableConvolveBlockwise           */
+/*                                                      */
+/********************************************************/
+
+    // Convolve the block [start, stop) of the source array. The block is
+    // enlarged by the kernel radius (clipped at the array border) so that 
+    // all pixels inside the block are computed exactly as in 
+    // internalSeparableConvolveMultiArrayTmp() on the entire array.
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+internalSeparableConvolveBlock(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest, KernelIterator kit,
+                      SrcShape const & start, SrcShape const & stop)
+{
+    enum { N = 1 + SrcIterator::level };
+
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAcessor;
+
+    SrcShape hstart, hstop;
+    for(int k=0; k<N; ++k)
+    {
+        MultiArrayIndex radius = std::max(-kit[k].left(), kit[k].right());
+        hstart[k] = start[k] - radius;
+        hstop[k]  = stop[k] + radius;
+        // keep the window size when the halo is clipped at one border, 
+        // so that the kernel always fits into the enlarged block
+        if(hstart[k] < 0)
+        {
+            hstop[k] -= hstart[k];
+            hstart[k] = 0;
+        }
+        if(hstop[k] > shape[k])
+        {
+            hstart[k] = std::max<MultiArrayIndex>(0, hstart[k] - (hstop[k] - shape[k]));
+            hstop[k] = shape[k];
+        }
+    }
+
+    MultiArray<N, TmpType> tmp(hstop - hstart);
+    internalSeparableConvolveMultiArrayTmp(si + hstart, hstop - hstart, src,
+                                           tmp.traverser_begin(), TmpAcessor(), kit);
+    copyMultiArray(tmp.traverser_begin() + (start - hstart), stop - start, TmpAcessor(),
+                   di, dest);
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+internalSeparableConvolveBlockwise(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest, KernelIterator kit,
+                      SrcShape const & start, SrcShape const & stop,
+                      SrcShape blockShape, int nThreads)
+{
+    enum { N = 1 + SrcIterator::level };
+
+    for(int k=0; k<N; ++k)
+    {
+        BorderTreatmentMode border = kit[k].borderTreatment();
+        vigra_precondition(border != BORDER_TREATMENT_AVOID && border != BORDER_TREATMENT_WRAP,
+            "separableConvolveMultiArray(): multi-threaded convolution does not support "
+            "BORDER_TREATMENT_AVOID and BORDER_TREATMENT_WRAP.");
+    }
+
+    for(int k=0; k<N; ++k)
+        if(blockShape[k] == 0)
+            blockShape[k] = 128;
+
+    parallel_foreach_block(ParallelOptions().numThreads(nThreads), start, stop, blockShape,
+        [&](int, SrcShape const & bstart, SrcShape const & bstop)
+        {
+            internalSeparableConvolveBlock(si, shape, src, di + (bstart - start), dest, kit,
+                                           bstart, bstop);
+        });
+}
+
+    // Determine whether the memory spanned by the source and destination arrays overlaps.
+    // The extremal addresses of a strided array are attained at its corners.
+template <class Iterator, class Shape>
+std::pair<char const *, char const *>
+memoryRangeOfArray(Iterator i, Shape const & shape)
+{
+    enum { N = Shape::static_size };
+    std::less<char const *> less;
+    char const * first = reinterpret_cast<char const *>(&*i);
+    char const * last = first;
+    for(int corner = 1; corner < (1 << N); ++corner)
+    {
+        Shape p;
+        for(int k=0; k<N; ++k)
+            p[k] = (corner & (1 << k)) ? shape[k] - 1 : 0;
+        char const * a = reinterpret_cast<char const *>(&i[p]);
+        if(less(a, first))
+            first = a;
+        if(less(last, a))
+            last = a;
+    }
+    return std::make_pair(first, last + sizeof(*i));
+}
+
+template <class SrcIterator, class SrcShape, class DestIterator, class DestShape>
+bool
+arraysOverlap(SrcIterator s, SrcShape const & sshape, DestIterator d, DestShape const & dshape)
+{
+    std::pair<char const *, char const *> srange = memoryRangeOfArray(s, sshape),
+                                          drange = memoryRangeOfArray(d, dshape);
+    std::less<char const *> less;
+    return less(srange.first, drange.second) && less(drange.first, srange.second);
+}
 
 template <class K>
 void 
@@ -698,6 +857,18 @@ scaleKernel(K & kernel, double a)
     subarray, and it is assumed that the output array only refers to the
     subarray (i.e. <tt>diter</tt> points to the element corresponding to 
     <tt>start</tt>). 
+    
+    When the subarray and a number of threads are passed via \ref ConvolutionOptions
+    (see \ref ConvolutionOptions::numThreads() and \ref ConvolutionOptions::blockShape()),
+    the array is split into blocks which are convolved concurrently. Each block is
+    enlarged by a halo of the kernel radius, so that the result is bit-identical 
+    to the single-threaded computation on the entire array. When a subarray is given,
+    the result is identical to the single-threaded subarray computation up to rounding, 
+    because the latter processes the axes in a different order. 
+    This variant cannot work in-place, so it
+    falls back to the single-threaded computation when the source and destination
+    arrays overlap. It does not support the border treatment modes <tt>BORDER_TREATMENT_AVOID</tt> 
+    and <tt>BORDER_TREATMENT_WRAP</tt>.
 
     <b> Declarations:</b>
 
@@ -723,6 +894,15 @@ scaleKernel(K & kernel, double a)
                                     KernelIterator kernels,
                                     SrcShape const & start = SrcShape(),
                                     SrcShape const & stop = SrcShape());
+
+        // take subarray and multi-threading parameters from 'opt'
+        template <class SrcIterator, class SrcShape, class SrcAccessor,
+                  class DestIterator, class DestAccessor, class KernelIterator>
+        void
+        separableConvolveMultiArray(SrcIterator siter, SrcShape const & shape, SrcAccessor src,
+                                    DestIterator diter, DestAccessor dest,
+                                    KernelIterator kernels,
+                                    ConvolutionOptions<N> const & opt);
     }
     \endcode
 
@@ -768,6 +948,11 @@ scaleKernel(K & kernel, double a)
     // perform Gaussian smoothing on all dimensions
     separableConvolveMultiArray(srcMultiArrayRange(source), destMultiArray(dest), 
                                 kernels.begin());
+                                
+    // the same, using 8 threads and blocks of size 64^3
+    separableConvolveMultiArray(srcMultiArrayRange(source), destMultiArray(dest), 
+                                kernels.begin(), 
+                                ConvolutionOptions<3>().numThreads(8).blockShape(Shape3(64)));
     \endcode
 
     <b> Required Interface:</b>
@@ -861,6 +1046,87 @@ separableConvolveMultiArray(triple<SrcIterator, SrcShape, SrcAccessor> const & s
                                  dest.first, dest.second, kernels.begin(), start, stop);
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+separableConvolveMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                             DestIterator d, DestAccessor dest, 
+                             KernelIterator kernels,
+                             ConvolutionOptions<SrcShape::static_size> const & opt)
+{
+    enum { N = SrcShape::static_size };
+
+    SrcShape start(opt.from_point), stop(opt.to_point);
+    SrcShape destShape = (stop != SrcShape())
+                             ? stop - start
+                             : shape;
+
+    // the multi-threaded computation cannot work in-place, fall back to the serial one
+    if(opt.n_threads == 0 || opt.n_threads == 1 ||
+       detail::arraysOverlap(s, shape, d, destShape))
+    {
+        separableConvolveMultiArray(s, shape, src, d, dest, kernels, opt.from_point, opt.to_point);
+        return;
+    }
+
+    for(int k=0; k<N; ++k)
+        if(shape[k] <= 0)
+            return;
+
+    if(stop != SrcShape())
+    {
+        for(int k=0; k<N; ++k)
+            vigra_precondition(0 <= start[k] && start[k] < stop[k] && stop[k] <= shape[k],
+              "separableConvolveMultiArray(): invalid subarray shape.");
+    }
+    else
+    {
+        start = SrcShape();
+        stop = shape;
+    }
+    detail::internalSeparableConvolveBlockwise(s, shape, src, d, dest, kernels, 
+                                               start, stop, opt.block_shape, opt.n_threads);
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+inline void
+separableConvolveMultiArray(triple<SrcIterator, SrcShape, SrcAccessor> const & source,
+                            pair<DestIterator, DestAccessor> const & dest, 
+                            KernelIterator kit,
+                            ConvolutionOptions<SrcShape::static_size> const & opt)
+{
+    separableConvolveMultiArray( source.first, source.second, source.third,
+                                 dest.first, dest.second, kit, opt );
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class T>
+inline void
+separableConvolveMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                             DestIterator d, DestAccessor dest,
+                             Kernel1D<T> const & kernel,
+                             ConvolutionOptions<SrcShape::static_size> const & opt)
+{
+    ArrayVector<Kernel1D<T> > kernels(shape.size(), kernel);
+
+    separableConvolveMultiArray( s, shape, src, d, dest, kernels.begin(), opt);
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class T>
+inline void
+separableConvolveMultiArray(triple<SrcIterator, SrcShape, SrcAccessor> const & source,
+                            pair<DestIterator, DestAccessor> const & dest,
+                            Kernel1D<T> const & kernel,
+                            ConvolutionOptions<SrcShape::static_size> const & opt)
+{
+    ArrayVector<Kernel1D<T> > kernels(source.second.size(), kernel);
+
+    separableConvolveMultiArray( source.first, source.second, source.third,
+                                 dest.first, dest.second, kernels.begin(), opt);
+}
+
 /********************************************************/
 /*                                                      */
 /*            convolveMultiArrayOneDimension            */
@@ -1068,6 +1334,14 @@ convolveMultiArrayOneDimension(triple<SrcIterator, SrcShape, SrcAccessor> const
                              ConvolutionOptions<3>().stepSize(step_size).resolutionStdDev(resolution_sigmas));
     \endcode
 
+    <b> Multi-threaded usage:</b>
+
+    \code
+    // smooth with 8 threads, processing blocks of size 128^3 concurrently
+    gaussianSmoothMultiArray(srcMultiArrayRange(source), destMultiArray(dest), sigma,
+                             ConvolutionOptions<3>().numThreads(8).blockShape(Shape3(128)));
+    \endcode
+
     \see separableConvolveMultiArray()
 */
 doxygen_overloaded_function(template <...> void gaussianSmoothMultiArray)
@@ -1090,7 +1364,7 @@ gaussianSmoothMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src
     for (int dim = 0; dim < N; ++dim, ++params)
         kernels[dim].initGaussian(params.sigma_scaled(function_name), 1.0, opt.window_ratio);
 
-    separableConvolveMultiArray(s, shape, src, d, dest, kernels.begin(), opt.from_point, opt.to_point);
+    separableConvolveMultiArray(s, shape, src, d, dest, kernels.begin(), opt);
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -1256,8 +1530,7 @@ gaussianGradientMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor s
         ArrayVector<Kernel1D<KernelType> > kernels(plain_kernels);
         kernels[dim].initGaussianDerivative(params2.sigma_scaled(), 1, 1.0, opt.window_ratio);
         detail::scaleKernel(kernels[dim], 1.0 / params2.step_size());
-        separableConvolveMultiArray(si, shape, src, di, ElementAccessor(dim, dest), kernels.begin(), 
-                                    opt.from_point, opt.to_point);
+        separableConvolveMultiArray(si, shape, src, di, ElementAccessor(dim, dest), kernels.begin(), opt);
     }
 }
 
@@ -1559,13 +1832,13 @@ laplacianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccesso
         if (dim == 0)
         {
             separableConvolveMultiArray( si, shape, src, 
-                                         di, dest, kernels.begin(), opt.from_point, opt.to_point);
+                                         di, dest, kernels.begin(), opt);
         }
         else
         {
             separableConvolveMultiArray( si, shape, src, 
                                          derivative.traverser_begin(), DerivativeAccessor(), 
-                                         kernels.begin(), opt.from_point, opt.to_point);
+                                         kernels.begin(), opt);
             combineTwoMultiArrays(di, dshape, dest, derivative.traverser_begin(), DerivativeAccessor(), 
                                   di, dest, Arg1() + Arg2() );
         }
@@ -1746,7 +2019,7 @@ hessianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor
             detail::scaleKernel(kernels[i], 1 / params_i.step_size());
             detail::scaleKernel(kernels[j], 1 / params_j.step_size());
             separableConvolveMultiArray(si, shape, src, di, ElementAccessor(b, dest),
-                                        kernels.begin(), opt.from_point, opt.to_point);
+                                        kernels.begin(), opt);
         }
     }
 }
@@ -47,6 +47,8 @@
 #include "metaprogramming.hxx"
 #include "multi_pointoperators.hxx"
 #include "functorexpression.hxx"
+#include "threadpool.hxx"
+#include "static_assert.hxx"
 
 namespace vigra
 {
@@ -148,66 +150,73 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 void internalSeparableMultiArrayDistTmp(
                       SrcIterator si, SrcShape const & shape, SrcAccessor src,
-                      DestIterator di, DestAccessor dest, Array const & sigmas, bool invert)
+                      DestIterator di, DestAccessor dest, Array const & sigmas, bool invert,
+                      ParallelOptions const & options)
 {
     // Sigma is the spread of the parabolas. It determines the structuring element size
     // for ND morphology. When calculating the distance transforms, sigma is usually set to 1,
     // unless one wants to account for anisotropic pixel pitch
     enum { N =  SrcShape::static_size};
+    typedef typename MultiArrayShape<N>::type Shape;
 
     // we need the Promote type here if we want to invert the image (dilation)
     typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
-    
-    // temporary array to hold the current line to enable in-place operation
-    ArrayVector<TmpType> tmp( shape[0] );
-
-    typedef MultiArrayNavigator<SrcIterator, N> SNavigator;
-    typedef MultiArrayNavigator<DestIterator, N> DNavigator;
-    
-    
-    // only operate on first dimension here
-    SNavigator snav( si, shape, 0 );
-    DNavigator dnav( di, shape, 0 );
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAccessor;
+    typedef typename AccessorTraits<TmpType>::default_const_accessor TmpConstAccessor;
 
     using namespace vigra::functor;
 
-    for( ; snav.hasMore(); snav++, dnav++ )
-    {
-            // first copy source to temp for maximum cache efficiency
-            // Invert the values if necessary. Only needed for grayscale morphology
-            if(invert)
-                transformLine( snav.begin(), snav.end(), src, tmp.begin(),
-                               typename AccessorTraits<TmpType>::default_accessor(), 
-                               Param(NumericTraits<TmpType>::zero())-Arg1());
-            else
-                copyLine( snav.begin(), snav.end(), src, tmp.begin(),
-                          typename AccessorTraits<TmpType>::default_accessor() );
+    // the lines of each dimension are independent and processed in parallel,
+    // every thread holds a temporary line to enable in-place operation
+    ThreadPool pool(options);
+    ArrayVector<ArrayVector<TmpType> > tmp(std::max<std::size_t>(pool.numThreads(), 1));
 
-            detail::distParabola( srcIterRange(tmp.begin(), tmp.end(),
-                          typename AccessorTraits<TmpType>::default_const_accessor()),
-                          destIter( dnav.begin(), dest ), sigmas[0] );
-    }
-    
-    // operate on further dimensions
-    for( int d = 1; d < N; ++d )
+    for( int d = 0; d < N; ++d )
     {
-        DNavigator dnav( di, shape, d );
-
-        tmp.resize( shape[d] );
-        
+        // enumerate the lines along dimension d by their starting points
+        Shape lineStarts(shape);
+        lineStarts[d] = 1;
 
-        for( ; dnav.hasMore(); dnav++ )
-        {
-             // first copy source to temp for maximum cache efficiency
-             copyLine( dnav.begin(), dnav.end(), dest,
-                       tmp.begin(), typename AccessorTraits<TmpType>::default_accessor() );
-
-             detail::distParabola( srcIterRange(tmp.begin(), tmp.end(),
-                           typename AccessorTraits<TmpType>::default_const_accessor()),
-                           destIter( dnav.begin(), dest ), sigmas[d] );
-        }
+        parallel_foreach(pool, prod(lineStarts),
+            [&](int thread, MultiArrayIndex k)
+            {
+                Shape start;
+                ScanOrderToCoordinate<N>::exec(k, lineStarts, start);
+                ArrayVector<TmpType> & line = tmp[thread];
+                line.resize(shape[d]);
+                typename DestIterator::iterator dline = (di + start).iteratorForDimension(d);
+
+                // first copy source to temp for maximum cache efficiency
+                if(d == 0)
+                {
+                    typename SrcIterator::iterator sline = (si + start).iteratorForDimension(0);
+                    // Invert the values if necessary. Only needed for grayscale morphology
+                    if(invert)
+                        transformLine( sline, sline + shape[0], src, line.begin(), TmpAccessor(), 
+                                       Param(NumericTraits<TmpType>::zero())-Arg1());
+                    else
+                        copyLine( sline, sline + shape[0], src, line.begin(), TmpAccessor() );
+                }
+                else
+                {
+                    copyLine( dline, dline + shape[d], dest, line.begin(), TmpAccessor() );
+                }
+
+                detail::distParabola( srcIterRange(line.begin(), line.end(), TmpConstAccessor()),
+                                      destIter( dline, dest ), sigmas[d] );
+            });
     }
-    if(invert) transformMultiArray( di, shape, dest, di, dest, -Arg1());
+    if(invert) transformMultiArray( di, shape, dest, di, dest, -Arg1(), options);
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline void internalSeparableMultiArrayDistTmp(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest, Array const & sigmas, bool invert)
+{
+    internalSeparableMultiArrayDistTmp( si, shape, src, di, dest, sigmas, invert,
+                                        ParallelOptions().numThreads(ParallelOptions::NoThreads) );
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -297,6 +306,33 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
     }
     \endcode
 
+    pass arrays directly and/or execute in parallel:
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class T2, class S2, class Array>
+        void 
+        separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                                  MultiArrayView<N, T2, S2> dest, bool background,
+                                  Array const & pixelPitch,
+                                  ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void 
+        separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                                  MultiArrayView<N, T2, S2> dest, bool background,
+                                  ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        // likewise for the iterator-based variants with pixel pitch
+        template <class SrcIterator, class SrcShape, class SrcAccessor,
+                  class DestIterator, class DestAccessor, class Array>
+        void 
+        separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                                   DestIterator d, DestAccessor dest, 
+                                   bool background,
+                                   Array const & pixelPitch, ParallelOptions const & options);
+    }
+    \endcode
+
     This function performs a squared Euclidean squared distance transform on the given
     multi-dimensional array. Both source and destination
     arrays are represented by iterators, shape objects and accessors.
@@ -316,7 +352,13 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
     A full-sized internal array is only allocated if working on the destination
     array directly would cause overflow errors (i.e. if
     <tt> NumericTraits<typename DestAccessor::value_type>::max() < N * M*M</tt>, where M is the
-    size of the largest dimension of the array.
+    size of the largest dimension of the array. Thus, floating-point destinations 
+    (e.g. <tt>float</tt>) are always computed in-place and need the least memory.
+    
+    The transform consists of one pass per dimension, and the 1D transforms along 
+    the lines of each pass are independent. When \ref ParallelOptions are passed, 
+    the lines are distributed among the given number of threads (each thread 
+    uses its own line buffer). The result is identical to the sequential computation.
 
     <b> Usage:</b>
 
@@ -340,7 +382,7 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccessor src,
                                 DestIterator d, DestAccessor dest, bool background,
-                                Array const & pixelPitch)
+                                Array const & pixelPitch, ParallelOptions const & options)
 {
     int N = shape.size();
 
@@ -361,8 +403,11 @@ void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccess
             
     using namespace vigra::functor;
    
-    if(dmax > NumericTraits<DestType>::toRealPromote(NumericTraits<DestType>::max()) 
-       || pixelPitchIsReal) // need a temporary array to avoid overflows
+    // floating point destinations neither overflow nor round, so that
+    // they never need a temporary array of the promoted type
+    if(NumericTraits<DestType>::isIntegral::asBool &&
+       (dmax > NumericTraits<DestType>::toRealPromote(NumericTraits<DestType>::max()) 
+        || pixelPitchIsReal)) // need a temporary array to avoid overflows
     {
         // Threshold the values so all objects have infinity value in the beginning
         Real maxDist = (Real)dmax, rzero = (Real)0.0;
@@ -370,16 +415,16 @@ void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccess
         if(background == true)
             transformMultiArray( s, shape, src, 
                                  tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
-                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
+                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ), options);
         else
             transformMultiArray( s, shape, src, 
                                  tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
-                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
+                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ), options);
         
         detail::internalSeparableMultiArrayDistTmp( tmpArray.traverser_begin(), 
                 shape, typename AccessorTraits<Real>::default_accessor(),
                 tmpArray.traverser_begin(), 
-                typename AccessorTraits<Real>::default_accessor(), pixelPitch);
+                typename AccessorTraits<Real>::default_accessor(), pixelPitch, false, options);
         
         copyMultiArray(srcMultiArrayRange(tmpArray), destIter(d, dest));
     }
@@ -389,15 +434,25 @@ void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccess
         DestType maxDist = DestType(std::ceil(dmax)), rzero = (DestType)0;
         if(background == true)
             transformMultiArray( s, shape, src, d, dest,
-                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
+                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ), options);
         else
             transformMultiArray( s, shape, src, d, dest, 
-                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
+                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ), options);
      
-        detail::internalSeparableMultiArrayDistTmp( d, shape, dest, d, dest, pixelPitch);
+        detail::internalSeparableMultiArrayDistTmp( d, shape, dest, d, dest, pixelPitch, false, options);
     }
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                                       DestIterator d, DestAccessor dest, bool background,
+                                       Array const & pixelPitch)
+{
+    separableMultiDistSquared( s, shape, src, d, dest, background, pixelPitch,
+                               ParallelOptions().numThreads(ParallelOptions::NoThreads) );
+}
+
 template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 inline void separableMultiDistSquared( triple<SrcIterator, SrcShape, SrcAccessor> const & source,
@@ -408,6 +463,16 @@ inline void separableMultiDistSquared( triple<SrcIterator, SrcShape, SrcAccessor
                                dest.first, dest.second, background, pixelPitch );
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline void separableMultiDistSquared( triple<SrcIterator, SrcShape, SrcAccessor> const & source,
+                                       pair<DestIterator, DestAccessor> const & dest, bool background,
+                                       Array const & pixelPitch, ParallelOptions const & options)
+{
+    separableMultiDistSquared( source.first, source.second, source.third,
+                               dest.first, dest.second, background, pixelPitch, options );
+}
+
 template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor>
 inline 
@@ -427,6 +492,26 @@ inline void separableMultiDistSquared( triple<SrcIterator, SrcShape, SrcAccessor
                                dest.first, dest.second, background );
 }
 
+template <unsigned int N, class T1, class S1, class T2, class S2, class Array>
+inline void separableMultiDistSquared( MultiArrayView<N, T1, S1> const & source,
+                                       MultiArrayView<N, T2, S2> dest, bool background,
+                                       Array const & pixelPitch,
+                                       ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistSquared(): shape mismatch between input and output.");
+    separableMultiDistSquared( srcMultiArrayRange(source), destMultiArray(dest), 
+                               background, pixelPitch, options );
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+inline void separableMultiDistSquared( MultiArrayView<N, T1, S1> const & source,
+                                       MultiArrayView<N, T2, S2> dest, bool background,
+                                       ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    separableMultiDistSquared( source, dest, background, ArrayVector<double>(N, 1.0), options );
+}
+
 /********************************************************/
 /*                                                      */
 /*             separableMultiDistance                   */
@@ -483,10 +568,30 @@ inline void separableMultiDistSquared( triple<SrcIterator, SrcShape, SrcAccessor
     }
     \endcode
 
+    pass arrays directly and/or execute in parallel:
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class T2, class S2, class Array>
+        void 
+        separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, T2, S2> dest, bool background,
+                               Array const & pixelPitch,
+                               ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void 
+        separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, T2, S2> dest, bool background,
+                               ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+    }
+    \endcode
+
     This function performs a Euclidean distance transform on the given
     multi-dimensional array. It simply calls \ref separableMultiDistSquared()
     and takes the pixel-wise square root of the result. See \ref separableMultiDistSquared()
-    for more documentation.
+    for more documentation, including the multi-threaded execution. A <tt>float</tt> 
+    destination array is recommended for large data, because no temporary 
+    array is needed in this case.
     
     <b> Usage:</b>
 
@@ -500,6 +605,9 @@ inline void separableMultiDistSquared( triple<SrcIterator, SrcShape, SrcAccessor
 
     // Calculate Euclidean distance squared for all background pixels 
     separableMultiDistance(srcMultiArrayRange(source), destMultiArray(dest), true);
+
+    // the same with 8 threads
+    separableMultiDistance(source, dest, true, ParallelOptions().numThreads(8));
     \endcode
 
     \see vigra::distanceTransform(), vigra::separableMultiDistSquared()
@@ -510,14 +618,24 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 void separableMultiDistance( SrcIterator s, SrcShape const & shape, SrcAccessor src,
                              DestIterator d, DestAccessor dest, bool background,
-                             Array const & pixelPitch)
+                             Array const & pixelPitch, ParallelOptions const & options)
 {
-    separableMultiDistSquared( s, shape, src, d, dest, background, pixelPitch);
+    separableMultiDistSquared( s, shape, src, d, dest, background, pixelPitch, options);
     
     // Finally, calculate the square root of the distances
     using namespace vigra::functor;
    
-    transformMultiArray( d, shape, dest, d, dest, sqrt(Arg1()) );
+    transformMultiArray( d, shape, dest, d, dest, sqrt(Arg1()), options );
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline void separableMultiDistance( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                                    DestIterator d, DestAccessor dest, bool background,
+                                    Array const & pixelPitch)
+{
+    separableMultiDistance( s, shape, src, d, dest, background, pixelPitch,
+                            ParallelOptions().numThreads(ParallelOptions::NoThreads) );
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -552,6 +670,262 @@ inline void separableMultiDistance( triple<SrcIterator, SrcShape, SrcAccessor> c
                             dest.first, dest.second, background );
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline void separableMultiDistance( triple<SrcIterator, SrcShape, SrcAccessor> const & source,
+                                    pair<DestIterator, DestAccessor> const & dest, bool background,
+                                    Array const & pixelPitch, ParallelOptions const & options)
+{
+    separableMultiDistance( source.first, source.second, source.third,
+                            dest.first, dest.second, background, pixelPitch, options );
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class Array>
+inline void separableMultiDistance( MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest, bool background,
+                                    Array const & pixelPitch,
+                                    ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistance(): shape mismatch between input and output.");
+    separableMultiDistance( srcMultiArrayRange(source), destMultiArray(dest), 
+                            background, pixelPitch, options );
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+inline void separableMultiDistance( MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest, bool background,
+                                    ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    separableMultiDistance( source, dest, background, ArrayVector<double>(N, 1.0), options );
+}
+
+/********************************************************/
+/*                                                      */
+/*             separableVectorDistance                  */
+/*                                                      */
+/********************************************************/
+
+namespace detail
+{
+
+struct VectorialDistParabolaStackEntry
+{
+    double left, height;
+    MultiArrayIndex apex;
+    
+    VectorialDistParabolaStackEntry(double l, double h, MultiArrayIndex a)
+    : left(l), height(h), apex(a)
+    {}
+};
+
+    // Lower envelope of the parabolas centered at the finite points of 'line'
+    // along the given dimension. Each parabola's height is the squared length
+    // of the vector at its center, and the output vector is the vector of the 
+    // lowest parabola, with the offset along 'dimension' added.
+template <class Vector, class Array, class DestLine>
+void vectorialDistParabola(int dimension, ArrayVector<Vector> const & line, 
+                           Array const & pixelPitch, Vector const & infinity,
+                           ArrayVector<VectorialDistParabolaStackEntry> & stack,
+                           DestLine dest)
+{
+    typedef VectorialDistParabolaStackEntry Influence;
+    
+    double w2 = sq(pixelPitch[dimension]);
+    MultiArrayIndex size = line.size();
+    
+    stack.clear();
+    for(MultiArrayIndex i = 0; i < size; ++i)
+    {
+        if(line[i] == infinity) // no target found yet
+            continue;
+        double height = 0.0;
+        for(int k = 0; k < Vector::static_size; ++k)
+            height += sq(pixelPitch[k]*line[i][k]);
+        
+        double left = -NumericTraits<double>::max();
+        while(!stack.empty())
+        {
+            // the new parabola is lower than the top one right of 'intersection'
+            Influence & s = stack.back();
+            double intersection = (height - s.height + w2*(sq((double)i) - sq((double)s.apex))) 
+                                    / (2.0*w2*(i - s.apex));
+            if(intersection <= s.left) // top parabola is nowhere lowest
+            {
+                stack.pop_back();
+            }
+            else
+            {
+                left = intersection;
+                break;
+            }
+        }
+        stack.push_back(Influence(left, height, i));
+    }
+    
+    if(stack.empty()) // no target on this line, keep infinity
+        return;
+    
+    unsigned int current = 0;
+    for(MultiArrayIndex x = 0; x < size; ++x)
+    {
+        while(current + 1 < stack.size() && stack[current+1].left <= x)
+            ++current;
+        Vector v = line[stack[current].apex];
+        v[dimension] = typename Vector::value_type(stack[current].apex - x);
+        dest[x] = v;
+    }
+}
+
+template <class T>
+struct separableVectorDistance_error__offset_type_must_be_signed
+: staticAssert::Assert<typename NumericTraits<T>::isSigned>
+{};
+
+} // namespace detail
+
+/** \brief Compute the offset to the nearest target pixel on multi-dimensional arrays.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class T2, class S2, class Array>
+        void 
+        separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                                MultiArrayView<N, TinyVector<T2, N>, S2> dest, 
+                                bool background, Array const & pixelPitch,
+                                ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void 
+        separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                                MultiArrayView<N, TinyVector<T2, N>, S2> dest, 
+                                bool background,
+                                ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+    }
+    \endcode
+
+    This function computes a vectorial distance transform: instead of the distance itself
+    (as in \ref separableMultiDistance()), it stores in every pixel the offset (in pixels)
+    to the nearest target pixel, such that <tt>p + dest[p]</tt> is the coordinate of the 
+    target closest to <tt>p</tt>. Like \ref separableMultiDistSquared(), the source is 
+    interpreted as a mask where background pixels are zero. If <i>background</i> is 
+    true, the targets are the object (non-zero) pixels, and the offsets of all background 
+    pixels to the nearest object are computed. Otherwise, the offsets of all object pixels 
+    to the nearest background pixel are computed. Target pixels receive a zero offset.
+    
+    The algorithm uses the same separable parabola envelopes as \ref separableMultiDistSquared(),
+    but each parabola carries the offset of its center, so that the nearest target is 
+    known after a single pass per dimension. The Euclidean length of the offsets 
+    (weighted by the optional <tt>pixelPitch</tt>) equals the distance computed by 
+    \ref separableMultiDistance() (if several targets have the same distance, 
+    any of them may be returned). The pixels of each pass can be processed in parallel
+    by passing \ref ParallelOptions. The destination's value type <tt>T2</tt> must be 
+    a signed type that can represent the largest distance. If the source contains 
+    no target at all, the offsets are undefined.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_distance.hxx\>
+
+    \code
+    MultiArray<3, UInt32> seeds(Shape3(width, height, depth));
+    MultiArray<3, TinyVector<Int32, 3> > offsets(seeds.shape());
+    ...
+
+    // offsets of all pixels to the nearest seed, using 4 threads
+    separableVectorDistance(seeds, offsets, true, ParallelOptions().numThreads(4));
+    
+    // propagate the seed labels to all pixels (i.e. compute the Voronoi tesselation)
+    MultiArray<3, UInt32> voronoi(seeds.shape());
+    for(int z=0; z<depth; ++z)
+        for(int y=0; y<height; ++y)
+            for(int x=0; x<width; ++x)
+                voronoi(x,y,z) = seeds[Shape3(x,y,z) + offsets(x,y,z)];
+    \endcode
+
+    \see vigra::separableMultiDistance()
+*/
+doxygen_overloaded_function(template <...> void separableVectorDistance)
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class Array>
+void separableVectorDistance( MultiArrayView<N, T1, S1> const & source,
+                              MultiArrayView<N, TinyVector<T2, (int)N>, S2> dest, 
+                              bool background, Array const & pixelPitch,
+                              ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    typedef TinyVector<T2, (int)N> Vector;
+    typedef T2 OffsetType;
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef MultiArrayView<1, Vector, StridedArrayTag> DestLine;
+
+    // offsets point in both directions
+    VIGRA_STATIC_ASSERT((detail::separableVectorDistance_error__offset_type_must_be_signed<T2>));
+
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableVectorDistance(): shape mismatch between input and output.");
+        
+    Shape shape(source.shape());
+    double dmax = 0.0, minPitch = NumericTraits<double>::max();
+    for(int k = 0; k < (int)N; ++k)
+    {
+        vigra_precondition(pixelPitch[k] > 0.0,
+            "separableVectorDistance(): pixel pitch must be positive.");
+        dmax += sq(pixelPitch[k]*shape[k]);
+        minPitch = std::min<double>(minPitch, pixelPitch[k]);
+    }
+    // pixels without a target so far get an offset longer than all possible distances
+    double maxOffset = std::ceil(std::sqrt(dmax) / minPitch) + 1.0;
+    vigra_precondition(maxOffset <= NumericTraits<OffsetType>::toRealPromote(NumericTraits<OffsetType>::max()),
+        "separableVectorDistance(): destination value type too small for the array size.");
+    Vector infinity((OffsetType)maxOffset), zero((OffsetType)0);
+    
+    if(background)
+        transformMultiArray(source, dest, 
+            [infinity, zero](T1 v) { return v == NumericTraits<T1>::zero() ? infinity : zero; }, options);
+    else
+        transformMultiArray(source, dest, 
+            [infinity, zero](T1 v) { return v != NumericTraits<T1>::zero() ? infinity : zero; }, options);
+
+    // the lines of each dimension are independent and processed in parallel,
+    // every thread holds a temporary line to enable in-place operation
+    ThreadPool pool(options);
+    std::size_t threadCount = std::max<std::size_t>(pool.numThreads(), 1);
+    ArrayVector<ArrayVector<Vector> > tmp(threadCount);
+    ArrayVector<ArrayVector<detail::VectorialDistParabolaStackEntry> > stacks(threadCount);
+    
+    for(int d = 0; d < (int)N; ++d)
+    {
+        // enumerate the lines along dimension d by their starting points
+        Shape lineStarts(shape);
+        lineStarts[d] = 1;
+
+        parallel_foreach(pool, prod(lineStarts),
+            [&](int thread, MultiArrayIndex k)
+            {
+                Shape start;
+                detail::ScanOrderToCoordinate<N>::exec(k, lineStarts, start);
+                DestLine line(typename DestLine::difference_type(shape[d]), 
+                              typename DestLine::difference_type(dest.stride(d)), 
+                              &dest[start]);
+                tmp[thread].resize(shape[d]);
+                std::copy(line.begin(), line.end(), tmp[thread].begin());
+                detail::vectorialDistParabola(d, tmp[thread], pixelPitch, infinity, 
+                                              stacks[thread], line);
+            });
+    }
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+inline void separableVectorDistance( MultiArrayView<N, T1, S1> const & source,
+                                     MultiArrayView<N, TinyVector<T2, (int)N>, S2> dest, 
+                                     bool background,
+                                     ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    separableVectorDistance(source, dest, background, TinyVector<double, N>(1.0), options);
+}
+
 //@}
 
 } //-- namespace vigra
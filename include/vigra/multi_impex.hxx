@@ -49,6 +49,7 @@
 #include "impex.hxx"
 #include "multi_array.hxx"
 #include "multi_pointoperators.hxx"
+#include "threadpool.hxx"
 
 #ifdef _MSC_VER
 # include <direct.h>
@@ -161,9 +162,27 @@ class VolumeImportInfo
 
     VIGRA_EXPORT const std::string &description() const;
 
+        /** Query how the volume is stored. Possible values are:
+            <DL>
+            <DT>"STACK"<DD> one image file per slice
+            <DT>"MULTIPAGE"<DD> one slice per page of a multi-page TIFF file
+            <DT>"RAW"<DD> raw voxel data described by an info text file
+            </DL>
+         **/
+    VIGRA_EXPORT const char * getFileType() const;
+
     template <class T, class Stride>
     void importImpl(MultiArrayView <3, T, Stride> &volume) const;
 
+        /** Read the region of interest <tt>[roiBegin, roiEnd)</tt> of the volume.
+            Slices outside the ROI's z-range are not decoded. Slice stacks
+            are read concurrently according to <tt>options</tt>.
+         **/
+    template <class T, class Stride>
+    void importImpl(MultiArrayView <3, T, Stride> volume,
+                    ShapeType const & roiBegin, ShapeType const & roiEnd,
+                    ParallelOptions const & options) const;
+
   protected:
     void getVolumeInfoFromFirstSlice(const std::string &filename);
 
@@ -172,7 +191,7 @@ class VolumeImportInfo
     //PixelType pixelType_;
     int numBands_;
 
-    std::string path_, name_, description_, pixelType_;
+    std::string path_, name_, description_, pixelType_, fileType_;
 
     std::string rawFilename_;
     std::string baseName_, extension_;
@@ -251,6 +270,8 @@ class VolumeExportInfo
             <DT>"TIFF"<DD> Tagged Image File Format.
             (only available if libtiff is installed.)
             <DT>"VIFF"<DD> Khoros Visualization image file.
+            <DT>"MULTIPAGE"<DD> Multi-page TIFF file <tt>name_base+name_ext</tt>
+            holding one slice per page (only available if libtiff is installed.)
             </DL>
 
             With the exception of TIFF, VIFF, PNG, and PNM all file types store
@@ -465,22 +486,112 @@ void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume) const
     }
     else
     {
-        for (unsigned int i = 0; i < numbers_.size(); ++i)
+        importImpl(volume, ShapeType(), shape_,
+                   ParallelOptions().numThreads(ParallelOptions::NoThreads));
+    }
+}
+
+template <class T, class Stride>
+void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> volume,
+                                  ShapeType const & roiBegin, ShapeType const & roiEnd,
+                                  ParallelOptions const & options) const
+{
+    for(int k = 0; k < 3; ++k)
+        vigra_precondition(0 <= roiBegin[k] && roiBegin[k] < roiEnd[k] && roiEnd[k] <= shape_[k],
+            "importVolume(): ROI out of range.");
+    vigra_precondition(volume.shape() == roiEnd - roiBegin,
+        "importVolume(): Volume must be shaped according to the ROI.");
+
+    if(rawFilename_.size())
+    {
+        // the RAW file is read as a whole
+        if(roiBegin == ShapeType() && roiEnd == this->shape())
+        {
+            importImpl(volume);
+        }
+        else
+        {
+            MultiArray<3, T> tmp(this->shape());
+            importImpl(tmp);
+            volume = tmp.subarray(roiBegin, roiEnd);
+        }
+        return;
+    }
+
+    if(fileType_ == "MULTIPAGE")
+    {
+        // Each task decodes a run of consecutive pages through its own decoder, which
+        // keeps the file open. The file positions of all pages are collected once
+        // and handed to every decoder, so that no run has to search the file for
+        // its first page.
+        const MultiArrayIndex depth = roiEnd[2] - roiBegin[2];
+        ThreadPool pool(options);
+        const MultiArrayIndex runs = std::min<MultiArrayIndex>(depth, detail::parallelTaskCount(pool));
+        const Diff2D pageBegin(roiBegin[0], roiBegin[1]);
+        const Size2D pageSize(roiEnd[0] - roiBegin[0], roiEnd[1] - roiBegin[1]);
+        const std::vector<UInt64> offsets(getDecoder(baseName_)->getImageOffsets());
+
+        parallel_foreach(pool, runs,
+            [&](int /* thread_id */, std::ptrdiff_t run)
+            {
+                MultiArrayIndex begin = run*depth / runs,
+                                end   = (run + 1)*depth / runs;
+                VIGRA_UNIQUE_PTR<Decoder> decoder(getDecoder(baseName_));
+                decoder->setImageOffsets(offsets);
+                for(MultiArrayIndex k = begin; k < end; ++k)
+                {
+                    if(roiBegin[2] + k > 0)
+                        decoder->setImageIndex(roiBegin[2] + k);
+                    vigra_precondition((MultiArrayIndex)decoder->getWidth() == shape_[0] &&
+                                       (MultiArrayIndex)decoder->getHeight() == shape_[1],
+                        "importVolume(): the images have inconsistent sizes.");
+
+                    MultiArrayView <2, T, Stride> view (volume.bindOuter (k));
+                    auto dest = destImage(view);
+                    detail::read_image(decoder.get(), pageBegin, pageSize,
+                                       dest.first, dest.second,
+                                       typename NumericTraits<T>::isScalar());
+                }
+                decoder->close();
+            });
+        return;
+    }
+
+    typedef MultiArrayShape<2>::type Shape2;
+    Shape2 sliceBegin(roiBegin[0], roiBegin[1]),
+           sliceEnd(roiEnd[0], roiEnd[1]),
+           sliceShape(shape_[0], shape_[1]);
+    bool fullSlices = sliceBegin == Shape2() && sliceEnd == sliceShape;
+
+    ThreadPool pool(options);
+    // per-thread buffers for slices that are only partially covered by the ROI
+    ArrayVector<MultiArray<2, T> > buffers(std::max<std::size_t>(pool.numThreads(), 1));
+
+    parallel_foreach(pool, roiEnd[2] - roiBegin[2],
+        [&](int thread_id, std::ptrdiff_t k)
         {
             // build the filename
-            std::string name = baseName_ + numbers_[i] + extension_;
+            std::string name = baseName_ + numbers_[roiBegin[2] + k] + extension_;
 
             // import the image
             ImageImportInfo info (name.c_str ());
-
-            // generate a basic image view to the current layer
-            MultiArrayView <2, T, Stride> view (volume.bindOuter (i));
-            vigra_precondition(view.shape() == info.shape(),
+            vigra_precondition(sliceShape == info.shape(),
                 "importVolume(): the images have inconsistent sizes.");
 
-            importImage (info, destImage(view));
-        }
-    }
+            // generate a basic image view to the current layer
+            MultiArrayView <2, T, Stride> view (volume.bindOuter (k));
+            if(fullSlices)
+            {
+                importImage (info, destImage(view));
+            }
+            else
+            {
+                MultiArray<2, T> & buffer = buffers[thread_id];
+                buffer.reshape(sliceShape);
+                importImage (info, destImage(buffer));
+                view = buffer.subarray(sliceBegin, sliceEnd);
+            }
+        });
 }
 
 
@@ -524,9 +635,12 @@ void importVolume (MultiArray <3, T, Allocator> & volume,
 
 /** \brief Function for importing a 3D volume.
 
-    The data can be given in two ways:
+    The data can be given in three ways:
 
     <UL>
+    <LI> If <tt>filename</tt> refers to a TIFF file holding several pages,
+         each page becomes one slice of the volume.
+         All pages must have the same size.
     <LI> If the volume is stored in a by-slice manner (e.g. one image per slice),
          the <tt>filename</tt> can refer to an arbitrary image from the set. <tt>importVolume()</tt>
          then assumes that the slices are enumerated like <tt>name_base+"[0-9]+"+name_ext</tt>,
@@ -588,6 +702,63 @@ void importVolume(VolumeImportInfo const & info, MultiArrayView <3, T, Stride> &
     info.importImpl(volume);
 }
 
+/** \brief Function for importing a 3D volume in parallel.
+
+    Read the volume data set <tt>info</tt> refers to. When the volume is stored
+    as a slice stack or a multi-page file, the slices are decoded concurrently
+    into their z-planes of <tt>volume</tt>, using the number of threads given
+    by <tt>options</tt>.
+    The <tt>volume</tt> must already have the shape <tt>info.shape()</tt>.
+
+    <b>\#include</b>
+    \<vigra/multi_impex.hxx\>
+
+    Namespace: vigra
+*/
+template <class T, class Stride>
+void importVolume(VolumeImportInfo const & info, MultiArrayView <3, T, Stride> volume,
+                  ParallelOptions const & options)
+{
+    info.importImpl(volume, VolumeImportInfo::ShapeType(), info.shape(), options);
+}
+
+/** \brief Function for importing a region of interest of a 3D volume in parallel.
+
+    Read the box <tt>[roiBegin, roiEnd)</tt> of the volume data set <tt>info</tt>
+    refers to into <tt>volume</tt>, which must have the shape <tt>roiEnd - roiBegin</tt>.
+    When the volume is stored as a slice stack or a multi-page file, only the slices
+    in the ROI's z-range are decoded, and this happens concurrently using the number
+    of threads given by <tt>options</tt>. Slices of a stack are always decoded
+    completely, but only the ROI's x-y-range is copied into <tt>volume</tt>. Pages of
+    a multi-page file are decoded directly into <tt>volume</tt>, so that TIFF pages
+    only decode the strips or tiles overlapping the ROI (see \ref importImageRegion()).
+
+    <b> Usage:</b>
+
+    <b>\#include</b>
+    \<vigra/multi_impex.hxx\>
+
+    Namespace: vigra
+
+    \code
+    VolumeImportInfo info("stack/slice_", ".tif");
+
+    // read slices 1000 to 1499, cropped to the central 512x512 pixels, using 8 threads
+    Shape3 roiBegin((info.width() - 512) / 2, (info.height() - 512) / 2, 1000),
+           roiEnd(roiBegin + Shape3(512, 512, 500));
+    MultiArray<3, UInt8> volume(roiEnd - roiBegin);
+    importVolume(info, volume, roiBegin, roiEnd, ParallelOptions().numThreads(8));
+    \endcode
+*/
+template <class T, class Stride>
+void importVolume(VolumeImportInfo const & info, MultiArrayView <3, T, Stride> volume,
+                  VolumeImportInfo::ShapeType const & roiBegin,
+                  VolumeImportInfo::ShapeType const & roiEnd,
+                  ParallelOptions const & options = ParallelOptions())
+{
+    info.importImpl(volume, roiBegin, roiEnd, options);
+}
+
 namespace detail {
 
 template <class T>
@@ -675,6 +846,23 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
     does not support the source voxel type, all slices will be mapped simultaneously
     to the appropriate target range.
 
+    If <tt>options</tt> is given, the slices are encoded and written concurrently
+    using the requested number of threads.
+
+    If the file type of <tt>volinfo</tt> is <tt>"MULTIPAGE"</tt>, the slices are
+    instead written as consecutive pages of the single TIFF file
+    <tt>name_base+name_ext</tt>. The pages are appended one after another, so
+    <tt>options</tt> is ignored in this case.
+
+    \code
+    MultiArray<3, UInt16> volume(Shape3(512, 512, 2000));
+    ...
+    exportVolume(volume, VolumeExportInfo("stack", ".tif").setFileType("MULTIPAGE"));
+
+    MultiArray<3, UInt16> result;
+    importVolume(result, "stack.tif");
+    \endcode
+
     <b>\#include</b>
     \<vigra/multi_impex.hxx\>
 
@@ -682,7 +870,8 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
 */
 template <class T, class Tag>
 void exportVolume (MultiArrayView <3, T, Tag> const & volume,
-                   const VolumeExportInfo & volinfo)
+                   const VolumeExportInfo & volinfo,
+                   ParallelOptions const & options)
 {
     std::string name = std::string(volinfo.getFileNameBase()) + std::string(volinfo.getFileNameExt());
     ImageExportInfo info(name.c_str());
@@ -691,23 +880,51 @@ void exportVolume (MultiArrayView <3, T, Tag> const & volume,
     detail::setRangeMapping(volume, info, typename NumericTraits<T>::isScalar());
 
     const unsigned int depth = volume.shape (2);
-    int numlen = static_cast <int> (std::ceil (std::log10 ((double)depth)));
-    for (unsigned int i = 0; i < depth; ++i)
+    if(volinfo.getFileType() == std::string("MULTIPAGE"))
     {
+        // the first page creates the file, the others are appended
+        for(unsigned int i = 0; i < depth; ++i)
+        {
+            ImageExportInfo pageInfo(name.c_str(), i == 0 ? "w" : "a");
+            pageInfo.setFileType("TIFF");
+            pageInfo.setCompression(volinfo.getCompression());
+            pageInfo.setPixelType(volinfo.getPixelType());
+            if(info.hasForcedRangeMapping())
+                pageInfo.setForcedRangeMapping(info.getFromMin(), info.getFromMax(),
+                                               info.getToMin(), info.getToMax());
+
+            MultiArrayView <2, T, Tag> view (volume.bindOuter (i));
+            exportImage(srcImageRange(view), pageInfo);
+        }
+        return;
+    }
 
-        // build the filename
-        std::stringstream stream;
-        stream << std::setfill ('0') << std::setw (numlen) << i;
-        std::string name_num;
-        stream >> name_num;
-        std::string name = std::string(volinfo.getFileNameBase()) + name_num + std::string(volinfo.getFileNameExt());
-
-        MultiArrayView <2, T, Tag> view (volume.bindOuter (i));
+    int numlen = static_cast <int> (std::ceil (std::log10 ((double)depth)));
+    parallel_foreach(options, depth,
+        [&](int /* thread_id */, std::ptrdiff_t i)
+        {
+            // build the filename
+            std::stringstream stream;
+            stream << std::setfill ('0') << std::setw (numlen) << i;
+            std::string name_num;
+            stream >> name_num;
+            std::string name = std::string(volinfo.getFileNameBase()) + name_num + std::string(volinfo.getFileNameExt());
+
+            MultiArrayView <2, T, Tag> view (volume.bindOuter (i));
+
+            // export the image
+            ImageExportInfo sliceInfo(info);
+            sliceInfo.setFileName(name.c_str ());
+            exportImage(srcImageRange(view), sliceInfo); 
+        });
+}
 
-        // export the image
-        info.setFileName(name.c_str ());
-        exportImage(srcImageRange(view), info); 
-    }
+template <class T, class Tag>
+inline
+void exportVolume (MultiArrayView <3, T, Tag> const & volume,
+                   const VolumeExportInfo & volinfo)
+{
+    exportVolume(volume, volinfo, ParallelOptions().numThreads(ParallelOptions::NoThreads));
 }
 
 // for backward compatibility
@@ -39,8 +39,10 @@
 #define VIGRA_MULTI_ITERATOR_HXX
 
 #include <sys/types.h>
+#include <memory>
 #include "tinyvector.hxx"
 #include "iteratortags.hxx"
+#include "metaprogramming.hxx"
 
 namespace vigra {
 
@@ -49,6 +51,10 @@ template <unsigned int N, class T,
           class REFERENCE = T &, class POINTER = T *> class MultiIterator;
 template <unsigned int N, class T, 
           class REFERENCE = T &, class POINTER = T *> class StridedMultiIterator;
+template <unsigned int N, class T, 
+          class C = UnstridedArrayTag> class MultiArrayView;
+template <unsigned int N, class T, 
+          class A = std::allocator<T> > class MultiArray;
 
 /** \page MultiIteratorPage  Multi-dimensional Array Iterators
 
@@ -87,6 +87,23 @@ namespace vigra {
     
     Expressions are expanded so that no temporary arrays have to be created. To optimize cache locality,
     loops are executed in the stride ordering of the left-hand-side array.
+    When all arrays in an expression have the same shape and consecutive memory (see 
+    <tt>MultiArrayView::isUnstrided()</tt>), the nested loops are replaced by a single flat loop 
+    which the compiler can vectorize.
+    
+    Large expressions can be evaluated by multiple threads. To this end, the assignment 
+    operators are replaced with the functions <tt>assign(), plusAssign(), minusAssign(), 
+    multiplyAssign()</tt> and <tt>divideAssign()</tt>, which take a \ref ParallelOptions
+    object as an additional argument:
+    \code
+    MultiArray<3, float> gx(shape), gy(shape), gz(shape), res(shape);
+    ...
+    assign(res, sqrt(sq(gx) + sq(gy) + sq(gz)), ParallelOptions().numThreads(8)); // res = ...
+    plusAssign(res, 2.0*gx, ParallelOptions());  // res += ..., use the default number of threads
+    \endcode
+    The array is split into chunks (along the outermost axis in general, or in scan order when the flat 
+    loop is applicable), which are processed concurrently. When the target is an empty <tt>MultiArray</tt>, 
+    it is resized to the shape of the expression. 
     
     <b>\#include</b> \<vigra/multi_math.hxx\>
 
@@ -141,6 +158,21 @@ struct MultiMathOperand
         return arg_[s];
     }
     
+    // Check if all arrays involved in the expression have shape 's' and
+    // consecutive memory, so that they can be accessed by a scan-order index.
+    template <class SHAPE>
+    bool isContiguous(SHAPE const & s) const
+    {
+        return arg_.isContiguous(s);
+    }
+    
+    // get the value of the expression at scan-order index 'i' 
+    // (only valid if isContiguous() returned true)
+    result_type flat(MultiArrayIndex i) const
+    {
+        return arg_.flat(i);
+    }
+    
     ARG arg_;
 };
 
@@ -193,6 +225,23 @@ struct MultiMathOperand<MultiArrayView<N, T, C> >
         return p_[dot(s, strides_)];
     }
     
+    bool isContiguous(Shape const & s) const
+    {
+        MultiArrayIndex stride = 1;
+        for(unsigned int k=0; k<N; ++k)
+        {
+            if(shape_[k] != s[k] || (shape_[k] > 1 && strides_[k] != stride))
+                return false;
+            stride *= shape_[k];
+        }
+        return true;
+    }
+    
+    T const & flat(MultiArrayIndex i) const
+    {
+        return p_[i];
+    }
+    
     void inc(unsigned int axis) const
     {
         p_ += strides_[axis];
@@ -247,6 +296,17 @@ struct MultiMathScalarOperand
         return v_;
     }
     
+    template <class SHAPE>
+    bool isContiguous(SHAPE const &) const
+    {
+        return true;
+    }
+    
+    T const & flat(MultiArrayIndex) const
+    {
+        return v_;
+    }
+    
     void inc(unsigned int /* axis */) const
     {}
     
@@ -334,6 +394,17 @@ struct MultiMathUnaryOperator
         return f_(o_[p]);
     }
     
+    template <class SHAPE>
+    bool isContiguous(SHAPE const & s) const
+    {
+        return o_.isContiguous(s);
+    }
+    
+    result_type flat(MultiArrayIndex i) const
+    {
+        return f_(o_.flat(i));
+    }
+    
     result_type operator*() const
     {
         return f_(*o_);
@@ -477,6 +548,17 @@ struct MultiMathBinaryOperator
         return f_(o1_[p], o2_[p]);
     }
     
+    template <class SHAPE>
+    bool isContiguous(SHAPE const & s) const
+    {
+        return o1_.isContiguous(s) && o2_.isContiguous(s);
+    }
+    
+    result_type flat(MultiArrayIndex i) const
+    {
+        return f_(o1_.flat(i), o2_.flat(i));
+    }
+    
     void inc(unsigned int axis) const
     {
         o1_.inc(axis);
@@ -697,6 +779,23 @@ struct MultiMathExec
         e.reset(axis);
         data -= shape[axis]*strides[axis];
     }
+    
+    // Only execute the outermost loop for indices [begin, end). The pointers 
+    // of 'e' are not reset afterwards, so 'e' must be a private copy.
+    template <class T, class Shape, class Expression>
+    static void execRange(T * data, Shape const & shape, Shape const & strides, 
+                          Shape const & strideOrder, Expression const & e,
+                          MultiArrayIndex begin, MultiArrayIndex end)
+    {
+        MultiArrayIndex axis = strideOrder[LEVEL];
+        for(MultiArrayIndex k=0; k<begin; ++k)
+            e.inc(axis);
+        data += begin*strides[axis];
+        for(MultiArrayIndex k=begin; k<end; ++k, data += strides[axis], e.inc(axis))
+        {
+            MultiMathExec<N-1, Assign>::exec(data, shape, strides, strideOrder, e);
+        }
+    }
 };
 
 template <class Assign>
@@ -716,8 +815,83 @@ struct MultiMathExec<1, Assign>
         e.reset(axis);
         data -= shape[axis]*strides[axis];
     }
+    
+    template <class T, class Shape, class Expression>
+    static void execRange(T * data, Shape const & /* shape */, Shape const & strides, 
+                          Shape const & strideOrder, Expression const & e,
+                          MultiArrayIndex begin, MultiArrayIndex end)
+    {
+        MultiArrayIndex axis = strideOrder[LEVEL];
+        for(MultiArrayIndex k=0; k<begin; ++k)
+            e.inc(axis);
+        data += begin*strides[axis];
+        for(MultiArrayIndex k=begin; k<end; ++k, data += strides[axis], e.inc(axis))
+        {
+            Assign::assign(data, e);
+        }
+    }
 };
 
+// Evaluate the expression 'e' into 'a' (whose shape must already have been checked).
+// When all arrays have the same shape and consecutive memory, a flat loop
+// over the scan-order index is used, which the compiler can vectorize. 
+// Multi-threaded execution splits this loop or, in the general case, 
+// the outermost loop of the recursion into chunks. Each chunk gets
+// a private copy of the expression, because evaluation moves the 
+// operands' pointers.
+//
+template <class Assign, unsigned int N, class T, class C, class Expression>
+void 
+multiMathExec(MultiArrayView<N, T, C> a, MultiMathOperand<Expression> const & e,
+              ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    
+    Shape shape(a.shape()), strides(a.stride()), strideOrder(a.strideOrdering());
+    T * data = a.data();
+    int nThreads = options.getActualNumThreads();
+    
+    if(a.isUnstrided() && e.isContiguous(shape))
+    {
+        MultiArrayIndex size = a.elementCount();
+        if(nThreads <= 1)
+        {
+            for(MultiArrayIndex i=0; i<size; ++i)
+                Assign::assign(data+i, e, i);
+            return;
+        }
+        ThreadPool pool(options);
+        MultiArrayIndex chunk = vigra::detail::parallelChunkSize(pool, size),
+                        nChunks = (size + chunk - 1) / chunk;
+        parallel_foreach(pool, nChunks,
+            [&](int, MultiArrayIndex k)
+            {
+                MultiArrayIndex begin = k*chunk,
+                                end   = std::min(begin + chunk, size);
+                for(MultiArrayIndex i=begin; i<end; ++i)
+                    Assign::assign(data+i, e, i);
+            });
+    }
+    else if(nThreads <= 1)
+    {
+        MultiMathExec<N, Assign>::exec(data, shape, strides, strideOrder, e);
+    }
+    else
+    {
+        ThreadPool pool(options);
+        MultiArrayIndex outer = shape[strideOrder[N-1]],
+                        chunk = vigra::detail::parallelChunkSize(pool, outer),
+                        nChunks = (outer + chunk - 1) / chunk;
+        parallel_foreach(pool, nChunks,
+            [&](int, MultiArrayIndex k)
+            {
+                MultiMathOperand<Expression> ek(e);
+                MultiMathExec<N, Assign>::execRange(data, shape, strides, strideOrder, ek, 
+                                                    k*chunk, std::min((k+1)*chunk, outer));
+            });
+    }
+}
+
 #define VIGRA_MULTIMATH_ASSIGN(NAME, OP) \
 struct MultiMath##NAME \
 { \
@@ -726,6 +900,12 @@ struct MultiMath##NAME \
     { \
         *data OP vigra::detail::RequiresExplicitCast<T>::cast(*e); \
     } \
+     \
+    template <class T, class Expression> \
+    static void assign(T * data, Expression const & e, MultiArrayIndex i) \
+    { \
+        *data OP vigra::detail::RequiresExplicitCast<T>::cast(e.flat(i)); \
+    } \
 }; \
  \
 template <unsigned int N, class T, class C, class Expression> \
@@ -736,8 +916,7 @@ void NAME(MultiArrayView<N, T, C> a, MultiMathOperand<Expression> const & e) \
     vigra_precondition(e.checkShape(shape), \
        "multi_math: shape mismatch in expression."); \
         \
-    MultiMathExec<N, MultiMath##NAME>::exec(a.data(), a.shape(), a.stride(), \
-                                            a.strideOrdering(), e); \
+    multiMathExec<MultiMath##NAME>(a, e, ParallelOptions().numThreads(ParallelOptions::NoThreads)); \
 } \
  \
 template <unsigned int N, class T, class A, class Expression> \
@@ -751,8 +930,7 @@ void NAME##OrResize(MultiArray<N, T, A> & a, MultiMathOperand<Expression> const
     if(a.size() == 0) \
         a.reshape(shape); \
          \
-    MultiMathExec<N, MultiMath##NAME>::exec(a.data(), a.shape(), a.stride(), \
-                                            a.strideOrdering(), e); \
+    multiMathExec<MultiMath##NAME>(a, e, ParallelOptions().numThreads(ParallelOptions::NoThreads)); \
 }
 
 VIGRA_MULTIMATH_ASSIGN(assign, =)
@@ -816,6 +994,42 @@ struct MultiMathReduceAny
 
 } // namespace detail
 
+#define VIGRA_MULTIMATH_PARALLEL_ASSIGN(NAME) \
+template <unsigned int N, class T, class C, class Expression> \
+void NAME(MultiArrayView<N, T, C> a, MultiMathOperand<Expression> const & e, \
+          ParallelOptions const & options) \
+{ \
+    typename MultiArrayShape<N>::type shape(a.shape()); \
+     \
+    vigra_precondition(e.checkShape(shape), \
+       "multi_math: shape mismatch in expression."); \
+        \
+    detail::multiMathExec<detail::MultiMath##NAME>(a, e, options); \
+} \
+ \
+template <unsigned int N, class T, class A, class Expression> \
+void NAME(MultiArray<N, T, A> & a, MultiMathOperand<Expression> const & e, \
+          ParallelOptions const & options) \
+{ \
+    typename MultiArrayShape<N>::type shape(a.shape()); \
+     \
+    vigra_precondition(e.checkShape(shape), \
+       "multi_math: shape mismatch in expression."); \
+        \
+    if(a.size() == 0) \
+        a.reshape(shape); \
+         \
+    detail::multiMathExec<detail::MultiMath##NAME>(a, e, options); \
+}
+
+VIGRA_MULTIMATH_PARALLEL_ASSIGN(assign)
+VIGRA_MULTIMATH_PARALLEL_ASSIGN(plusAssign)
+VIGRA_MULTIMATH_PARALLEL_ASSIGN(minusAssign)
+VIGRA_MULTIMATH_PARALLEL_ASSIGN(multiplyAssign)
+VIGRA_MULTIMATH_PARALLEL_ASSIGN(divideAssign)
+
+#undef VIGRA_MULTIMATH_PARALLEL_ASSIGN
+
 template <class U, class T>
 U
 sum(MultiMathOperand<T> const & v, U res = NumericTraits<U>::zero()) 
@@ -39,6 +39,8 @@
 
 #include <vector>
 #include <cmath>
+#include <functional>
+#include <algorithm>
 #include "multi_distance.hxx"
 #include "array_vector.hxx"
 #include "multi_array.hxx"
@@ -48,6 +50,8 @@
 #include "metaprogramming.hxx"
 #include "multi_pointoperators.hxx"
 #include "functorexpression.hxx"
+#include "threadpool.hxx"
+#include "static_assert.hxx"
 
 namespace vigra
 {
@@ -577,6 +581,826 @@ void multiGrayscaleDilation(
 }
 
 
+namespace detail {
+
+// van Herk / Gil-Werman running minimum/maximum of a 1D line over a window
+// of size 2*radius+1. The line is (conceptually) padded with 'border' and
+// cut into blocks of the window size. Forward (g) and backward (h) running
+// extrema within each block combine to the window extremum with a single
+// comparison, so the cost per pixel is independent of the radius.
+template <class T, class Compare>
+void
+vanHerkGilWermanLine(ArrayVector<T> & line, MultiArrayIndex radius, T border,
+                     Compare better, ArrayVector<T> & g, ArrayVector<T> & h)
+{
+    MultiArrayIndex n = (MultiArrayIndex)line.size();
+    // windows larger than the line only add neutral border pixels
+    radius = std::min(radius, n);
+    MultiArrayIndex k = 2*radius + 1,
+                    m = n + 2*radius;
+    g.resize(m);
+    h.resize(m);
+
+    for(MultiArrayIndex i = 0, b = 0; i < m; ++i, ++b)
+    {
+        T v = (i < radius || i >= n + radius) ? border : line[i - radius];
+        if(b == k)
+            b = 0;
+        g[i] = (b == 0 || better(v, g[i-1])) ? v : g[i-1];
+    }
+    for(MultiArrayIndex i = m-1; i >= 0; --i)
+    {
+        T v = (i < radius || i >= n + radius) ? border : line[i - radius];
+        h[i] = (i == m-1 || i % k == k-1 || better(v, h[i+1])) ? v : h[i+1];
+    }
+    for(MultiArrayIndex x = 0; x < n; ++x)
+        line[x] = better(g[x + 2*radius], h[x]) ? g[x + 2*radius] : h[x];
+}
+
+// apply the running extremum along all discrete lines { p + j*step } of the array
+template <unsigned int N, class T1, class S1, class T2, class S2, class Compare>
+void
+multiLineMorphologyImpl(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        typename MultiArrayShape<N>::type const & step,
+                        MultiArrayIndex radius, T2 border, Compare better)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    if(radius == 0 || step == Shape())
+    {
+        dest = source;
+        return;
+    }
+
+    Shape shape(source.shape()), p;
+    MultiArrayIndex total = prod(shape);
+    ArrayVector<T2> line, g, h;
+
+    for(MultiArrayIndex k = 0; k < total; ++k)
+    {
+        // p starts a line iff its predecessor along 'step' is outside the array
+        if(!dest.isInside(p - step))
+        {
+            line.clear();
+            for(Shape q = p; dest.isInside(q); q += step)
+                line.push_back(detail::RequiresExplicitCast<T2>::cast(source[q]));
+
+            vanHerkGilWermanLine(line, radius, border, better, g, h);
+
+            Shape q = p;
+            for(unsigned int i = 0; i < line.size(); ++i, q += step)
+                dest[q] = line[i];
+        }
+        // advance p in scan order
+        for(unsigned int d = 0; d < N; ++d)
+        {
+            if(++p[d] < shape[d])
+                break;
+            p[d] = 0;
+        }
+    }
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class Compare>
+void
+multiBoxMorphologyImpl(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> dest,
+                       typename MultiArrayShape<N>::type const & radius,
+                       T2 border, Compare better)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    // the box is the Minkowski sum of axis-parallel lines
+    bool first = true;
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        if(radius[d] == 0)
+            continue;
+        Shape step;
+        step[d] = 1;
+        if(first)
+            multiLineMorphologyImpl(source, dest, step, radius[d], border, better);
+        else
+            multiLineMorphologyImpl(dest, dest, step, radius[d], border, better);
+        first = false;
+    }
+    if(first)
+        dest = source;
+}
+
+} // namespace detail
+
+/********************************************************/
+/*                                                      */
+/*          multiBoxErosion, multiBoxDilation           */
+/*                                                      */
+/********************************************************/
+/** \brief Grayscale erosion with a box-shaped structuring element.
+
+    The structuring element is the axis-parallel box of size
+    <tt>2*radius[k]+1</tt> along dimension <tt>k</tt> (use <tt>radius[k] == 0</tt>
+    to leave a dimension alone). The box is decomposed into 1D lines, and each line
+    is processed with the van Herk / Gil-Werman algorithm, so that the computation
+    requires only about three comparisons per pixel and dimension, regardless of the
+    radius. Pixels outside the array are ignored. Use \ref multiBoxDilation()
+    for the dual operation, and \ref multiBoxOpening() and \ref multiBoxClosing()
+    for their combinations.
+
+    The function may work in-place (i.e. <tt>source</tt> and <tt>dest</tt> may
+    refer to the same array).
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiBoxErosion(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        typename MultiArrayShape<N>::type const & radius);
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_morphology.hxx\>
+
+    \code
+    MultiArray<2, float> image(width, height), background(width, height);
+    ...
+
+    // estimate the background by an opening with a 101x101 box,
+    // the cost does not depend on the box size
+    multiBoxOpening(image, background, Shape2(50));
+    image -= background;
+    \endcode
+
+    \see vigra::multiLineErosion(), vigra::discErosion()
+*/
+doxygen_overloaded_function(template <...> void multiBoxErosion)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiBoxErosion(MultiArrayView<N, T1, S1> const & source,
+                MultiArrayView<N, T2, S2> dest,
+                typename MultiArrayShape<N>::type const & radius)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "multiBoxErosion(): shape mismatch between input and output.");
+    vigra_precondition(radius.minimum() >= 0,
+        "multiBoxErosion(): radius must be non-negative.");
+    detail::multiBoxMorphologyImpl(source, dest, radius,
+                                   NumericTraits<T2>::max(), std::less<T2>());
+}
+
+/** \brief Grayscale dilation with a box-shaped structuring element.
+
+    This is the dual of \ref multiBoxErosion(), see there for details.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiBoxDilation(MultiArrayView<N, T1, S1> const & source,
+                         MultiArrayView<N, T2, S2> dest,
+                         typename MultiArrayShape<N>::type const & radius);
+    }
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void multiBoxDilation)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiBoxDilation(MultiArrayView<N, T1, S1> const & source,
+                 MultiArrayView<N, T2, S2> dest,
+                 typename MultiArrayShape<N>::type const & radius)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "multiBoxDilation(): shape mismatch between input and output.");
+    vigra_precondition(radius.minimum() >= 0,
+        "multiBoxDilation(): radius must be non-negative.");
+    detail::multiBoxMorphologyImpl(source, dest, radius,
+                                   NumericTraits<T2>::min(), std::greater<T2>());
+}
+
+/** \brief Grayscale opening with a box-shaped structuring element.
+
+    Computes \ref multiBoxErosion() followed by \ref multiBoxDilation()
+    with the same radius. The result is stored in <tt>dest</tt>, no temporary
+    array is needed.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiBoxOpening(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        typename MultiArrayShape<N>::type const & radius);
+    }
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void multiBoxOpening)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiBoxOpening(MultiArrayView<N, T1, S1> const & source,
+                MultiArrayView<N, T2, S2> dest,
+                typename MultiArrayShape<N>::type const & radius)
+{
+    multiBoxErosion(source, dest, radius);
+    multiBoxDilation(dest, dest, radius);
+}
+
+/** \brief Grayscale closing with a box-shaped structuring element.
+
+    Computes \ref multiBoxDilation() followed by \ref multiBoxErosion()
+    with the same radius. The result is stored in <tt>dest</tt>, no temporary
+    array is needed.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiBoxClosing(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        typename MultiArrayShape<N>::type const & radius);
+    }
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void multiBoxClosing)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiBoxClosing(MultiArrayView<N, T1, S1> const & source,
+                MultiArrayView<N, T2, S2> dest,
+                typename MultiArrayShape<N>::type const & radius)
+{
+    multiBoxDilation(source, dest, radius);
+    multiBoxErosion(dest, dest, radius);
+}
+
+/********************************************************/
+/*                                                      */
+/*         multiLineErosion, multiLineDilation          */
+/*                                                      */
+/********************************************************/
+/** \brief Grayscale erosion with a line-shaped structuring element.
+
+    The structuring element consists of the <tt>2*radius+1</tt> points
+    <tt>j*step</tt> with <tt>-radius <= j <= radius</tt>. The direction
+    <tt>step</tt> is an arbitrary non-zero integer vector, e.g. <tt>Shape2(1,0)</tt>
+    for horizontal lines, <tt>Shape2(1,1)</tt> and <tt>Shape2(1,-1)</tt> for the
+    diagonals, or <tt>Shape2(2,1)</tt> for a periodic line at about 27 degrees.
+    Every discrete line <tt>p + j*step</tt> through the array is processed with the
+    van Herk / Gil-Werman algorithm, so that the cost per pixel is independent of the
+    radius. Pixels outside the array are ignored. Use \ref multiLineDilation()
+    for the dual operation, and \ref multiLineOpening() and \ref multiLineClosing()
+    for their combinations.
+
+    The function may work in-place (i.e. <tt>source</tt> and <tt>dest</tt> may
+    refer to the same array).
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiLineErosion(MultiArrayView<N, T1, S1> const & source,
+                         MultiArrayView<N, T2, S2> dest,
+                         typename MultiArrayShape<N>::type const & step,
+                         MultiArrayIndex radius);
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_morphology.hxx\>
+
+    \code
+    MultiArray<2, UInt8> image(width, height), result(width, height);
+    ...
+
+    // remove bright structures which don't extend over 41 pixels
+    // along the main diagonal
+    multiLineOpening(image, result, Shape2(1, 1), 20);
+    \endcode
+
+    \see vigra::multiBoxErosion()
+*/
+doxygen_overloaded_function(template <...> void multiLineErosion)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiLineErosion(MultiArrayView<N, T1, S1> const & source,
+                 MultiArrayView<N, T2, S2> dest,
+                 typename MultiArrayShape<N>::type const & step,
+                 MultiArrayIndex radius)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "multiLineErosion(): shape mismatch between input and output.");
+    vigra_precondition(radius >= 0,
+        "multiLineErosion(): radius must be non-negative.");
+    detail::multiLineMorphologyImpl(source, dest, step, radius,
+                                    NumericTraits<T2>::max(), std::less<T2>());
+}
+
+/** \brief Grayscale dilation with a line-shaped structuring element.
+
+    This is the dual of \ref multiLineErosion(), see there for details.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiLineDilation(MultiArrayView<N, T1, S1> const & source,
+                          MultiArrayView<N, T2, S2> dest,
+                          typename MultiArrayShape<N>::type const & step,
+                          MultiArrayIndex radius);
+    }
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void multiLineDilation)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiLineDilation(MultiArrayView<N, T1, S1> const & source,
+                  MultiArrayView<N, T2, S2> dest,
+                  typename MultiArrayShape<N>::type const & step,
+                  MultiArrayIndex radius)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "multiLineDilation(): shape mismatch between input and output.");
+    vigra_precondition(radius >= 0,
+        "multiLineDilation(): radius must be non-negative.");
+    detail::multiLineMorphologyImpl(source, dest, step, radius,
+                                    NumericTraits<T2>::min(), std::greater<T2>());
+}
+
+/** \brief Grayscale opening with a line-shaped structuring element.
+
+    Computes \ref multiLineErosion() followed by \ref multiLineDilation()
+    with the same line.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiLineOpening(MultiArrayView<N, T1, S1> const & source,
+                         MultiArrayView<N, T2, S2> dest,
+                         typename MultiArrayShape<N>::type const & step,
+                         MultiArrayIndex radius);
+    }
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void multiLineOpening)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiLineOpening(MultiArrayView<N, T1, S1> const & source,
+                 MultiArrayView<N, T2, S2> dest,
+                 typename MultiArrayShape<N>::type const & step,
+                 MultiArrayIndex radius)
+{
+    multiLineErosion(source, dest, step, radius);
+    multiLineDilation(dest, dest, step, radius);
+}
+
+/** \brief Grayscale closing with a line-shaped structuring element.
+
+    Computes \ref multiLineDilation() followed by \ref multiLineErosion()
+    with the same line.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        multiLineClosing(MultiArrayView<N, T1, S1> const & source,
+                         MultiArrayView<N, T2, S2> dest,
+                         typename MultiArrayShape<N>::type const & step,
+                         MultiArrayIndex radius);
+    }
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void multiLineClosing)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+multiLineClosing(MultiArrayView<N, T1, S1> const & source,
+                 MultiArrayView<N, T2, S2> dest,
+                 typename MultiArrayShape<N>::type const & step,
+                 MultiArrayIndex radius)
+{
+    multiLineDilation(source, dest, step, radius);
+    multiLineErosion(dest, dest, step, radius);
+}
+
+
+namespace detail {
+
+// Split of the value range into coarse and fine histogram bins
+// for the constant-time rank filter (only 8- and 16-bit unsigned
+// types are supported).
+template <class T>
+struct BoxRankFilterBins;
+
+template <>
+struct BoxRankFilterBins<UInt8>
+{
+    enum { valueBits = 8, fineBits = 4 };
+};
+
+template <>
+struct BoxRankFilterBins<UInt16>
+{
+    enum { valueBits = 16, fineBits = 8 };
+};
+
+template <class T>
+struct multiBoxRankOrderFilter_error__source_type_must_be_UInt8_or_UInt16
+: staticAssert::AssertBool<IsSameType<T, UInt8>::value || IsSameType<T, UInt16>::value>
+{};
+
+// The column histograms in BoxRankFilterBuffers are all zero between two calls
+// of boxRankFilterBlock(), so that they need not be cleared for every block.
+
+struct BoxRankFilterBuffers
+{
+    ArrayVector<UInt32> columnFine, columnCoarse, kernelFine, kernelCoarse;
+    ArrayVector<MultiArrayIndex> fineBegin, fineEnd;
+};
+
+// Perreault-Hebert rank filter for the pixels [x0, x1) x [y0, y1) of slice z.
+// Every column x keeps a histogram of its (2*ry+1) x (2*rz+1) window cross-section,
+// which is updated by one row per step in y. The kernel histogram is then
+// obtained by adding and subtracting one column histogram per step in x.
+// Both histograms have a coarse and a fine level. The fine level of the
+// kernel histogram is only brought up to date for the coarse bin containing
+// the desired rank.
+template <class T1, class S1, class T2, class S2>
+void
+boxRankFilterBlock(MultiArrayView<3, T1, S1> const & src,
+                   MultiArrayView<3, T2, S2> dest,
+                   TinyVector<MultiArrayIndex, 3> const & radius, double rank,
+                   MultiArrayIndex z, MultiArrayIndex y0, MultiArrayIndex y1,
+                   MultiArrayIndex x0, MultiArrayIndex x1,
+                   BoxRankFilterBuffers & buffers)
+{
+    typedef BoxRankFilterBins<T1> Bins;
+    enum { fineBits   = Bins::fineBits,
+           fineSize   = 1 << fineBits,
+           coarseSize = 1 << (Bins::valueBits - fineBits),
+           binCount   = fineSize*coarseSize };
+
+    MultiArrayIndex w = src.shape(0), h = src.shape(1),
+                    rx = radius[0], ry = radius[1],
+                    cx0 = std::max<MultiArrayIndex>(x0 - rx, 0),
+                    cx1 = std::min(x1 + rx, w),
+                    z0 = std::max<MultiArrayIndex>(z - radius[2], 0),
+                    z1 = std::min(z + radius[2] + 1, src.shape(2));
+
+    // new elements are zero-initialized, the existing ones are already zero
+    buffers.columnFine.resize((cx1 - cx0)*binCount);
+    buffers.columnCoarse.resize((cx1 - cx0)*coarseSize);
+    buffers.kernelFine.resize(binCount);
+    buffers.kernelCoarse.resize(coarseSize);
+    buffers.fineBegin.resize(coarseSize);
+    buffers.fineEnd.resize(coarseSize);
+
+    UInt32 * columnFine   = buffers.columnFine.begin(),
+           * columnCoarse = buffers.columnCoarse.begin(),
+           * kernelFine   = buffers.kernelFine.begin(),
+           * kernelCoarse = buffers.kernelCoarse.begin();
+    MultiArrayIndex * fineBegin = buffers.fineBegin.begin(),
+                    * fineEnd   = buffers.fineEnd.begin();
+
+    // add (or remove) row y of the current slab to (from) the column histograms
+    auto updateRow = [&](MultiArrayIndex y, UInt32 delta)
+    {
+        for(MultiArrayIndex zz = z0; zz < z1; ++zz)
+        {
+            for(MultiArrayIndex x = cx0; x < cx1; ++x)
+            {
+                unsigned int v = src(x, y, zz);
+                columnFine[(x - cx0)*binCount + v] += delta;
+                columnCoarse[(x - cx0)*coarseSize + (v >> fineBits)] += delta;
+            }
+        }
+    };
+
+    for(MultiArrayIndex y = std::max<MultiArrayIndex>(y0 - ry, 0);
+        y < std::min(y0 + ry + 1, h); ++y)
+        updateRow(y, 1);
+
+    for(MultiArrayIndex y = y0; y < y1; ++y)
+    {
+        if(y > y0)
+        {
+            if(y - ry - 1 >= 0)
+                updateRow(y - ry - 1, UInt32(-1));
+            if(y + ry < h)
+                updateRow(y + ry, 1);
+        }
+        MultiArrayIndex columnSize = (std::min(y + ry + 1, h) - std::max<MultiArrayIndex>(y - ry, 0)) *
+                                     (z1 - z0);
+
+        // initialize the kernel histogram at x0, the fine level is marked as outdated
+        MultiArrayIndex kb = std::max<MultiArrayIndex>(x0 - rx, 0),
+                        ke = std::min(x0 + rx + 1, w);
+        buffers.kernelCoarse.init(0);
+        buffers.fineBegin.init(0);
+        buffers.fineEnd.init(0);
+        for(MultiArrayIndex c = kb; c < ke; ++c)
+            for(int i = 0; i < coarseSize; ++i)
+                kernelCoarse[i] += columnCoarse[(c - cx0)*coarseSize + i];
+
+        for(MultiArrayIndex x = x0; x < x1; ++x)
+        {
+            if(x > x0)
+            {
+                if(x - rx - 1 >= 0)
+                {
+                    for(int i = 0; i < coarseSize; ++i)
+                        kernelCoarse[i] -= columnCoarse[(kb - cx0)*coarseSize + i];
+                    ++kb;
+                }
+                if(x + rx < w)
+                {
+                    for(int i = 0; i < coarseSize; ++i)
+                        kernelCoarse[i] += columnCoarse[(ke - cx0)*coarseSize + i];
+                    ++ke;
+                }
+            }
+
+            UInt32 count  = UInt32((ke - kb)*columnSize),
+                   needed = std::max<UInt32>(UInt32(std::ceil(rank*count)), 1),
+                   sum    = 0;
+
+            int c = 0;
+            while(sum + kernelCoarse[c] < needed)
+                sum += kernelCoarse[c++];
+
+            // bring the fine histogram of coarse bin c up to date
+            UInt32 * fine = kernelFine + c*fineSize;
+            MultiArrayIndex b = fineBegin[c], e = fineEnd[c];
+            if(kb >= e)
+            {
+                std::fill(fine, fine + fineSize, UInt32(0));
+                b = e = kb;
+            }
+            for(; b < kb; ++b)
+            {
+                UInt32 const * column = columnFine + (b - cx0)*binCount + c*fineSize;
+                for(int i = 0; i < fineSize; ++i)
+                    fine[i] -= column[i];
+            }
+            for(; e < ke; ++e)
+            {
+                UInt32 const * column = columnFine + (e - cx0)*binCount + c*fineSize;
+                for(int i = 0; i < fineSize; ++i)
+                    fine[i] += column[i];
+            }
+            fineBegin[c] = kb;
+            fineEnd[c] = ke;
+
+            int f = 0;
+            while(sum + fine[f] < needed)
+                sum += fine[f++];
+
+            dest(x, y, z) = detail::RequiresExplicitCast<T2>::cast(c*fineSize + f);
+        }
+    }
+
+    // remove the rows of the last window to restore the all-zero column histograms,
+    // which is much cheaper than clearing all bins for the next block
+    for(MultiArrayIndex y = std::max<MultiArrayIndex>(y1 - 1 - ry, 0);
+        y < std::min(y1 + ry, h); ++y)
+        updateRow(y, UInt32(-1));
+}
+
+template <class T1, class S1, class T2, class S2>
+void
+boxRankOrderFilterImpl(MultiArrayView<3, T1, S1> const & src,
+                       MultiArrayView<3, T2, S2> dest,
+                       TinyVector<MultiArrayIndex, 3> const & radius, double rank,
+                       ParallelOptions const & options)
+{
+    typedef BoxRankFilterBins<T1> Bins;
+    const MultiArrayIndex binCount = MultiArrayIndex(1) << Bins::valueBits;
+    MultiArrayIndex w = src.shape(0), h = src.shape(1), d = src.shape(2);
+
+    ThreadPool pool(options);
+    std::size_t threadCount = std::max<std::size_t>(pool.numThreads(), 1);
+
+    // process vertical stripes to bound the memory of the column histograms:
+    // all threads together hold at most 2^24 bins (64 MB), unless the stripes
+    // would become narrower than the window
+    MultiArrayIndex columns = (MultiArrayIndex(1) << 24) / binCount / (MultiArrayIndex)threadCount,
+                    stripeWidth = std::max<MultiArrayIndex>(columns - 2*radius[0], 2*radius[0] + 1),
+                    stripeCount = (w + stripeWidth - 1) / stripeWidth;
+
+    // split the rows into blocks only when there are not enough slices to keep all threads busy
+    MultiArrayIndex blockCount = std::min<MultiArrayIndex>(h, (threadCount + d - 1) / d),
+                    blockHeight = (h + blockCount - 1) / blockCount;
+    blockCount = (h + blockHeight - 1) / blockHeight;
+
+    ArrayVector<BoxRankFilterBuffers> buffers(threadCount);
+
+    parallel_foreach(pool, d*blockCount*stripeCount,
+        [&](int thread_id, std::ptrdiff_t k)
+        {
+            MultiArrayIndex stripe = k % stripeCount,
+                            block  = (k / stripeCount) % blockCount,
+                            z      = k / (stripeCount*blockCount);
+            boxRankFilterBlock(src, dest, radius, rank, z,
+                               block*blockHeight, std::min((block + 1)*blockHeight, h),
+                               stripe*stripeWidth, std::min((stripe + 1)*stripeWidth, w),
+                               buffers[thread_id]);
+        });
+}
+
+} // namespace detail
+
+/********************************************************/
+/*                                                      */
+/*         multiBoxRankOrderFilter, multiBoxMedian      */
+/*                                                      */
+/********************************************************/
+/** \brief Rank order filter with a box-shaped window for 8- and 16-bit images and volumes.
+
+    The window is the axis-parallel box of size <tt>2*radius[k]+1</tt> along
+    dimension <tt>k</tt>, clipped at the array border. The filter returns the
+    smallest value <tt>v</tt> in the window such that the fraction of window values
+    <tt><= v</tt> is at least <tt>rank</tt>. Thus, it acts as a minimum filter if
+    <tt>rank = 0.0</tt>, as a median if <tt>rank = 0.5</tt>, and as a maximum filter
+    if <tt>rank = 1.0</tt>.
+
+    The source value type must be <tt>UInt8</tt> or <tt>UInt16</tt>.
+    The implementation follows Perreault and H&eacute;bert ("Median filtering
+    in constant time", IEEE Trans. Image Processing 16(9), 2007): a histogram per
+    column is maintained while sweeping down the rows, and the window histogram
+    is updated by adding and removing one column histogram per pixel. Histograms
+    are split into coarse and fine bins, so that only a small fraction of the bins
+    must be touched. For 2D images, the cost per pixel is therefore independent
+    of the radius. For 3D volumes, the column histograms cover the window's
+    cross-section in y and z, and the cost grows only linearly with
+    <tt>radius[2]</tt>. 16-bit images are processed in vertical stripes to
+    limit the memory required by the column histograms to about 64 MB in total
+    (shared by all threads), unless <tt>radius[0]</tt> is so large that each
+    thread's stripe must be wider than its share in order to cover the window.
+
+    If <tt>options</tt> requests multiple threads, slices and blocks of rows
+    are processed in parallel. The function does not work in-place.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <class T1, class S1, class T2, class S2>
+        void
+        multiBoxRankOrderFilter(MultiArrayView<2, T1, S1> const & source,
+                                MultiArrayView<2, T2, S2> dest,
+                                MultiArrayShape<2>::type const & radius, double rank,
+                                ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        template <class T1, class S1, class T2, class S2>
+        void
+        multiBoxRankOrderFilter(MultiArrayView<3, T1, S1> const & source,
+                                MultiArrayView<3, T2, S2> dest,
+                                MultiArrayShape<3>::type const & radius, double rank,
+                                ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_morphology.hxx\>
+
+    \code
+    MultiArray<2, UInt16> image(width, height), dest(width, height);
+    ...
+
+    // 90% quantile in a 31x31 window, using 4 threads
+    multiBoxRankOrderFilter(image, dest, Shape2(15), 0.9, ParallelOptions().numThreads(4));
+    \endcode
+
+    <b> Preconditions:</b>
+
+    \code
+    source.shape() == dest.shape()
+    (rank >= 0.0) && (rank <= 1.0)
+    radius[k] >= 0
+    \endcode
+
+    \see vigra::multiBoxMedian(), vigra::discRankOrderFilter()
+*/
+doxygen_overloaded_function(template <...> void multiBoxRankOrderFilter)
+
+template <class T1, class S1, class T2, class S2>
+void
+multiBoxRankOrderFilter(MultiArrayView<3, T1, S1> const & source,
+                        MultiArrayView<3, T2, S2> dest,
+                        MultiArrayShape<3>::type const & radius, double rank,
+                        ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    VIGRA_STATIC_ASSERT((detail::multiBoxRankOrderFilter_error__source_type_must_be_UInt8_or_UInt16<T1>));
+    vigra_precondition(source.shape() == dest.shape(),
+        "multiBoxRankOrderFilter(): shape mismatch between input and output.");
+    vigra_precondition(rank >= 0.0 && rank <= 1.0,
+        "multiBoxRankOrderFilter(): Rank must be between 0 and 1 (inclusive).");
+    vigra_precondition(radius.minimum() >= 0,
+        "multiBoxRankOrderFilter(): Radius must be >= 0.");
+    detail::boxRankOrderFilterImpl(source, dest, radius, rank, options);
+}
+
+template <class T1, class S1, class T2, class S2>
+inline void
+multiBoxRankOrderFilter(MultiArrayView<2, T1, S1> const & source,
+                        MultiArrayView<2, T2, S2> dest,
+                        MultiArrayShape<2>::type const & radius, double rank,
+                        ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    multiBoxRankOrderFilter(source.insertSingletonDimension(2), dest.insertSingletonDimension(2),
+                            MultiArrayShape<3>::type(radius[0], radius[1], 0), rank, options);
+}
+
+/** \brief Median filter with a box-shaped window for 8- and 16-bit images and volumes.
+
+    This is an abbreviation for the rank order filter with <tt>rank = 0.5</tt>.
+    See \ref multiBoxRankOrderFilter() for more information.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <class T1, class S1, class T2, class S2>
+        void
+        multiBoxMedian(MultiArrayView<2, T1, S1> const & source,
+                       MultiArrayView<2, T2, S2> dest,
+                       MultiArrayShape<2>::type const & radius,
+                       ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        template <class T1, class S1, class T2, class S2>
+        void
+        multiBoxMedian(MultiArrayView<3, T1, S1> const & source,
+                       MultiArrayView<3, T2, S2> dest,
+                       MultiArrayShape<3>::type const & radius,
+                       ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+    }
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void multiBoxMedian)
+
+template <class T1, class S1, class T2, class S2>
+inline void
+multiBoxMedian(MultiArrayView<2, T1, S1> const & source,
+               MultiArrayView<2, T2, S2> dest,
+               MultiArrayShape<2>::type const & radius,
+               ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    multiBoxRankOrderFilter(source, dest, radius, 0.5, options);
+}
+
+template <class T1, class S1, class T2, class S2>
+inline void
+multiBoxMedian(MultiArrayView<3, T1, S1> const & source,
+               MultiArrayView<3, T2, S2> dest,
+               MultiArrayShape<3>::type const & radius,
+               ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    multiBoxRankOrderFilter(source, dest, radius, 0.5, options);
+}
+
+
 //@}
 
 } //-- namespace vigra
@@ -45,6 +45,7 @@
 #include "multi_array.hxx"
 #include "metaprogramming.hxx"
 #include "inspector_passes.hxx"
+#include "threadpool.hxx"
 
 
 
@@ -654,6 +655,58 @@ transformMultiArrayImpl(SrcIterator s, SrcShape const & sshape, SrcAccessor src,
     }
     \endcode
 
+    pass arrays as views (all modes):
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2, 
+                  class Functor>
+        void
+        transformMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest, Functor const & f);
+    }
+    \endcode
+
+    multi-threaded execution (standard mode only):
+    \code
+    namespace vigra {
+        template <class SrcIterator, class SrcShape, class SrcAccessor,
+                  class DestIterator, class DestAccessor, 
+                  class Functor>
+        void
+        transformMultiArray(SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                            DestIterator d, DestAccessor dest, Functor const & f,
+                            ParallelOptions const & options);
+
+        template <class SrcIterator, class SrcShape, class SrcAccessor,
+                  class DestIterator, class DestAccessor, 
+                  class Functor>
+        void
+        transformMultiArray(triple<SrcIterator, SrcShape, SrcAccessor> const & src,
+                            pair<DestIterator, DestAccessor> const & dest, Functor const & f,
+                            ParallelOptions const & options);
+
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2, 
+                  class Functor>
+        void
+        transformMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest, Functor const & f,
+                            ParallelOptions const & options);
+    }
+    \endcode
+    
+    The variants taking \ref ParallelOptions split the outermost dimension
+    into chunks of consecutive slices which are transformed concurrently.
+    The functor is called from several threads at the same time and must 
+    therefore be thread-safe (e.g. it must not modify internal state).
+    When the view variants are called with arrays whose memory is consecutive
+    (see <tt>MultiArrayView::isUnstrided()</tt>), the nested loops are replaced
+    by a single flat loop which the compiler can vectorize. This also happens 
+    when the view variant without \ref ParallelOptions is called (which uses 
+    a single thread). When source and destination shapes differ (i.e. in expand 
+    and reduce mode), the view variants fall back to sequential execution.
+
     <b> Usage - Standard Mode:</b>
 
     Source and destination array have the same size.
@@ -672,6 +725,13 @@ transformMultiArrayImpl(SrcIterator s, SrcShape const & sshape, SrcAccessor src,
 
     \endcode
 
+    The same computation using 4 threads:
+    
+    \code
+    vigra::transformMultiArray(src, dest, (float(*)(float))&std::sqrt,
+                               vigra::ParallelOptions().numThreads(4));
+    \endcode
+
     <b> Usage - Expand Mode:</b>
 
     The source array is only 2D (it has depth 1). Thus, the destination
@@ -819,6 +879,116 @@ transformMultiArray(triple<SrcIterator, SrcShape, SrcAccessor> const & src,
                         dest.first, dest.second, dest.third, f);
 }
 
+namespace detail {
+
+template <class SrcIterator, class Shape, class SrcAccessor,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+void
+transformMultiArrayParallelImpl(SrcIterator s, Shape const & shape, SrcAccessor src,
+                                DestIterator d, DestAccessor dest, 
+                                Functor const & f, ParallelOptions const & options)
+{
+    enum { N = SrcIterator::level };
+    
+    // split the outermost dimension into chunks of consecutive slices
+    ThreadPool pool(options);
+    MultiArrayIndex outer = shape[N],
+                    chunk = detail::parallelChunkSize(pool, outer),
+                    nChunks = (outer + chunk - 1) / chunk;
+    parallel_foreach(pool, nChunks,
+        [&](int, MultiArrayIndex k)
+        {
+            MultiArrayIndex begin = k*chunk,
+                            end   = std::min(begin + chunk, outer);
+            Shape subshape(shape);
+            subshape[N] = end - begin;
+            transformMultiArrayExpandImpl(s + begin, subshape, src, d + begin, subshape, dest, 
+                                          f, MetaInt<N>());
+        });
+}
+
+template <class T1, class T2, class Functor>
+void
+transformContiguousArray(T1 const * s, T2 * d, MultiArrayIndex size,
+                         Functor const & f, ParallelOptions const & options)
+{
+    // flat loop over consecutive memory (vectorizable), chunks are executed in parallel
+    ThreadPool pool(options);
+    MultiArrayIndex chunk = detail::parallelChunkSize(pool, size),
+                    nChunks = (size + chunk - 1) / chunk;
+    parallel_foreach(pool, nChunks,
+        [&](int, MultiArrayIndex k)
+        {
+            MultiArrayIndex begin = k*chunk,
+                            end   = std::min(begin + chunk, size);
+            for(MultiArrayIndex i = begin; i < end; ++i)
+                d[i] = detail::RequiresExplicitCast<T2>::cast(f(s[i]));
+        });
+}
+
+} // namespace detail
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+inline void
+transformMultiArray(SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                    DestIterator d, DestAccessor dest, Functor const & f,
+                    ParallelOptions const & options)
+{
+    if(options.getActualNumThreads() <= 1)
+        transformMultiArray(s, shape, src, d, dest, f);
+    else
+        detail::transformMultiArrayParallelImpl(s, shape, src, d, dest, f, options);
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+inline void
+transformMultiArray(triple<SrcIterator, SrcShape, SrcAccessor> const & src,
+                    pair<DestIterator, DestAccessor> const & dest, Functor const & f,
+                    ParallelOptions const & options)
+{
+    transformMultiArray(src.first, src.second, src.third, 
+                        dest.first, dest.second, f, options);
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2, 
+          class Functor>
+void
+transformMultiArray(MultiArrayView<N, T1, S1> const & source,
+                    MultiArrayView<N, T2, S2> dest, Functor const & f,
+                    ParallelOptions const & options)
+{
+    if(source.shape() != dest.shape())
+    {
+        // expand and reduce modes are executed sequentially
+        transformMultiArray(srcMultiArrayRange(source), destMultiArrayRange(dest), f);
+    }
+    else if(source.isUnstrided() && dest.isUnstrided())
+    {
+        detail::transformContiguousArray(source.data(), dest.data(), source.elementCount(), 
+                                         f, options);
+    }
+    else
+    {
+        transformMultiArray(srcMultiArrayRange(source), destMultiArray(dest), f, options);
+    }
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2, 
+          class Functor>
+inline void
+transformMultiArray(MultiArrayView<N, T1, S1> const & source,
+                    MultiArrayView<N, T2, S2> dest, Functor const & f)
+{
+    transformMultiArray(source, dest, f, ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
 /********************************************************/
 /*                                                      */
 /*                combineTwoMultiArrays                 */
@@ -1081,6 +1251,55 @@ combineTwoMultiArraysImpl(
                        Functor const & f);
     }
     \endcode
+
+    pass arrays as views (all modes):
+    \code
+    namespace vigra {
+        template <unsigned int N, class T11, class S11,
+                  class T12, class S12,
+                  class T2, class S2, 
+                  class Functor>
+        void combineTwoMultiArrays(MultiArrayView<N, T11, S11> const & source1,
+                                   MultiArrayView<N, T12, S12> const & source2,
+                                   MultiArrayView<N, T2, S2> dest, Functor const & f);
+    }
+    \endcode
+
+    multi-threaded execution (standard mode only):
+    \code
+    namespace vigra {
+        template <class SrcIterator1, class SrcShape, class SrcAccessor1,
+                  class SrcIterator2, class SrcAccessor2,
+                  class DestIterator, class DestAccessor, 
+                  class Functor>
+        void combineTwoMultiArrays(
+                       SrcIterator1 s1, SrcShape const & shape, SrcAccessor1 src1,
+                       SrcIterator2 s2, SrcAccessor2 src2,
+                       DestIterator d, DestAccessor dest, Functor const & f,
+                       ParallelOptions const & options);
+
+        template <class SrcIterator1, class SrcShape, class SrcAccessor1,
+                  class SrcIterator2, class SrcAccessor2,
+                  class DestIterator, class DestAccessor, class Functor>
+        void combineTwoMultiArrays(
+                       triple<SrcIterator1, SrcShape, SrcAccessor1> const & src1,
+                       pair<SrcIterator2, SrcAccessor2> const & src2,
+                       pair<DestIterator, DestAccessor> const & dest, Functor const & f,
+                       ParallelOptions const & options);
+
+        template <unsigned int N, class T11, class S11,
+                  class T12, class S12,
+                  class T2, class S2, 
+                  class Functor>
+        void combineTwoMultiArrays(MultiArrayView<N, T11, S11> const & source1,
+                                   MultiArrayView<N, T12, S12> const & source2,
+                                   MultiArrayView<N, T2, S2> dest, Functor const & f,
+                                   ParallelOptions const & options);
+    }
+    \endcode
+    
+    See \ref transformMultiArray() for a description of the multi-threaded 
+    and view variants.
     
     <b> Usage - Standard Mode:</b>
     
@@ -1282,6 +1501,127 @@ combineTwoMultiArrays(
                           dest.first, dest.second, dest.third, f);
 }
 
+namespace detail {
+
+template <class SrcIterator1, class Shape, class SrcAccessor1,
+          class SrcIterator2, class SrcAccessor2,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+void
+combineTwoMultiArraysParallelImpl(SrcIterator1 s1, Shape const & shape, SrcAccessor1 src1,
+                                  SrcIterator2 s2, SrcAccessor2 src2,
+                                  DestIterator d, DestAccessor dest, 
+                                  Functor const & f, ParallelOptions const & options)
+{
+    enum { N = SrcIterator1::level };
+    
+    // split the outermost dimension into chunks of consecutive slices
+    ThreadPool pool(options);
+    MultiArrayIndex outer = shape[N],
+                    chunk = detail::parallelChunkSize(pool, outer),
+                    nChunks = (outer + chunk - 1) / chunk;
+    parallel_foreach(pool, nChunks,
+        [&](int, MultiArrayIndex k)
+        {
+            MultiArrayIndex begin = k*chunk,
+                            end   = std::min(begin + chunk, outer);
+            Shape subshape(shape);
+            subshape[N] = end - begin;
+            combineTwoMultiArraysExpandImpl(s1 + begin, subshape, src1, s2 + begin, subshape, src2,
+                                            d + begin, subshape, dest, f, MetaInt<N>());
+        });
+}
+
+template <class T1, class T2, class T3, class Functor>
+void
+combineTwoContiguousArrays(T1 const * s1, T2 const * s2, T3 * d, MultiArrayIndex size,
+                           Functor const & f, ParallelOptions const & options)
+{
+    ThreadPool pool(options);
+    MultiArrayIndex chunk = detail::parallelChunkSize(pool, size),
+                    nChunks = (size + chunk - 1) / chunk;
+    parallel_foreach(pool, nChunks,
+        [&](int, MultiArrayIndex k)
+        {
+            MultiArrayIndex begin = k*chunk,
+                            end   = std::min(begin + chunk, size);
+            for(MultiArrayIndex i = begin; i < end; ++i)
+                d[i] = detail::RequiresExplicitCast<T3>::cast(f(s1[i], s2[i]));
+        });
+}
+
+} // namespace detail
+
+template <class SrcIterator1, class SrcShape, class SrcAccessor1,
+          class SrcIterator2, class SrcAccessor2,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+inline void
+combineTwoMultiArrays(SrcIterator1 s1, SrcShape const & shape, SrcAccessor1 src1,
+                      SrcIterator2 s2, SrcAccessor2 src2,
+                      DestIterator d, DestAccessor dest, Functor const & f,
+                      ParallelOptions const & options)
+{    
+    if(options.getActualNumThreads() <= 1)
+        combineTwoMultiArrays(s1, shape, src1, s2, src2, d, dest, f);
+    else
+        detail::combineTwoMultiArraysParallelImpl(s1, shape, src1, s2, src2, d, dest, f, options);
+}
+
+template <class SrcIterator1, class SrcShape, class SrcAccessor1,
+          class SrcIterator2, class SrcAccessor2,
+          class DestIterator, class DestAccessor, class Functor>
+inline void
+combineTwoMultiArrays(triple<SrcIterator1, SrcShape, SrcAccessor1> const & src1,
+                      pair<SrcIterator2, SrcAccessor2> const & src2,
+                      pair<DestIterator, DestAccessor> const & dest, Functor const & f,
+                      ParallelOptions const & options)
+{
+    combineTwoMultiArrays(src1.first, src1.second, src1.third, 
+                          src2.first, src2.second, dest.first, dest.second, f, options);
+}
+
+template <unsigned int N, class T11, class S11,
+          class T12, class S12,
+          class T2, class S2, 
+          class Functor>
+void
+combineTwoMultiArrays(MultiArrayView<N, T11, S11> const & source1,
+                      MultiArrayView<N, T12, S12> const & source2,
+                      MultiArrayView<N, T2, S2> dest, Functor const & f,
+                      ParallelOptions const & options)
+{
+    if(source1.shape() != dest.shape() || source2.shape() != dest.shape())
+    {
+        // expand and reduce modes are executed sequentially
+        combineTwoMultiArrays(srcMultiArrayRange(source1), srcMultiArrayRange(source2), 
+                              destMultiArrayRange(dest), f);
+    }
+    else if(source1.isUnstrided() && source2.isUnstrided() && dest.isUnstrided())
+    {
+        detail::combineTwoContiguousArrays(source1.data(), source2.data(), dest.data(), 
+                                           dest.elementCount(), f, options);
+    }
+    else
+    {
+        combineTwoMultiArrays(srcMultiArrayRange(source1), srcMultiArray(source2), 
+                              destMultiArray(dest), f, options);
+    }
+}
+
+template <unsigned int N, class T11, class S11,
+          class T12, class S12,
+          class T2, class S2, 
+          class Functor>
+inline void
+combineTwoMultiArrays(MultiArrayView<N, T11, S11> const & source1,
+                      MultiArrayView<N, T12, S12> const & source2,
+                      MultiArrayView<N, T2, S2> dest, Functor const & f)
+{
+    combineTwoMultiArrays(source1, source2, dest, f, 
+                          ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
 /********************************************************/
 /*                                                      */
 /*               combineThreeMultiArrays                */
@@ -1364,6 +1704,26 @@ combineThreeMultiArraysImpl(SrcIterator1 s1, SrcShape const & shape, SrcAccessor
                        pair<DestIterator, DestAccessor> const & dest, Functor const & f);
     }
     \endcode
+
+    pass arrays as views:
+    \code
+    namespace vigra {
+        template <unsigned int N, class T11, class S11,
+                  class T12, class S12,
+                  class T13, class S13,
+                  class T2, class S2, 
+                  class Functor>
+        void
+        combineThreeMultiArrays(MultiArrayView<N, T11, S11> const & source1,
+                                MultiArrayView<N, T12, S12> const & source2,
+                                MultiArrayView<N, T13, S13> const & source3,
+                                MultiArrayView<N, T2, S2> dest, Functor const & f);
+    }
+    \endcode
+    
+    All variants can be called with an additional last argument 
+    <tt>ParallelOptions const & options</tt> to request multi-threaded execution,
+    see \ref transformMultiArray() for details.
     
     <b> Usage:</b>
     
@@ -1423,6 +1783,139 @@ combineThreeMultiArrays(triple<SrcIterator1, SrcShape, SrcAccessor1> const & src
            src2.first, src2.second, src3.first, src3.second, dest.first, dest.second, f);
 }
 
+namespace detail {
+
+template <class SrcIterator1, class Shape, class SrcAccessor1,
+          class SrcIterator2, class SrcAccessor2,
+          class SrcIterator3, class SrcAccessor3,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+void
+combineThreeMultiArraysParallelImpl(SrcIterator1 s1, Shape const & shape, SrcAccessor1 src1,
+                                    SrcIterator2 s2, SrcAccessor2 src2,
+                                    SrcIterator3 s3, SrcAccessor3 src3,
+                                    DestIterator d, DestAccessor dest, 
+                                    Functor const & f, ParallelOptions const & options)
+{
+    enum { N = SrcIterator1::level };
+    
+    // split the outermost dimension into chunks of consecutive slices
+    ThreadPool pool(options);
+    MultiArrayIndex outer = shape[N],
+                    chunk = detail::parallelChunkSize(pool, outer),
+                    nChunks = (outer + chunk - 1) / chunk;
+    parallel_foreach(pool, nChunks,
+        [&](int, MultiArrayIndex k)
+        {
+            MultiArrayIndex begin = k*chunk,
+                            end   = std::min(begin + chunk, outer);
+            Shape subshape(shape);
+            subshape[N] = end - begin;
+            combineThreeMultiArraysImpl(s1 + begin, subshape, src1, s2 + begin, src2, 
+                                        s3 + begin, src3, d + begin, dest, f, MetaInt<N>());
+        });
+}
+
+template <class T1, class T2, class T3, class T4, class Functor>
+void
+combineThreeContiguousArrays(T1 const * s1, T2 const * s2, T3 const * s3, T4 * d, 
+                             MultiArrayIndex size,
+                             Functor const & f, ParallelOptions const & options)
+{
+    ThreadPool pool(options);
+    MultiArrayIndex chunk = detail::parallelChunkSize(pool, size),
+                    nChunks = (size + chunk - 1) / chunk;
+    parallel_foreach(pool, nChunks,
+        [&](int, MultiArrayIndex k)
+        {
+            MultiArrayIndex begin = k*chunk,
+                            end   = std::min(begin + chunk, size);
+            for(MultiArrayIndex i = begin; i < end; ++i)
+                d[i] = detail::RequiresExplicitCast<T4>::cast(f(s1[i], s2[i], s3[i]));
+        });
+}
+
+} // namespace detail
+
+template <class SrcIterator1, class SrcShape, class SrcAccessor1,
+          class SrcIterator2, class SrcAccessor2,
+          class SrcIterator3, class SrcAccessor3,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+inline void
+combineThreeMultiArrays(SrcIterator1 s1, SrcShape const & shape, SrcAccessor1 src1,
+                        SrcIterator2 s2, SrcAccessor2 src2,
+                        SrcIterator3 s3, SrcAccessor3 src3,
+                        DestIterator d, DestAccessor dest, Functor const & f,
+                        ParallelOptions const & options)
+{    
+    if(options.getActualNumThreads() <= 1)
+        combineThreeMultiArrays(s1, shape, src1, s2, src2, s3, src3, d, dest, f);
+    else
+        detail::combineThreeMultiArraysParallelImpl(s1, shape, src1, s2, src2, s3, src3, 
+                                                    d, dest, f, options);
+}
+
+template <class SrcIterator1, class SrcShape, class SrcAccessor1,
+          class SrcIterator2, class SrcAccessor2,
+          class SrcIterator3, class SrcAccessor3,
+          class DestIterator, class DestAccessor, 
+          class Functor>
+inline void
+combineThreeMultiArrays(triple<SrcIterator1, SrcShape, SrcAccessor1> const & src1,
+                        pair<SrcIterator2, SrcAccessor2> const & src2,
+                        pair<SrcIterator3, SrcAccessor3> const & src3,
+                        pair<DestIterator, DestAccessor> const & dest, Functor const & f,
+                        ParallelOptions const & options)
+{
+    combineThreeMultiArrays(src1.first, src1.second, src1.third, 
+                            src2.first, src2.second, src3.first, src3.second, 
+                            dest.first, dest.second, f, options);
+}
+
+template <unsigned int N, class T11, class S11,
+          class T12, class S12,
+          class T13, class S13,
+          class T2, class S2, 
+          class Functor>
+void
+combineThreeMultiArrays(MultiArrayView<N, T11, S11> const & source1,
+                        MultiArrayView<N, T12, S12> const & source2,
+                        MultiArrayView<N, T13, S13> const & source3,
+                        MultiArrayView<N, T2, S2> dest, Functor const & f,
+                        ParallelOptions const & options)
+{
+    vigra_precondition(source1.shape() == dest.shape() && source2.shape() == dest.shape() &&
+                       source3.shape() == dest.shape(),
+        "combineThreeMultiArrays(): shape mismatch between inputs and/or output.");
+    if(source1.isUnstrided() && source2.isUnstrided() && source3.isUnstrided() && 
+       dest.isUnstrided())
+    {
+        detail::combineThreeContiguousArrays(source1.data(), source2.data(), source3.data(), 
+                                             dest.data(), dest.elementCount(), f, options);
+    }
+    else
+    {
+        combineThreeMultiArrays(srcMultiArrayRange(source1), srcMultiArray(source2), 
+                                srcMultiArray(source3), destMultiArray(dest), f, options);
+    }
+}
+
+template <unsigned int N, class T11, class S11,
+          class T12, class S12,
+          class T13, class S13,
+          class T2, class S2, 
+          class Functor>
+inline void
+combineThreeMultiArrays(MultiArrayView<N, T11, S11> const & source1,
+                        MultiArrayView<N, T12, S12> const & source2,
+                        MultiArrayView<N, T13, S13> const & source3,
+                        MultiArrayView<N, T2, S2> dest, Functor const & f)
+{
+    combineThreeMultiArrays(source1, source2, source3, dest, f, 
+                            ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
 /********************************************************/
 /*                                                      */
 /*                  inspectMultiArray                   */
@@ -49,6 +49,7 @@
 #include "matrix.hxx"
 #include "random.hxx"
 #include "functorexpression.hxx"
+#include "threadpool.hxx"
 #include "random_forest/rf_common.hxx"
 #include "random_forest/rf_nodeproxy.hxx"
 #include "random_forest/rf_split.hxx"
@@ -60,6 +61,7 @@
 #include "random_forest/rf_online_prediction_set.hxx"
 #include "random_forest/rf_earlystopping.hxx"
 #include "random_forest/rf_ridge_split.hxx"
+#include "random_forest/rf_compact.hxx"
 namespace vigra
 {
 
@@ -86,6 +88,57 @@ inline SamplerOptions make_sampler_opt ( RandomForestOptions     & RF_opt)
     return_opt.stratified(RF_opt.stratification_method_ == RF_EQUAL);
     return return_opt;
 }
+
+/* \brief visitor wrapper for parallel learning
+ *
+ * Forwards the learning related visitor calls to the wrapped visitor
+ * while holding the given mutex, so that visitors need not be thread-safe.
+ * If no mutex is given, the calls are forwarded directly.
+ */
+template <class Visitor>
+class SynchronizedVisitor
+{
+    Visitor &           visitor_;
+    threading::mutex *  mutex_;
+
+  public:
+    SynchronizedVisitor(Visitor & visitor, threading::mutex * mutex)
+    : visitor_(visitor),
+      mutex_(mutex)
+    {}
+
+    template<class Tree, class Split, class Region, class Feature_t, class Label_t>
+    void visit_after_split( Tree          & tree,
+                            Split         & split,
+                            Region        & parent,
+                            Region        & leftChild,
+                            Region        & rightChild,
+                            Feature_t     & features,
+                            Label_t       & labels)
+    {
+        if(mutex_ == 0)
+        {
+            visitor_.visit_after_split(tree, split, parent, leftChild, rightChild,
+                                       features, labels);
+            return;
+        }
+        threading::lock_guard<threading::mutex> lock(*mutex_);
+        visitor_.visit_after_split(tree, split, parent, leftChild, rightChild,
+                                   features, labels);
+    }
+
+    template<class RF, class PR, class SM, class ST>
+    void visit_after_tree(RF& rf, PR & pr,  SM & sm, ST & st, int index)
+    {
+        if(mutex_ == 0)
+        {
+            visitor_.visit_after_tree(rf, pr, sm, st, index);
+            return;
+        }
+        threading::lock_guard<threading::mutex> lock(*mutex_);
+        visitor_.visit_after_tree(rf, pr, sm, st, index);
+    }
+};
 }//namespace detail
 
 /** Random Forest class
@@ -417,7 +470,9 @@ class RandomForest
     /**\brief learn on data with custom config and random number generator
      *
      * \param features  a N x M matrix containing N samples with M
-     *                  features
+     *                  features. The matrix is accessed in place with its 
+     *                  own value type (e.g. float or UInt8), no copy in
+     *                  double precision is made.
      * \param response  a N x D matrix containing the corresponding
      *                  response. Current split functors assume D to
      *                  be 1 and ignore any additional columns.
@@ -456,6 +511,44 @@ class RandomForest
                 Stop_t                              stop,
                 Random_t                 const  &   random);
 
+    /**\brief learn the trees concurrently
+     *
+     * Same as above, but the trees are grown in parallel using the
+     * number of threads specified in \a options (see ParallelOptions).
+     * Before training, one seed per tree is drawn from \a random. Each
+     * tree then gets its own random number generator (constructed as
+     * <tt>Random_t(seed)</tt>), sampler, split and stop functors. Therefore,
+     * the resulting forest only depends on the state of \a random and
+     * is identical for every number of threads (but differs from the
+     * forest learned by the serial version with the same generator).
+     *
+     * Calls to the visitor are serialized by a mutex, so visitors need not
+     * be thread-safe. However, trees finish in arbitrary order, so
+     * visit_after_tree() is not necessarily called with increasing tree
+     * index. Online learning (RandomForestOptions::prepare_online_learning())
+     * is not supported.
+     *
+     * \code
+     * RandomForest<> rf(RandomForestOptions().tree_count(255));
+     * // reproducible training with 8 threads
+     * rf.learn(features, labels, rf_default(), rf_default(), rf_default(),
+     *          RandomNumberGenerator<>(42), ParallelOptions().numThreads(8));
+     * \endcode
+     */
+    template <class U, class C1,
+             class U2,class C2,
+             class Split_t,
+             class Stop_t,
+             class Visitor_t,
+             class Random_t>
+    void learn( MultiArrayView<2, U, C1> const  &   features,
+                MultiArrayView<2, U2,C2> const  &   response,
+                Visitor_t                           visitor,
+                Split_t                             split,
+                Stop_t                              stop,
+                Random_t                 const  &   random,
+                ParallelOptions          const  &   options);
+
     template <class U, class C1,
              class U2,class C2,
              class Split_t,
@@ -531,6 +624,26 @@ class RandomForest
                 rf_default(), 
                 rf_default());
     }
+
+    /**\brief learn on data with default configuration in parallel
+     *
+     * Uses a randomly seeded random number generator. Pass an explicitly
+     * seeded generator to the full version above to get reproducible results.
+     */
+    template <class U, class C1, class U2,class C2>
+    void learn(   MultiArrayView<2, U, C1> const  & features,
+                  MultiArrayView<2, U2,C2> const  & labels,
+                  ParallelOptions          const  & options)
+    {
+        RandomNumberGenerator<> rnd = RandomNumberGenerator<>(RandomSeed);
+        learn(  features, 
+                labels, 
+                rf_default(), 
+                rf_default(), 
+                rf_default(),
+                rnd,
+                options);
+    }
     /*\}*/
 
 
@@ -624,6 +737,39 @@ class RandomForest
         predictProbabilities(features, prob, rf_default()); 
     }   
 
+    /** \brief predict the class probabilities for multiple labels in parallel
+     *
+     *  \param features same as above
+     *  \param prob a n x class_count_ matrix. passed by reference to
+     *  save class probabilities
+     *  \param options the rows are distributed over the number of threads
+     *  specified here (see ParallelOptions).
+     *  \param treeMajor if <tt>false</tt>, each row is passed through all trees
+     *  in turn (as in the serial version). If <tt>true</tt>, a block of rows is
+     *  passed through one tree at a time, so that the tree's node arrays stay in
+     *  the cache. This is usually faster for large forests and many rows.
+     *
+     *  Both modes give exactly the same result as the serial version with
+     *  the default stopping criterion. Early stopping is not supported.
+     */
+    template <class U, class C1, class T, class C2>
+    void predictProbabilities(MultiArrayView<2, U, C1>const &   features,
+                              MultiArrayView<2, T, C2> &        prob,
+                              ParallelOptions const &           options,
+                              bool                              treeMajor = false) const;
+
+    // needed because the version with stopping criterion would be a
+    // better match for non-const options
+    template <class U, class C1, class T, class C2>
+    void predictProbabilities(MultiArrayView<2, U, C1>const &   features,
+                              MultiArrayView<2, T, C2> &        prob,
+                              ParallelOptions &                 options,
+                              bool                              treeMajor = false) const
+    {
+        predictProbabilities(features, prob, 
+                             static_cast<ParallelOptions const &>(options), treeMajor);
+    }
+
     template <class U, class C1, class T, class C2>
     void predictRaw(MultiArrayView<2, U, C1>const &   features,
                     MultiArrayView<2, T, C2> &        prob)  const;
@@ -989,6 +1135,115 @@ void RandomForest<LabelType, PreprocessorTag>::
 }
 
 
+template <class LabelType, class PreprocessorTag>
+template <class U, class C1,
+         class U2,class C2,
+         class Split_t,
+         class Stop_t,
+         class Visitor_t,
+         class Random_t>
+void RandomForest<LabelType, PreprocessorTag>::
+                     learn( MultiArrayView<2, U, C1> const  &   features,
+                            MultiArrayView<2, U2,C2> const  &   response,
+                            Visitor_t                           visitor_,
+                            Split_t                             split_,
+                            Stop_t                              stop_,
+                            Random_t                 const  &   random,
+                            ParallelOptions          const  &   options)
+{
+    using namespace rf;
+    //typedefs
+    typedef          UniformIntRandomFunctor<Random_t>
+                                                    RandFunctor_t;
+
+    // See rf_preprocessing.hxx for more info on this
+    typedef Processor<PreprocessorTag,LabelType, U, C1, U2, C2> Preprocessor_t;
+
+    vigra_precondition(features.shape(0) == response.shape(0),
+        "RandomForest::learn(): shape mismatch between features and response.");
+    vigra_precondition(!options_.prepare_online_learning_,
+        "RandomForest::learn(): online learning is not supported by parallel learning.");
+
+    #define RF_CHOOSER(type_) detail::Value_Chooser<type_, Default_##type_> 
+    Default_Stop_t default_stop(options_);
+    typename RF_CHOOSER(Stop_t)::type stop
+            = RF_CHOOSER(Stop_t)::choose(stop_, default_stop); 
+    Default_Split_t default_split;
+    typename RF_CHOOSER(Split_t)::type split 
+            = RF_CHOOSER(Split_t)::choose(split_, default_split); 
+    rf::visitors::StopVisiting stopvisiting;
+    typedef typename RF_CHOOSER(Visitor_t)::type Visitor;
+    Visitor visitor = RF_CHOOSER(Visitor_t)::choose(visitor_, stopvisiting);
+    #undef RF_CHOOSER
+    online_visitor_.deactivate();
+
+    // Preprocess the data and fill the ext_param structure.
+    Preprocessor_t preprocessor(    features, response,
+                                    options_, ext_param_);
+
+    // Give the Split functor information about the data.
+    split.set_external_parameters(ext_param_);
+    stop.set_external_parameters(ext_param_);
+
+    //initialize trees.
+    trees_.resize(options_.tree_count_  , DecisionTree_t(ext_param_));
+
+    // Draw the seeds of the per-tree random number generators up front,
+    // so that the result does not depend on the scheduling of the trees.
+    ArrayVector<UInt32> seeds(trees_.size());
+    for(unsigned int k = 0; k < seeds.size(); ++k)
+        seeds[k] = random();
+
+    SamplerOptions sampler_options = detail::make_sampler_opt(options_)
+                                        .sampleSize(ext_param().actual_msample_);
+
+    // the default visitor does nothing, no need to lock it
+    threading::mutex visitor_mutex;
+    detail::SynchronizedVisitor<Visitor> 
+        synchronized_visitor(visitor, 
+                             IsSameType<Visitor, rf::visitors::StopVisiting>::value
+                                 ? 0
+                                 : &visitor_mutex);
+
+    visitor.visit_at_beginning(*this, preprocessor);
+
+    parallel_foreach(options, (std::ptrdiff_t)trees_.size(),
+        [&](int, std::ptrdiff_t ii)
+        {
+            Random_t        tree_random(seeds[ii]);
+            RandFunctor_t   randint(tree_random);
+            Sampler<Random_t > sampler(preprocessor.strata().begin(),
+                                       preprocessor.strata().end(),
+                                       sampler_options,
+                                       tree_random);
+            sampler.sample();
+            StackEntry_t
+                first_stack_entry(  sampler.sampledIndices().begin(),
+                                    sampler.sampledIndices().end(),
+                                    ext_param_.class_count_);
+            first_stack_entry
+                .set_oob_range(     sampler.oobIndices().begin(),
+                                    sampler.oobIndices().end());
+            trees_[ii]
+                .learn(             preprocessor.features(),
+                                    preprocessor.response(),
+                                    first_stack_entry,
+                                    split,
+                                    stop,
+                                    synchronized_visitor,
+                                    randint);
+            synchronized_visitor
+                .visit_after_tree(  *this,
+                                    preprocessor,
+                                    sampler,
+                                    first_stack_entry,
+                                    (int)ii);
+        });
+
+    visitor.visit_at_end(*this, preprocessor);
+}
+
+
 
 
 template <class LabelType, class Tag>
@@ -1255,6 +1510,79 @@ void RandomForest<LabelType, PreprocessorTag>
 
 }
 
+template <class LabelType, class PreprocessorTag>
+template <class U, class C1, class T, class C2>
+void RandomForest<LabelType, PreprocessorTag>
+    ::predictProbabilities(MultiArrayView<2, U, C1>const &  features,
+                           MultiArrayView<2, T, C2> &       prob,
+                           ParallelOptions const &          options,
+                           bool                             treeMajor) const
+{
+    vigra_precondition(rowCount(features) == rowCount(prob),
+      "RandomForestn::predictProbabilities():"
+        " Feature matrix and probability matrix size mismatch.");
+    vigra_precondition( columnCount(features) >= ext_param_.column_count_,
+      "RandomForestn::predictProbabilities():"
+        " Too few columns in feature matrix.");
+    vigra_precondition( columnCount(prob)
+                        == (MultiArrayIndex)ext_param_.class_count_,
+      "RandomForestn::predictProbabilities():"
+      " Probability matrix must have as many columns as there are classes.");
+
+    // number of rows passed through a tree at once in tree-major mode
+    static const MultiArrayIndex blockSize = 256;
+
+    MultiArrayIndex rows = rowCount(features);
+    ThreadPool pool(options);
+    MultiArrayIndex chunkSize = detail::parallelChunkSize(pool, rows, blockSize);
+    MultiArrayIndex chunkCount = (rows + chunkSize - 1) / chunkSize;
+    int weighted = options_.predict_weighted_;
+    int classCount = ext_param_.class_count_;
+
+    parallel_foreach(pool, chunkCount,
+        [&](int, MultiArrayIndex chunk)
+        {
+            MultiArrayIndex chunkBegin = chunk*chunkSize,
+                            chunkEnd   = std::min(chunkBegin + chunkSize, rows);
+            ArrayVector<double> totalWeight(treeMajor ? blockSize : 1);
+
+            for(MultiArrayIndex begin = chunkBegin; begin < chunkEnd; )
+            {
+                MultiArrayIndex end = treeMajor 
+                                          ? std::min(begin + blockSize, chunkEnd)
+                                          : begin + 1;
+                for(MultiArrayIndex row = begin; row < end; ++row)
+                {
+                    rowVector(prob, row).init(NumericTraits<T>::zero());
+                    totalWeight[row - begin] = 0.0;
+                }
+
+                //Let each tree classify the rows of the current block
+                for(int k=0; k<options_.tree_count_; ++k)
+                {
+                    for(MultiArrayIndex row = begin; row < end; ++row)
+                    {
+                        ArrayVector<double>::const_iterator weights 
+                                        = trees_[k].predict(rowVector(features, row));
+                        for(int l=0; l<classCount; ++l)
+                        {
+                            double cur_w = weights[l] * (weighted * (*(weights-1))
+                                                       + (1-weighted));
+                            prob(row, l) += (T)cur_w;
+                            totalWeight[row - begin] += cur_w;
+                        }
+                    }
+                }
+
+                //Normalise votes in each row by total VoteCount
+                for(MultiArrayIndex row = begin; row < end; ++row)
+                    for(int l=0; l<classCount; ++l)
+                        prob(row, l) /= detail::RequiresExplicitCast<T>::cast(totalWeight[row - begin]);
+                begin = end;
+            }
+        });
+}
+
 template <class LabelType, class PreprocessorTag>
 template <class U, class C1, class T, class C2>
 void RandomForest<LabelType, PreprocessorTag>
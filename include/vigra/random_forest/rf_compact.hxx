@@ -0,0 +1,429 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2014 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_RANDOM_FOREST_COMPACT_HXX
+#define VIGRA_RANDOM_FOREST_COMPACT_HXX
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "vigra/multi_array.hxx"
+#include "vigra/array_vector.hxx"
+#include "vigra/sized_int.hxx"
+#include "vigra/matrix.hxx"
+#include "vigra/threadpool.hxx"
+
+#include "rf_common.hxx"
+#include "rf_nodeproxy.hxx"
+
+namespace vigra
+{
+
+/** Node of a CompactRandomForest.
+
+    Internal nodes store the feature column, the threshold and the index
+    of the left child. The right child is always stored directly after the
+    left one. Leaf nodes point to themselves: they have column 0, threshold
+    <tt>-inf</tt> and <tt>child</tt> equal to their own index minus one, so that
+    a traversal can simply run for a fixed number of steps.
+*/
+struct CompactTreeNode
+{
+    Int32 column;
+    float threshold;
+    Int32 child;
+};
+
+/** Inference-optimized representation of a trained RandomForest.
+
+    \ingroup MachineLearning
+
+    The DecisionTree class stores the nodes in two arrays of variable-sized
+    records (topology and parameters) that are decoded by NodeProxy on
+    every visit. CompactRandomForest converts a trained forest into
+
+    <ul>
+    <li> a single array of fixed-size CompactTreeNode records (12 bytes),
+         where the nodes of each tree are stored in breadth-first order,
+         so that the top levels of a tree occupy only a few cache lines,
+    <li> the index of the leaf reached in each node (-1 for internal nodes),
+    <li> a contiguous table of leaf probabilities (<tt>class_count()</tt> values
+         per leaf, already multiplied with the leaf weight if the forest
+         was trained with <tt>predict_weighted()</tt>).
+    </ul>
+
+    The leaf probabilities are stored and accumulated with the type
+    <tt>ProbabilityType</tt>. With <tt>ProbabilityType = float</tt>, the entire
+    prediction (features, thresholds, leaf probabilities, and the results)
+    runs in single precision, which halves the memory needed for the
+    probability table and the memory traffic during prediction. The results
+    then agree with the ones of RandomForest up to float rounding errors.
+
+    Since leaves point to themselves, prediction runs a fixed number of
+    steps (the depth of the tree) without checking for leaves and pushes
+    several rows through a tree in an interleaved fashion. This avoids
+    mispredicted branches and hides memory latency.
+
+    The thresholds are stored as float, rounded up to the next representable
+    value. Therefore, the comparison <tt>feature < threshold</tt> gives the same
+    result as in the original forest for all features of type float (and
+    integers up to 2<sup>24</sup>). Double features that fall between the original
+    threshold and its float approximation may be sent into the other child.
+
+    Only forests built with threshold splits (the default GiniSplit, as well as
+    the other ThresholdSplit variants) can be converted.
+
+    <b>Usage:</b>
+
+    <b>\#include</b> \<vigra/random_forest.hxx\><br>
+    Namespace: vigra
+
+    \code
+    RandomForest<> rf(RandomForestOptions().tree_count(255));
+    rf.learn(features, labels);
+
+    CompactRandomForest<> compact(rf);
+    MultiArray<2, double> prob(Shape2(newFeatures.shape(0), compact.class_count()));
+    compact.predictProbabilities(newFeatures, prob, ParallelOptions().numThreads(8));
+
+    // single precision throughout
+    MultiArray<2, float> newFloatFeatures(newFeatures), 
+                         floatProb(Shape2(newFeatures.shape(0), compact.class_count()));
+    CompactRandomForest<double, float> compactFloat(rf);
+    compactFloat.predictProbabilities(newFloatFeatures, floatProb);
+    \endcode
+*/
+template <class LabelType = double, class ProbabilityType = double>
+class CompactRandomForest
+{
+  public:
+    typedef ProblemSpec<LabelType>      ProblemSpec_t;
+    typedef CompactTreeNode             Node_t;
+    typedef ProbabilityType             Probability_t;
+
+        /** Convert a trained RandomForest.
+        */
+    template <class RF>
+    explicit CompactRandomForest(RF const & rf)
+    : ext_param_(rf.ext_param()),
+      class_count_(rf.class_count()),
+      feature_count_(rf.feature_count())
+    {
+        bool weighted = rf.options().predict_weighted_;
+        for(int k=0; k<rf.tree_count(); ++k)
+            addTree(rf.tree(k), weighted);
+    }
+
+        /** the number of trees.
+        */
+    int tree_count() const
+    {
+        return roots_.size();
+    }
+
+        /** the number of classes.
+        */
+    int class_count() const
+    {
+        return class_count_;
+    }
+
+        /** the number of features used during training.
+        */
+    int feature_count() const
+    {
+        return feature_count_;
+    }
+
+        /** the external parameters of the original forest.
+        */
+    ProblemSpec_t const & ext_param() const
+    {
+        return ext_param_;
+    }
+
+        /** the nodes of all trees.
+        */
+    ArrayVector<Node_t> const & nodes() const
+    {
+        return nodes_;
+    }
+
+        /** index of the root node of each tree in nodes().
+        */
+    ArrayVector<Int32> const & roots() const
+    {
+        return roots_;
+    }
+
+        /** the depth of each tree.
+        */
+    ArrayVector<Int32> const & depths() const
+    {
+        return depths_;
+    }
+
+        /** index of the leaf in leafProbabilities() for each leaf node,
+            -1 for internal nodes.
+        */
+    ArrayVector<Int32> const & leafIndices() const
+    {
+        return leaf_indices_;
+    }
+
+        /** the leaf probabilities (<tt>class_count()</tt> values per leaf).
+        */
+    ArrayVector<Probability_t> const & leafProbabilities() const
+    {
+        return leaf_probabilities_;
+    }
+
+        /** Return the leaf index (i.e. the row in leafProbabilities() / class_count())
+            reached by the given row of the feature matrix in the given tree.
+        */
+    template <class U, class C>
+    Int32 getToLeaf(MultiArrayView<2, U, C> const & features,
+                    MultiArrayIndex row, int tree) const
+    {
+        Node_t const * nodes = nodes_.data();
+        Int32 node = roots_[tree];
+        for(int d=0; d<depths_[tree]; ++d)
+            node = nodes[node].child +
+                   (features(row, nodes[node].column) < nodes[node].threshold ? 0 : 1);
+        return leaf_indices_[node];
+    }
+
+        /** Predict the class probabilities of all rows of \a features.
+
+            \a prob must be a n x class_count() matrix. The results are the same
+            as those of RandomForest::predictProbabilities() (up to the
+            float threshold approximation described above).
+        */
+    template <class U, class C1, class T, class C2>
+    void predictProbabilities(MultiArrayView<2, U, C1> const & features,
+                              MultiArrayView<2, T, C2> & prob) const
+    {
+        checkShapes(features, prob);
+        predictProbabilitiesImpl(features, prob, 0, rowCount(features));
+    }
+
+        /** Same as above, but distributes the rows over the given number of threads.
+        */
+    template <class U, class C1, class T, class C2>
+    void predictProbabilities(MultiArrayView<2, U, C1> const & features,
+                              MultiArrayView<2, T, C2> & prob,
+                              ParallelOptions const & options) const
+    {
+        checkShapes(features, prob);
+        MultiArrayIndex rows = rowCount(features);
+        ThreadPool pool(options);
+        MultiArrayIndex chunkSize = detail::parallelChunkSize(pool, rows, blockSize);
+        MultiArrayIndex chunkCount = (rows + chunkSize - 1) / chunkSize;
+        parallel_foreach(pool, chunkCount,
+            [&](int, MultiArrayIndex chunk)
+            {
+                MultiArrayIndex begin = chunk*chunkSize;
+                predictProbabilitiesImpl(features, prob, begin,
+                                         std::min(begin + chunkSize, rows));
+            });
+    }
+
+        /** Predict the labels of all rows of \a features.
+
+            \a labels must be a n x 1 matrix.
+        */
+    template <class U, class C1, class T, class C2>
+    void predictLabels(MultiArrayView<2, U, C1> const & features,
+                       MultiArrayView<2, T, C2> & labels,
+                       ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads)) const
+    {
+        vigra_precondition(rowCount(features) == rowCount(labels),
+            "CompactRandomForest::predictLabels(): Label array has wrong size.");
+        MultiArray<2, Probability_t> prob(Shape2(rowCount(features), class_count_));
+        predictProbabilities(features, prob, options);
+        for(MultiArrayIndex k=0; k<rowCount(features); ++k)
+        {
+            LabelType d;
+            ext_param_.to_classlabel(argMax(rowVector(prob, k)), d);
+            labels(k,0) = detail::RequiresExplicitCast<T>::cast(d);
+        }
+    }
+
+  private:
+    // number of rows passed through a tree at once, and number
+    // of rows whose traversals are interleaved
+    enum { blockSize = 256, groupSize = 8 };
+
+    template <class U, class C1, class T, class C2>
+    void checkShapes(MultiArrayView<2, U, C1> const & features,
+                     MultiArrayView<2, T, C2> & prob) const
+    {
+        vigra_precondition(rowCount(features) == rowCount(prob),
+          "CompactRandomForest::predictProbabilities():"
+            " Feature matrix and probability matrix size mismatch.");
+        vigra_precondition(columnCount(features) >= feature_count_,
+          "CompactRandomForest::predictProbabilities():"
+            " Too few columns in feature matrix.");
+        vigra_precondition(columnCount(prob) == (MultiArrayIndex)class_count_,
+          "CompactRandomForest::predictProbabilities():"
+          " Probability matrix must have as many columns as there are classes.");
+    }
+
+    template <class U, class C1, class T, class C2>
+    void predictProbabilitiesImpl(MultiArrayView<2, U, C1> const & features,
+                                  MultiArrayView<2, T, C2> & prob,
+                                  MultiArrayIndex rowBegin, MultiArrayIndex rowEnd) const
+    {
+        ArrayVector<Probability_t> totalWeight(blockSize);
+        for(MultiArrayIndex begin = rowBegin; begin < rowEnd; begin += blockSize)
+        {
+            MultiArrayIndex end = std::min(begin + blockSize, rowEnd);
+            for(MultiArrayIndex row = begin; row < end; ++row)
+            {
+                rowVector(prob, row).init(NumericTraits<T>::zero());
+                totalWeight[row - begin] = NumericTraits<Probability_t>::zero();
+            }
+            // pass the block through one tree at a time, the votes of each row
+            // are accumulated in the same order as in RandomForest
+            for(int k=0; k<tree_count(); ++k)
+            {
+                for(MultiArrayIndex group = begin; group < end; group += groupSize)
+                {
+                    int count = (int)std::min<MultiArrayIndex>(groupSize, end - group);
+                    Int32 node[groupSize];
+                    for(int g=0; g<count; ++g)
+                        node[g] = roots_[k];
+                    for(int d=0; d<depths_[k]; ++d)
+                    {
+                        for(int g=0; g<count; ++g)
+                        {
+                            Node_t const & n = nodes_[node[g]];
+                            node[g] = n.child + (features(group+g, n.column) < n.threshold ? 0 : 1);
+                        }
+                    }
+                    for(int g=0; g<count; ++g)
+                    {
+                        MultiArrayIndex row = group + g;
+                        Probability_t const * weights = leaf_probabilities_.data() +
+                                                 leaf_indices_[node[g]]*class_count_;
+                        for(int l=0; l<class_count_; ++l)
+                        {
+                            prob(row, l) += (T)weights[l];
+                            totalWeight[row - begin] += weights[l];
+                        }
+                    }
+                }
+            }
+            for(MultiArrayIndex row = begin; row < end; ++row)
+                for(int l=0; l<class_count_; ++l)
+                    prob(row, l) /= detail::RequiresExplicitCast<T>::cast(totalWeight[row - begin]);
+        }
+    }
+
+    // smallest float which is not smaller than t, so that 'f < t' and
+    // 'f < roundUp(t)' are equivalent for every float f
+    static float roundUp(double t)
+    {
+        float res = static_cast<float>(t);
+        if(res < t)
+            res = std::nextafter(res, std::numeric_limits<float>::infinity());
+        return res;
+    }
+
+    template <class Tree>
+    void addTree(Tree const & tree, bool weighted)
+    {
+        typedef typename Tree::TreeInt TreeInt;
+
+        // breadth-first traversal, 'queue' holds the indices of the
+        // original nodes in the order of the new nodes
+        ArrayVector<TreeInt> queue;
+        ArrayVector<Int32> depth;
+        Int32 base = nodes_.size();
+        roots_.push_back(base);
+        depths_.push_back(0);
+        queue.push_back(2);
+        depth.push_back(0);
+        nodes_.push_back(Node_t());
+        leaf_indices_.push_back(-1);
+        for(unsigned int k = 0; k < queue.size(); ++k)
+        {
+            TreeInt index = queue[k];
+            Node_t & node = nodes_[base + k];
+            if(tree.topology_[index] == e_ConstProbNode)
+            {
+                Node<e_ConstProbNode> leaf(tree.topology_, tree.parameters_, index);
+                node.column = 0;
+                node.threshold = -std::numeric_limits<float>::infinity();
+                node.child = base + k - 1;
+                leaf_indices_[base + k] = leaf_probabilities_.size() / class_count_;
+                depths_.back() = std::max(depths_.back(), depth[k]);
+                double w = weighted ? leaf.weights() : 1.0;
+                for(int l=0; l<class_count_; ++l)
+                    leaf_probabilities_.push_back(static_cast<Probability_t>(leaf.prob_begin()[l] * w));
+            }
+            else
+            {
+                vigra_precondition(tree.topology_[index] == i_ThresholdNode,
+                    "CompactRandomForest(): only threshold splits are supported.");
+                Node<i_ThresholdNode> split(tree.topology_, tree.parameters_, index);
+                node.column = split.column();
+                node.threshold = roundUp(split.threshold());
+                node.child = base + queue.size();
+                queue.push_back(split.child(0));
+                queue.push_back(split.child(1));
+                depth.push_back(depth[k] + 1);
+                depth.push_back(depth[k] + 1);
+                nodes_.push_back(Node_t());
+                nodes_.push_back(Node_t());
+                leaf_indices_.push_back(-1);
+                leaf_indices_.push_back(-1);
+            }
+        }
+    }
+
+    ProblemSpec_t           ext_param_;
+    int                     class_count_;
+    int                     feature_count_;
+    ArrayVector<Node_t>     nodes_;
+    ArrayVector<Int32>      roots_;
+    ArrayVector<Int32>      depths_;
+    ArrayVector<Int32>      leaf_indices_;
+    ArrayVector<Probability_t>  leaf_probabilities_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA_RANDOM_FOREST_COMPACT_HXX
@@ -37,6 +37,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <map>
+#include <memory>
 #include <numeric>
 #include <math.h>
 #include "../mathutil.hxx"
@@ -45,6 +46,8 @@
 #include "../matrix.hxx"
 #include "../random.hxx"
 #include "../functorexpression.hxx"
+#include "../multi_array.hxx"
+#include "../threading.hxx"
 #include "rf_nodeproxy.hxx"
 //#include "rf_sampling.hxx"
 #include "rf_region.hxx"
@@ -1129,6 +1132,320 @@ typedef  ThresholdSplit<BestGiniOfColumn<GiniCriterion> >                      G
 typedef  ThresholdSplit<BestGiniOfColumn<EntropyCriterion> >                 EntropySplit;
 typedef  ThresholdSplit<BestGiniOfColumn<LSQLoss>, RegressionTag>              RegressionSplit;
 
+namespace detail
+{
+
+/** Quantization of all feature columns into at most 256 bins, shared by
+    all copies of a HistogramSplit (i.e. by all trees of a forest).
+ */
+class FeatureBins
+{
+  public:
+    MultiArray<2, UInt8>                bins_;
+    ArrayVector<ArrayVector<double> >   thresholds_;
+    void const *                        data_;
+    threading::once_flag                once_;
+
+    FeatureBins()
+    : data_(0)
+    {}
+
+    /** quantize the features (only in the first call, later calls
+     *  return immediately). 
+     */
+    template<class T, class C>
+    void init(MultiArrayView<2, T, C> const & features, int max_bins)
+    {
+        threading::call_once(once_, &FeatureBins::template quantize<T, C>, 
+                             this, features, max_bins);
+        vigra_precondition(data_ == features.data() && bins_.shape() == features.shape(),
+            "HistogramSplit::findBestSplit(): features differ from the ones used for quantization.");
+    }
+
+    /** bin of sample 'row' in column 'column'. Samples in bins 0 ... b
+     *  have a value less than thresholds_[column][b].
+     */
+    int operator()(MultiArrayIndex row, MultiArrayIndex column) const
+    {
+        return bins_(row, column);
+    }
+
+    int binCount(MultiArrayIndex column) const
+    {
+        return thresholds_[column].size() + 1;
+    }
+
+  private:
+    template<class T, class C>
+    void quantize(MultiArrayView<2, T, C> const & features, int max_bins)
+    {
+        MultiArrayIndex sample_count = features.shape(0);
+        bins_.reshape(features.shape());
+        thresholds_.resize(features.shape(1));
+        data_ = features.data();
+
+        ArrayVector<double> values(sample_count);
+        for(MultiArrayIndex k = 0; k < features.shape(1); ++k)
+        {
+            for(MultiArrayIndex i = 0; i < sample_count; ++i)
+                values[i] = features(i, k);
+            std::sort(values.begin(), values.end());
+
+            // place the thresholds between distinct values, such that every 
+            // bin holds about sample_count / max_bins samples (or use all
+            // distinct values when there are few enough)
+            ArrayVector<double> & thresholds = thresholds_[k];
+            thresholds.clear();
+            MultiArrayIndex distinct = 1;
+            for(MultiArrayIndex i = 1; i < sample_count; ++i)
+                if(values[i] != values[i-1])
+                    ++distinct;
+            double step = distinct <= max_bins
+                              ? 0.0
+                              : double(sample_count) / max_bins;
+            double next_boundary = step;
+            for(MultiArrayIndex i = 1; i < sample_count; ++i)
+            {
+                if(values[i] == values[i-1] || i < next_boundary)
+                    continue;
+                double t = (values[i-1] + values[i]) / 2.0;
+                thresholds.push_back(t > values[i-1] ? t : values[i]);
+                if(step > 0.0)
+                    next_boundary = (std::floor(i / step) + 1.0)*step;
+            }
+
+            for(MultiArrayIndex i = 0; i < sample_count; ++i)
+                bins_(i, k) = (UInt8)(std::upper_bound(thresholds.begin(), thresholds.end(), 
+                                                       (double)features(i, k)) 
+                                      - thresholds.begin());
+        }
+    }
+};
+
+} // namespace detail
+
+/** Split functor for classification that searches thresholds on quantized features.
+
+    Before the first split, every feature column is quantized into at most 
+    <tt>max_bins</tt> (&lt;= 256) bins of approximately equal population. The 
+    quantization is computed once per call to RandomForest::learn() and shared 
+    by all trees. A split is then found by accumulating the class histogram of 
+    every bin in a single pass over the samples in the node, followed by a 
+    sweep over the bins. This replaces the O(n log n) sorting in \ref GiniSplit
+    by an O(n + bins) operation per candidate feature. When a feature has at 
+    most <tt>max_bins</tt> distinct values, all thresholds considered by
+    \ref GiniSplit are tried, so that the partitions of the training data
+    are the same. Otherwise, the thresholds are restricted to the bin borders, 
+    which usually affects the accuracy of the forest only marginally.
+
+    The impurity is given by the template parameter (\ref GiniCriterion or 
+    \ref EntropyCriterion). Use it like the other split functors:
+
+    \code
+    RandomForest<> rf(RandomForestOptions().tree_count(255));
+    rf.learn(features, labels, rf_default(), HistogramGiniSplit(), rf_default(), 
+             RandomMT19937(1));
+    \endcode
+*/
+template<class Impurity = GiniCriterion>
+class HistogramSplit: public SplitBase<ClassificationTag>
+{
+  public:
+
+    typedef SplitBase<ClassificationTag> SB;
+
+    ArrayVector<Int32>          splitColumns;
+    Impurity                    impurity_;
+
+    double                      region_gini_;
+    ArrayVector<double>         min_gini_;
+    ArrayVector<double>         min_thresholds_;
+
+    int                         bestSplitIndex;
+
+    /** \param max_bins   maximum number of bins per feature (2 ... 256)
+     */
+    HistogramSplit(int max_bins = 256)
+    : max_bins_(max_bins)
+    {
+        vigra_precondition(max_bins >= 2 && max_bins <= 256,
+            "HistogramSplit(): max_bins must be in [2, 256].");
+    }
+
+    double minGini() const
+    {
+        return min_gini_[bestSplitIndex];
+    }
+    int bestSplitColumn() const
+    {
+        return splitColumns[bestSplitIndex];
+    }
+    double bestSplitThreshold() const
+    {
+        return min_thresholds_[bestSplitIndex];
+    }
+
+    template<class T>
+    void set_external_parameters(ProblemSpec<T> const & in)
+    {
+        SB::set_external_parameters(in);        
+        int featureCount_ = SB::ext_param_.column_count_;
+        splitColumns.resize(featureCount_);
+        for(int k=0; k<featureCount_; ++k)
+            splitColumns[k] = k;
+        min_gini_.resize(featureCount_);
+        min_thresholds_.resize(featureCount_);
+        histogram_.resize(max_bins_*SB::ext_param_.class_count_);
+        bin_sizes_.resize(max_bins_);
+        counts_[0].resize(SB::ext_param_.class_count_);
+        counts_[1].resize(SB::ext_param_.class_count_);
+        bestCounts_[0].resize(SB::ext_param_.class_count_);
+        bestCounts_[1].resize(SB::ext_param_.class_count_);
+        // new training data => new quantization
+        bins_.reset(new detail::FeatureBins);
+    }
+
+    template<class T, class C, class T2, class C2, class Region, class Random>
+    int findBestSplit(MultiArrayView<2, T, C> features,
+                      MultiArrayView<2, T2, C2>  labels,
+                      Region & region,
+                      ArrayVector<Region>& childRegions,
+                      Random & randint)
+    {
+        typedef typename Region::IndexIterator IndexIterator;
+        if(region.size() == 0)
+        {
+           std::cerr << "SplitFunctor::findBestSplit(): stackentry with 0 examples encountered\n"
+                        "continuing learning process...."; 
+        }
+        // calculate things that haven't been calculated yet. 
+        detail::Correction<ClassificationTag>::exec(region, labels);
+
+        // Is the region pure already?
+        double region_total = std::accumulate(region.classCounts().begin(),
+                                              region.classCounts().end(), 0.0);
+        region_gini_ = impurity_(region.classCounts(), SB::ext_param_.class_weights_, 
+                                 region_total);
+        if(region_gini_ <= SB::ext_param_.precision_)
+            return  this->makeTerminalNode(features, labels, region, randint);
+
+        bins_->init(features, max_bins_);
+
+        // select columns  to be tried.
+        for(int ii = 0; ii < SB::ext_param_.actual_mtry_; ++ii)
+            std::swap(splitColumns[ii], 
+                      splitColumns[ii+ randint(features.shape(1) - ii)]);
+
+        // find the best gini index
+        int class_count             = SB::ext_param_.class_count_;
+        bestSplitIndex              = 0;
+        double  current_min_gini    = region_gini_;
+        int     num2try             = features.shape(1);
+        for(int k=0; k<num2try; ++k)
+        {
+            int column    = splitColumns[k];
+            int bin_count = bins_->binCount(column);
+
+            // class histogram of every bin
+            std::fill(histogram_.begin(), histogram_.begin() + bin_count*class_count, 0.0);
+            std::fill(bin_sizes_.begin(), bin_sizes_.begin() + bin_count, 0.0);
+            for(IndexIterator i = region.begin(); i != region.end(); ++i)
+            {
+                int bin = (*bins_)(*i, column);
+                histogram_[bin*class_count + (int)labels(*i, 0)] += 1.0;
+                bin_sizes_[bin] += 1.0;
+            }
+
+            // sweep over the bin borders
+            counts_[0].init(0.0);
+            counts_[1] = region.classCounts();
+            double left_total = 0.0, 
+                   right_total = region_total;
+            min_gini_[k] = region_gini_;
+            min_thresholds_[k] = 0.0;
+            for(int b = 0; b < bin_count - 1; ++b)
+            {
+                if(bin_sizes_[b] == 0.0)
+                    continue;
+                for(int c = 0; c < class_count; ++c)
+                {
+                    counts_[0][c] += histogram_[b*class_count + c];
+                    counts_[1][c] -= histogram_[b*class_count + c];
+                }
+                left_total  += bin_sizes_[b];
+                right_total -= bin_sizes_[b];
+                if(right_total == 0.0)
+                    break;
+                double loss = impurity_(counts_[0], SB::ext_param_.class_weights_, left_total) +
+                              impurity_(counts_[1], SB::ext_param_.class_weights_, right_total);
+#ifdef CLASSIFIER_TEST
+                if(loss < min_gini_[k] && !closeAtTolerance(loss, min_gini_[k]))
+#else
+                if(loss < min_gini_[k])
+#endif 
+                {
+                    min_gini_[k]       = loss;
+                    min_thresholds_[k] = bins_->thresholds_[column][b];
+                    if(loss < current_min_gini)
+                    {
+                        bestCounts_[0] = counts_[0];
+                        bestCounts_[1] = counts_[1];
+                    }
+                }
+            }
+#ifdef CLASSIFIER_TEST
+            if(     min_gini_[k] < current_min_gini
+               &&  !closeAtTolerance(min_gini_[k], current_min_gini))
+#else
+            if(min_gini_[k] < current_min_gini)
+#endif
+            {
+                current_min_gini = min_gini_[k];
+                childRegions[0].classCounts() = bestCounts_[0];
+                childRegions[1].classCounts() = bestCounts_[1];
+                childRegions[0].classCountsIsValid = true;
+                childRegions[1].classCountsIsValid = true;
+
+                bestSplitIndex   = k;
+                num2try = SB::ext_param_.actual_mtry_;
+            }
+        }
+        // did not find any suitable split
+        if(closeAtTolerance(current_min_gini, region_gini_))
+            return  this->makeTerminalNode(features, labels, region, randint);
+        
+        //create a Node for output
+        Node<i_ThresholdNode>   node(SB::t_data, SB::p_data);
+        SB::node_ = node;
+        node.threshold()    = min_thresholds_[bestSplitIndex];
+        node.column()       = splitColumns[bestSplitIndex];
+        
+        // partition the range according to the best dimension 
+        SortSamplesByDimensions<MultiArrayView<2, T, C> > 
+            sorter(features, node.column(), node.threshold());
+        IndexIterator bestSplit =
+            std::partition(region.begin(), region.end(), sorter);
+        // Save the ranges of the child stack entries.
+        childRegions[0].setRange(   region.begin()  , bestSplit       );
+        childRegions[0].rule = region.rule;
+        childRegions[0].rule.push_back(std::make_pair(1, 1.0));
+        childRegions[1].setRange(   bestSplit       , region.end()    );
+        childRegions[1].rule = region.rule;
+        childRegions[1].rule.push_back(std::make_pair(1, 1.0));
+
+        return i_ThresholdNode;
+    }
+
+  private:
+    int                                     max_bins_;
+    std::shared_ptr<detail::FeatureBins>    bins_;
+    ArrayVector<double>                     histogram_, bin_sizes_;
+    ArrayVector<double>                     counts_[2], bestCounts_[2];
+};
+
+typedef  HistogramSplit<GiniCriterion>      HistogramGiniSplit;
+typedef  HistogramSplit<EntropyCriterion>   HistogramEntropySplit;
+
 namespace rf
 {
 
@@ -37,7 +37,6 @@
 #define VIGRA_SEEDEDREGIONGROWING_HXX
 
 #include <vector>
-#include <stack>
 #include <queue>
 #include "utilities.hxx"
 #include "stdimage.hxx"
@@ -102,53 +101,102 @@ public:
 
             return r.cost_ < l.cost_;
         }
-        bool operator()(SeedRgPixel const * l,
-                        SeedRgPixel const * r) const
-        {
-            if(r->cost_ == l->cost_)
-            {
-                if(r->dist_ == l->dist_) return r->count_ < l->count_;
+    };
+};
 
-                return r->dist_ < l->dist_;
-            }
+/* Cost types whose values can directly serve as bucket indices,
+   so that region growing can use a bucket queue instead of a heap.
+*/
+template <class COST>
+struct SeedRgBucketTraits
+{
+    enum { useBuckets = false };
+};
 
-            return r->cost_ < l->cost_;
-        }
-    };
+template <>
+struct SeedRgBucketTraits<UInt8>
+{
+    enum { useBuckets = true, minCost = 0, bucketCount = 256 };
+};
+
+template <>
+struct SeedRgBucketTraits<Int8>
+{
+    enum { useBuckets = true, minCost = -128, bucketCount = 256 };
+};
+
+template <>
+struct SeedRgBucketTraits<UInt16>
+{
+    enum { useBuckets = true, minCost = 0, bucketCount = 65536 };
+};
+
+template <>
+struct SeedRgBucketTraits<Int16>
+{
+    enum { useBuckets = true, minCost = -32768, bucketCount = 65536 };
+};
+
+/* Priority queue of candidate pixels (or voxels) for seeded region growing.
+   Candidates are stored by value. For general cost types, this is a heap.
+   For small integer costs, the candidates are distributed into one bucket 
+   per cost value, and only the candidates of equal cost (typically few)
+   are ordered by a heap according to their distance from the seed and
+   insertion order. This gives the same processing order as the global heap.
+*/
+template <class Pixel, class COST,
+          bool UseBuckets = (bool)SeedRgBucketTraits<COST>::useBuckets>
+class SeedRgQueue
+: public std::priority_queue<Pixel, std::vector<Pixel>, typename Pixel::Compare>
+{};
+
+template <class Pixel, class COST>
+class SeedRgQueue<Pixel, COST, true>
+{
+    typedef SeedRgBucketTraits<COST> Traits;
+    typedef std::priority_queue<Pixel, std::vector<Pixel>, typename Pixel::Compare> Bucket;
+
+    ArrayVector<Bucket> buckets_;
+    std::size_t size_;
+    std::ptrdiff_t top_;
+
+  public:
+    SeedRgQueue()
+    : buckets_((std::size_t)Traits::bucketCount),
+      size_(0), top_((std::ptrdiff_t)Traits::bucketCount)
+    {}
 
-    struct Allocator
+    std::size_t size() const
     {
-        ~Allocator()
-        {
-            while(!freelist_.empty())
-            {
-                delete freelist_.top();
-                freelist_.pop();
-            }
-        }
+        return size_;
+    }
 
-        SeedRgPixel *
-        create(Point2D const & location, Point2D const & nearest,
-               COST const & cost, int const & count, int const & label)
-        {
-            if(!freelist_.empty())
-            {
-                SeedRgPixel * res = freelist_.top();
-                freelist_.pop();
-                res->set(location, nearest, cost, count, label);
-                return res;
-            }
+    bool empty() const
+    {
+        return size_ == 0;
+    }
 
-            return new SeedRgPixel(location, nearest, cost, count, label);
-        }
+    Pixel const & top() const
+    {
+        return buckets_[top_].top();
+    }
 
-        void dismiss(SeedRgPixel * p)
-        {
-            freelist_.push(p);
-        }
+    void pop()
+    {
+        --size_;
+        buckets_[top_].pop();
+        while(top_ < (std::ptrdiff_t)Traits::bucketCount && buckets_[top_].empty())
+            ++top_;
+    }
 
-        std::stack<SeedRgPixel<COST> *> freelist_;
-    };
+    void push(Pixel const & pixel)
+    {
+        std::ptrdiff_t index = (std::ptrdiff_t)pixel.cost_ - (std::ptrdiff_t)Traits::minCost;
+        ++size_;
+        buckets_[index].push(pixel);
+        if(index < top_)
+            top_ = index;
+    }
 };
 
 struct UnlabelWatersheds
@@ -396,10 +444,7 @@ seededRegionGrowing(SrcIterator srcul,
     typedef typename RegionStatistics::cost_type CostType;
     typedef detail::SeedRgPixel<CostType> Pixel;
 
-    typename Pixel::Allocator allocator;
-
-    typedef std::priority_queue<Pixel *, std::vector<Pixel *>,
-                                typename Pixel::Compare>  SeedRgPixelHeap;
+    typedef detail::SeedRgQueue<Pixel, CostType>  SeedRgPixelHeap;
 
     // copy seed image in an image with border
     IImage regions(w+2, h+2);
@@ -435,9 +480,7 @@ seededRegionGrowing(SrcIterator srcul,
                     {
                         CostType cost = stats[cneighbor].cost(as(isx));
 
-                        Pixel * pixel =
-                            allocator.create(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor);
-                        pheap.push(pixel);
+                        pheap.push(Pixel(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor));
                     }
                 }
             }
@@ -454,16 +497,12 @@ seededRegionGrowing(SrcIterator srcul,
     // perform region growing
     while(pheap.size() != 0)
     {
-        Pixel * pixel = pheap.top();
+        Point2D pos = pheap.top().location_;
+        Point2D nearest = pheap.top().nearest_;
+        int lab = pheap.top().label_;
+        CostType cost = pheap.top().cost_;
         pheap.pop();
 
-        Point2D pos = pixel->location_;
-        Point2D nearest = pixel->nearest_;
-        int lab = pixel->label_;
-        CostType cost = pixel->cost_;
-
-        allocator.dismiss(pixel);
-
         if((srgType & StopAtThreshold) != 0 && cost > max_cost)
             break;
 
@@ -501,21 +540,12 @@ seededRegionGrowing(SrcIterator srcul,
                 {
                     CostType cost = stats[lab].cost(as(isx, Neighborhood::diff((Direction)i)));
 
-                    Pixel * new_pixel =
-                        allocator.create(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab);
-                    pheap.push(new_pixel);
+                    pheap.push(Pixel(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab));
                 }
             }
         }
     }
     
-    // free temporary memory
-    while(pheap.size() != 0)
-    {
-        allocator.dismiss(pheap.top());
-        pheap.pop();
-    }
-
     // write result
     transformImage(ir, ir+Point2D(w,h), regions.accessor(), destul, ad,
                    detail::UnlabelWatersheds());
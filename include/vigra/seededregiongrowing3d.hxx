@@ -38,7 +38,6 @@
 #define VIGRA_SEEDEDREGIONGROWING_3D_HXX
 
 #include <vector>
-#include <stack>
 #include <queue>
 #include "utilities.hxx"
 #include "stdimage.hxx"
@@ -112,51 +111,6 @@ public:
 
             return r.cost_ < l.cost_;
         }
-        bool operator()(SeedRgVoxel const * l,
-                        SeedRgVoxel const * r) const
-        {
-            if(r->cost_ == l->cost_)
-            {
-                if(r->dist_ == l->dist_) return r->count_ < l->count_;
-
-                return r->dist_ < l->dist_;
-            }
-
-            return r->cost_ < l->cost_;
-        }
-    };
-
-    struct Allocator
-    {
-        ~Allocator()
-        {
-            while(!freelist_.empty())
-            {
-                delete freelist_.top();
-                freelist_.pop();
-            }
-        }
-
-        SeedRgVoxel * create(Diff_type const & location, Diff_type const & nearest,
-                             COST const & cost, int const & count, int const & label)
-        {
-            if(!freelist_.empty())
-            {
-                SeedRgVoxel * res = freelist_.top();
-                freelist_.pop();
-                res->set(location, nearest, cost, count, label);
-                return res;
-            }
-
-            return new SeedRgVoxel(location, nearest, cost, count, label);
-        }
-
-        void dismiss(SeedRgVoxel * p)
-        {
-            freelist_.push(p);
-        }
-
-        std::stack<SeedRgVoxel<COST,Diff_type> *> freelist_;
     };
 };
 
@@ -317,11 +271,8 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     typedef typename PromoteTraits<typename RegionStatistics::cost_type, double>::Promote CostType;
     typedef detail::SeedRgVoxel<CostType, Diff_type> Voxel;
 
-    typename Voxel::Allocator allocator;
-
-    typedef std::priority_queue< Voxel *,
-                                 std::vector<Voxel *>,
-                                 typename Voxel::Compare >  SeedRgVoxelHeap;
+    // small integer costs remain exact after promotion, so they can be bucketed
+    typedef detail::SeedRgQueue<Voxel, typename RegionStatistics::cost_type>  SeedRgVoxelHeap;
     typedef MultiArray<3, int> IVolume;
 
     // copy seed image in an image with border
@@ -373,9 +324,7 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                         {
                             CostType cost = stats[cneighbor].cost(as(isx));
 
-                            Voxel * voxel =
-                                allocator.create(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor);
-                            pheap.push(voxel);
+                            pheap.push(Voxel(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor));
                         }
                     }
                 }
@@ -386,16 +335,12 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     // perform region growing
     while(pheap.size() != 0)
     {
-        Voxel * voxel = pheap.top();
+        Diff_type pos = pheap.top().location_;
+        Diff_type nearest = pheap.top().nearest_;
+        int lab = pheap.top().label_;
+        CostType cost = pheap.top().cost_;
         pheap.pop();
 
-        Diff_type pos = voxel->location_;
-        Diff_type nearest = voxel->nearest_;
-        int lab = voxel->label_;
-        CostType cost = voxel->cost_;
-
-        allocator.dismiss(voxel);
-
         if((srgType & StopAtThreshold) != 0 && cost > max_cost)
             break;
 
@@ -433,21 +378,12 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                 {
                     CostType cost = stats[lab].cost(as(isx, Neighborhood::diff((Direction)i)));
 
-                    Voxel * new_voxel =
-                        allocator.create(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab);
-                    pheap.push(new_voxel);
+                    pheap.push(Voxel(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab));
                 }
             }
         }
     }
     
-    // free temporary memory
-    while(pheap.size() != 0)
-    {
-        allocator.dismiss(pheap.top());
-        pheap.pop();
-    }
-
     // write result
     transformMultiArray(ir, Diff_type(w,h,d), AccessorTraits<int>::default_accessor(), 
                         destul, ad, detail::UnlabelWatersheds());
@@ -1310,7 +1310,9 @@ class Kernel1D
         {}
 
         ~InitProxy() 
-#ifndef _MSC_VER
+#if __cplusplus >= 201103L
+             noexcept(false)
+#elif !defined(_MSC_VER)
              throw(PreconditionViolation)
 #endif
         {
@@ -0,0 +1,85 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2013-2014 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_THREADING_HXX
+#define VIGRA_THREADING_HXX
+
+/*  Compatibility header that imports the C++11 threading facilities
+    into namespace vigra::threading. Code in VIGRA uses these names
+    exclusively, so that a different threading backend can be substituted
+    in a single place if necessary.
+
+    The compiler must support C++11 (use '-std=c++11' on gcc and clang,
+    the CMake build system adds this flag automatically).
+*/
+
+#include "config.hxx"
+
+#if !defined(_MSC_VER) && __cplusplus < 201103L
+#  error "vigra/threading.hxx: C++11 support is required for multi-threading (try compiler flag -std=c++11)."
+#endif
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <exception>
+
+namespace vigra { namespace threading {
+
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::condition_variable;
+using std::atomic;
+using std::atomic_long;
+using std::future;
+using std::packaged_task;
+using std::exception_ptr;
+using std::current_exception;
+using std::rethrow_exception;
+using std::once_flag;
+using std::call_once;
+
+namespace this_thread {
+using std::this_thread::get_id;
+using std::this_thread::yield;
+} // namespace this_thread
+
+}} // namespace vigra::threading
+
+#endif // VIGRA_THREADING_HXX
@@ -0,0 +1,687 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_THREADPOOL_HXX
+#define VIGRA_THREADPOOL_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "threading.hxx"
+#include "tinyvector.hxx"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace vigra {
+
+/** \addtogroup ParallelProcessing Functions and classes for parallel processing.
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*                   ParallelOptions                    */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Option base class for parallel algorithms.
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+
+        The number of threads can be given explicitly, or by the special values
+        <tt>ParallelOptions::Auto</tt> (use the global default, see
+        \ref setDefaultNumThreads()), <tt>ParallelOptions::Nice</tt> (use half
+        of the hardware threads), or <tt>ParallelOptions::NoThreads</tt>
+        (execute everything in the calling thread).
+    */
+class ParallelOptions
+{
+  public:
+
+        /** Constants for special settings.
+        */
+    enum {
+        Auto       = -1, ///< Use the global default (see setDefaultNumThreads()).
+        Nice       = -2, ///< Use half as many threads as the hardware provides.
+        NoThreads  =  0  ///< Switch off multi-threading (i.e. execute tasks sequentially)
+    };
+
+    ParallelOptions()
+    : numThreads_(Auto)
+    {}
+
+        /** \brief Set the number of threads or one of the constants <tt>Auto</tt>,
+                   <tt>Nice</tt> and <tt>NoThreads</tt>.
+
+            Default: <tt>ParallelOptions::Auto</tt>
+        */
+    ParallelOptions & numThreads(const int n)
+    {
+        numThreads_ = n;
+        return *this;
+    }
+
+        /** \brief Get the desired number of threads (possibly one of the special constants).
+        */
+    int getNumThreads() const
+    {
+        return numThreads_;
+    }
+
+        /** \brief Get the number of threads actually used, i.e. with the special
+                   constants resolved.
+
+            Returns 0 when multi-threading is switched off.
+        */
+    int getActualNumThreads() const
+    {
+        return actualNumThreads(numThreads_);
+    }
+
+        /** \brief Set the global default number of threads.
+
+            This setting is used by all parallel functions whose options request
+            <tt>ParallelOptions::Auto</tt>. Passing <tt>Auto</tt> restores the initial
+            default, namely the number of hardware threads. Negative values other
+            than <tt>Auto</tt> and <tt>Nice</tt> are rejected.
+        */
+    static void setDefaultNumThreads(int n)
+    {
+        vigra_precondition(n >= Nice,
+            "ParallelOptions::setDefaultNumThreads(): n must be non-negative, Auto, or Nice.");
+        defaultNumThreadsStorage() = n;
+    }
+
+        /** \brief Get the global default number of threads (with special
+                   constants resolved).
+        */
+    static int defaultNumThreads()
+    {
+        int n = defaultNumThreadsStorage();
+        return n == Auto
+                  ? hardwareNumThreads()
+                  : actualNumThreads(n);
+    }
+
+        /** \brief Get the number of hardware threads (at least 1).
+        */
+    static int hardwareNumThreads()
+    {
+        return std::max<int>(1, threading::thread::hardware_concurrency());
+    }
+
+  private:
+    static int actualNumThreads(const int n)
+    {
+        return n >= 0
+                   ? n
+                   : n == Nice
+                        ? std::max(1, hardwareNumThreads() / 2)
+                        : defaultNumThreads();
+    }
+
+    static threading::atomic<int> & defaultNumThreadsStorage()
+    {
+        static threading::atomic<int> n(Auto);
+        return n;
+    }
+
+    int numThreads_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                      ThreadPool                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Thread pool with work stealing.
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+
+        The pool starts the requested number of worker threads upon construction.
+        Each worker owns a task queue. Tasks enqueued from outside the pool
+        are distributed round-robin over these queues, tasks enqueued by a worker
+        are put into the worker's own queue. Workers execute the tasks in their
+        own queue in LIFO order (good for cache locality) and steal the oldest task
+        from another queue when their own queue runs empty.
+
+        A task is a functor that takes the index of the executing thread
+        (in the range <tt>[0, numThreads())</tt>) as its only argument.
+        The thread index can be used to select thread-local scratch memory.
+        If the pool was created with <tt>ParallelOptions::NoThreads</tt>,
+        tasks are executed immediately in the calling thread, using index 0.
+
+        The destructor waits until all tasks have been executed. Since workers
+        don't execute other tasks while they wait, tasks must not wait for
+        the completion of other tasks in the same pool (in particular, they must
+        not call waitFinished()).
+
+        <b>Usage:</b>
+
+        \code
+        ThreadPool pool(ParallelOptions().numThreads(4));
+        std::vector<std::future<double> > results;
+        for(int k=0; k<100; ++k)
+            results.push_back(pool.enqueue([k](int threadId) { return std::sqrt(k); }));
+        double sum = 0.0;
+        for(int k=0; k<100; ++k)
+            sum += results[k].get(); // re-throws any exception raised by the task
+        \endcode
+
+        See \ref parallel_foreach() for a more convenient interface.
+    */
+class ThreadPool
+{
+    typedef std::function<void(int)> Task;
+
+    struct TaskQueue
+    {
+        threading::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+  public:
+
+        /** Create a pool with the number of threads given by \a options.
+        */
+    explicit ThreadPool(ParallelOptions const & options)
+    : queued_(0),
+      unfinished_(0),
+      nextQueue_(0),
+      stop_(false)
+    {
+        init(options.getActualNumThreads());
+    }
+
+        /** Create a pool with \a n threads (special constants of
+            \ref ParallelOptions are resolved).
+        */
+    explicit ThreadPool(const int n)
+    : queued_(0),
+      unfinished_(0),
+      nextQueue_(0),
+      stop_(false)
+    {
+        init(ParallelOptions().numThreads(n).getActualNumThreads());
+    }
+
+        /** Wait until all tasks are finished, then terminate the threads.
+        */
+    ~ThreadPool();
+
+        /** Enqueue a task for execution.
+
+            The task is called as <tt>f(threadId)</tt>. The returned future
+            provides the task's result or re-throws the exception raised by
+            the task.
+        */
+    template <class F>
+    threading::future<decltype(std::declval<F>()(0))>
+    enqueue(F && f);
+
+        /** Block until all tasks have been executed. Must not be called
+            by a task of this pool.
+        */
+    void waitFinished()
+    {
+        threading::unique_lock<threading::mutex> lock(mutex_);
+        finishCondition_.wait(lock, [this]() { return unfinished_ == 0; });
+    }
+
+        /** Number of worker threads (0 if tasks are executed in the calling thread).
+        */
+    std::size_t numThreads() const
+    {
+        return workers_.size();
+    }
+
+        /** Index of the calling thread if it is a worker of this pool,
+            otherwise -1.
+        */
+    int currentThreadIndex() const
+    {
+        threading::thread::id self = threading::this_thread::get_id();
+        for(std::size_t k=0; k<workers_.size(); ++k)
+            if(workers_[k].get_id() == self)
+                return (int)k;
+        return -1;
+    }
+
+  private:
+
+    ThreadPool(ThreadPool const &);               // forbidden
+    ThreadPool & operator=(ThreadPool const &);   // forbidden
+
+    void init(int n)
+    {
+        queues_.reserve(n);
+        for(int k=0; k<n; ++k)
+            queues_.push_back(std::unique_ptr<TaskQueue>(new TaskQueue));
+        workers_.reserve(n);
+        for(int k=0; k<n; ++k)
+            workers_.push_back(threading::thread([this, k]() { this->workerLoop(k); }));
+    }
+
+    void workerLoop(int id);
+
+    bool popTask(int id, Task & task);
+
+    std::vector<threading::thread> workers_;
+    std::vector<std::unique_ptr<TaskQueue> > queues_;
+    threading::mutex mutex_;  // protects the counters and the stop flag
+    threading::condition_variable workerCondition_, finishCondition_;
+    std::size_t queued_, unfinished_, nextQueue_;
+    bool stop_;
+};
+
+inline
+ThreadPool::~ThreadPool()
+{
+    {
+        threading::lock_guard<threading::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    workerCondition_.notify_all();
+    for(std::size_t k=0; k<workers_.size(); ++k)
+        workers_[k].join();
+}
+
+template <class F>
+threading::future<decltype(std::declval<F>()(0))>
+ThreadPool::enqueue(F && f)
+{
+    typedef decltype(std::declval<F>()(0)) result_type;
+    typedef threading::packaged_task<result_type(int)> PackagedTask;
+
+    std::shared_ptr<PackagedTask> task = std::make_shared<PackagedTask>(std::forward<F>(f));
+    threading::future<result_type> result = task->get_future();
+
+    if(workers_.size() == 0)
+    {
+        (*task)(0);
+        return result;
+    }
+
+    int queue = currentThreadIndex();
+    {
+        threading::lock_guard<threading::mutex> lock(mutex_);
+        vigra_precondition(!stop_, "ThreadPool::enqueue(): pool has been stopped.");
+        if(queue < 0)
+            queue = (int)(nextQueue_++ % queues_.size());
+    }
+    {
+        threading::lock_guard<threading::mutex> lock(queues_[queue]->mutex);
+        queues_[queue]->tasks.push_back([task](int id) { (*task)(id); });
+    }
+    {
+        threading::lock_guard<threading::mutex> lock(mutex_);
+        ++queued_;
+        ++unfinished_;
+    }
+    workerCondition_.notify_one();
+    return result;
+}
+
+inline bool
+ThreadPool::popTask(int id, Task & task)
+{
+    {
+        // LIFO from the own queue
+        TaskQueue & own = *queues_[id];
+        threading::lock_guard<threading::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    // FIFO from the other queues
+    for(std::size_t k=1; k<queues_.size(); ++k)
+    {
+        TaskQueue & victim = *queues_[(id + k) % queues_.size()];
+        threading::lock_guard<threading::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void
+ThreadPool::workerLoop(int id)
+{
+    for(;;)
+    {
+        {
+            threading::unique_lock<threading::mutex> lock(mutex_);
+            workerCondition_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+            if(queued_ == 0)
+                return; // stop_ was requested and all tasks are done
+            // reserve one task: since 'queued_' is only incremented after
+            // the task was pushed, a task for this reservation must exist.
+            --queued_;
+        }
+
+        Task task;
+        while(!popTask(id, task))
+            threading::this_thread::yield();
+
+        task(id); // exceptions are captured by the packaged_task
+
+        {
+            threading::lock_guard<threading::mutex> lock(mutex_);
+            if(--unfinished_ == 0)
+                finishCondition_.notify_all();
+        }
+    }
+}
+
+/********************************************************/
+/*                                                      */
+/*                   parallel_foreach                   */
+/*                                                      */
+/********************************************************/
+
+namespace detail {
+
+    // Number of tasks a parallel loop on 'pool' is split into:
+    // several tasks per thread balance the load.
+inline std::ptrdiff_t parallelTaskCount(ThreadPool const & pool)
+{
+    return 4*std::max<std::ptrdiff_t>(1, (std::ptrdiff_t)pool.numThreads());
+}
+
+    // Number of consecutive items per task when 'nItems' items are
+    // distributed among parallelTaskCount(pool) tasks (at least 'minSize').
+inline std::ptrdiff_t parallelChunkSize(ThreadPool const & pool, std::ptrdiff_t nItems,
+                                        std::ptrdiff_t minSize = 1)
+{
+    return std::max<std::ptrdiff_t>(minSize, nItems / parallelTaskCount(pool));
+}
+
+template <class F>
+void parallel_foreach_impl(ThreadPool & pool, const std::ptrdiff_t nItems, F & f)
+{
+    if(nItems <= 0)
+        return;
+
+    int self = pool.currentThreadIndex();
+    if(pool.numThreads() == 0 || self >= 0)
+    {
+        // serial execution: no threads, or called from within a task
+        // (waiting for sub-tasks would dead-lock the pool)
+        int id = std::max(self, 0);
+        for(std::ptrdiff_t i=0; i<nItems; ++i)
+            f(id, i);
+        return;
+    }
+
+    // several chunks per thread to balance the load
+    std::ptrdiff_t chunkSize = parallelChunkSize(pool, nItems);
+    std::vector<threading::future<void> > futures;
+    for(std::ptrdiff_t begin=0; begin<nItems; begin+=chunkSize)
+    {
+        std::ptrdiff_t end = std::min(begin+chunkSize, nItems);
+        futures.push_back(pool.enqueue(
+            [&f, begin, end](int id)
+            {
+                for(std::ptrdiff_t i=begin; i<end; ++i)
+                    f(id, i);
+            }));
+    }
+    // wait for all tasks before re-throwing an exception,
+    // because the tasks refer to 'f'
+    for(std::size_t k=0; k<futures.size(); ++k)
+        futures[k].wait();
+    for(std::size_t k=0; k<futures.size(); ++k)
+        futures[k].get();
+}
+
+} // namespace detail
+
+    /** \brief Apply a functor to all items in a range in parallel.
+
+        <b> Declarations:</b>
+
+        \code
+        namespace vigra {
+            // call f(threadId, i) for i = 0, ..., nItems-1
+            template <class F>
+            void parallel_foreach(ThreadPool & pool, std::ptrdiff_t nItems, F && f);
+
+            template <class F>
+            void parallel_foreach(ParallelOptions const & options, std::ptrdiff_t nItems, F && f);
+
+            // call f(threadId, *i) for all i in [begin, end) (random access iterators)
+            template <class Iterator, class F>
+            void parallel_foreach(ThreadPool & pool, Iterator begin, Iterator end, F && f);
+
+            template <class Iterator, class F>
+            void parallel_foreach(ParallelOptions const & options, Iterator begin, Iterator end, F && f);
+        }
+        \endcode
+
+        The range is split into chunks which are executed as tasks of the given
+        \ref ThreadPool (the variants taking \ref ParallelOptions create a temporary pool).
+        The first argument of the functor is the index of the executing thread
+        (in the range <tt>[0, max(1, pool.numThreads()))</tt>), which can be used to access
+        thread-local scratch memory. The function returns when all items have been
+        processed. If the functor throws, the first exception is re-thrown.
+
+        When called from within a task of the same pool, the items are processed
+        sequentially by the calling worker thread, because waiting for the chunks
+        would otherwise dead-lock the pool.
+
+        <b> Usage:</b>
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+
+        \code
+        std::vector<double> data(10000);
+        ...
+        ParallelOptions options;   // use the default number of threads
+        parallel_foreach(options, data.begin(), data.end(),
+            [](int threadId, double & v)
+            {
+                v = std::sqrt(v);
+            });
+        \endcode
+    */
+doxygen_overloaded_function(template <...> void parallel_foreach)
+
+template <class F>
+inline void
+parallel_foreach(ThreadPool & pool, const std::ptrdiff_t nItems, F && f)
+{
+    detail::parallel_foreach_impl(pool, nItems, f);
+}
+
+template <class F>
+inline void
+parallel_foreach(ParallelOptions const & options, const std::ptrdiff_t nItems, F && f)
+{
+    ThreadPool pool(options);
+    detail::parallel_foreach_impl(pool, nItems, f);
+}
+
+template <class Iterator, class F>
+inline void
+parallel_foreach(ThreadPool & pool, Iterator begin, Iterator end, F && f)
+{
+    auto g = [&f, begin](int id, std::ptrdiff_t i) { f(id, begin[i]); };
+    detail::parallel_foreach_impl(pool, std::distance(begin, end), g);
+}
+
+template <class Iterator, class F>
+inline void
+parallel_foreach(ParallelOptions const & options, Iterator begin, Iterator end, F && f)
+{
+    ThreadPool pool(options);
+    parallel_foreach(pool, begin, end, f);
+}
+
+/********************************************************/
+/*                                                      */
+/*                parallel_foreach_block                */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Process the blocks of a multi-dimensional array in parallel.
+
+        <b> Declarations:</b>
+
+        \code
+        namespace vigra {
+            // call f(threadId, blockBegin, blockEnd) for all blocks of the given shape
+            template <class Shape, class F>
+            void parallel_foreach_block(ThreadPool & pool, Shape const & shape,
+                                        Shape const & blockShape, F && f);
+
+            // restrict the blocking to the region [start, stop)
+            template <class Shape, class F>
+            void parallel_foreach_block(ThreadPool & pool, Shape const & start, Shape const & stop,
+                                        Shape const & blockShape, F && f);
+
+            // likewise with a temporary ThreadPool
+            template <class Shape, class F>
+            void parallel_foreach_block(ParallelOptions const & options, Shape const & shape,
+                                        Shape const & blockShape, F && f);
+            template <class Shape, class F>
+            void parallel_foreach_block(ParallelOptions const & options, Shape const & start, Shape const & stop,
+                                        Shape const & blockShape, F && f);
+        }
+        \endcode
+
+        The region (of type \ref vigra::TinyVector, e.g. <tt>MultiArrayShape<N>::type</tt>)
+        is tiled into blocks of shape <tt>blockShape</tt>. The blocks at the upper border
+        are truncated when the region's shape is not a multiple of the block shape.
+        Zero entries in <tt>blockShape</tt> are replaced with the region's extent
+        along the corresponding axis. The functor is called for each block with
+        the index of the executing thread and the block's bounding box
+        <tt>[blockBegin, blockEnd)</tt>, see \ref parallel_foreach().
+
+        <b> Usage:</b>
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+
+        \code
+        MultiArray<3, float> src(Shape3(1000)), dest(Shape3(1000));
+        ...
+        parallel_foreach_block(ParallelOptions(), src.shape(), Shape3(128),
+            [&](int threadId, Shape3 const & begin, Shape3 const & end)
+            {
+                dest.subarray(begin, end) = src.subarray(begin, end);
+            });
+        \endcode
+    */
+doxygen_overloaded_function(template <...> void parallel_foreach_block)
+
+template <class Shape, class F>
+void
+parallel_foreach_block(ThreadPool & pool, Shape const & start, Shape const & stop,
+                       Shape blockShape, F && f)
+{
+    static const int N = Shape::static_size;
+
+    Shape blockCount;
+    for(int k=0; k<N; ++k)
+    {
+        vigra_precondition(start[k] <= stop[k] && blockShape[k] >= 0,
+            "parallel_foreach_block(): invalid region or block shape.");
+        if(start[k] == stop[k])
+            return;
+        if(blockShape[k] == 0 || blockShape[k] > stop[k] - start[k])
+            blockShape[k] = stop[k] - start[k];
+        blockCount[k] = (stop[k] - start[k] + blockShape[k] - 1) / blockShape[k];
+    }
+
+    auto g = [&](int id, std::ptrdiff_t i)
+    {
+        Shape blockBegin, blockEnd;
+        for(int k=0; k<N; ++k)
+        {
+            blockBegin[k] = start[k] + (i % blockCount[k]) * blockShape[k];
+            blockEnd[k] = std::min(blockBegin[k] + blockShape[k], stop[k]);
+            i /= blockCount[k];
+        }
+        f(id, blockBegin, blockEnd);
+    };
+    detail::parallel_foreach_impl(pool, prod(blockCount), g);
+}
+
+template <class Shape, class F>
+inline void
+parallel_foreach_block(ThreadPool & pool, Shape const & shape, Shape const & blockShape, F && f)
+{
+    parallel_foreach_block(pool, Shape(), shape, blockShape, f);
+}
+
+template <class Shape, class F>
+inline void
+parallel_foreach_block(ParallelOptions const & options, Shape const & start, Shape const & stop,
+                       Shape const & blockShape, F && f)
+{
+    ThreadPool pool(options);
+    parallel_foreach_block(pool, start, stop, blockShape, f);
+}
+
+template <class Shape, class F>
+inline void
+parallel_foreach_block(ParallelOptions const & options, Shape const & shape,
+                       Shape const & blockShape, F && f)
+{
+    ThreadPool pool(options);
+    parallel_foreach_block(pool, Shape(), shape, blockShape, f);
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_THREADPOOL_HXX
@@ -40,6 +40,9 @@
 #include "config.hxx"
 #include "error.hxx"
 #include "array_vector.hxx"
+#include "threading.hxx"
+#include <vector>
+#include <algorithm>
 
 namespace vigra {
 
@@ -145,6 +148,101 @@ class UnionFindArray
     }
 };
 
+/* Thread-safe counterpart of UnionFindArray for a fixed number of labels.
+   find() and makeUnion() may be called concurrently from any number of
+   threads without locking: the parent links are atomics, a union links the
+   root with the larger index to the one with the smaller index by means of
+   compare-and-swap (retrying when the root changed in the meantime), and
+   find() compresses paths by path halving. Since links always point to
+   smaller indices, the trees stay acyclic under any interleaving.
+   Both operations are lock-free, but not wait-free: some thread always
+   makes progress, but an individual call may have to retry (and follow
+   a longer path) when other threads relink the same roots concurrently.
+
+   makeContiguous() and operator[] must only be called after all concurrent
+   unions have finished.
+*/
+template <class T>
+class ConcurrentUnionFindArray
+{
+    typedef std::size_t IndexType;
+    mutable std::vector<threading::atomic<T> > labels_;
+
+  public:
+        // create 'size' singleton regions with labels 0...size-1
+    explicit ConcurrentUnionFindArray(T size = 0)
+    : labels_((IndexType)size)
+    {
+        for(T k=0; k < size; ++k)
+            labels_[(IndexType)k].store(k, std::memory_order_relaxed);
+    }
+
+    T size() const
+    {
+        return (T)labels_.size();
+    }
+
+    T find(T label) const
+    {
+        for(;;)
+        {
+            T parent = labels_[(IndexType)label].load(std::memory_order_acquire);
+            if(parent == label)
+                return label;
+            T grandparent = labels_[(IndexType)parent].load(std::memory_order_acquire);
+            // path halving: a failed exchange means that another thread has
+            // already made progress here, so it can safely be ignored
+            if(grandparent != parent)
+                labels_[(IndexType)label].compare_exchange_weak(parent, grandparent,
+                                                                std::memory_order_release,
+                                                                std::memory_order_relaxed);
+            label = grandparent;
+        }
+    }
+
+        // returns the representative of the merged region at the time of the union
+    T makeUnion(T l1, T l2)
+    {
+        for(;;)
+        {
+            l1 = find(l1);
+            l2 = find(l2);
+            if(l1 == l2)
+                return l1;
+            if(l2 < l1)
+                std::swap(l1, l2);
+            T expected = l2;
+            if(labels_[(IndexType)l2].compare_exchange_strong(expected, l1,
+                                                              std::memory_order_acq_rel))
+                return l1;
+            // l2 was linked by another thread in the meantime => try again
+        }
+    }
+
+        // replace each label with a consecutive region number, 0 remains 0
+        // when it is a root; returns the largest region number
+    T makeContiguous()
+    {
+        T count = 0;
+        for(IndexType i=0; i<labels_.size(); ++i)
+        {
+            T parent = labels_[i].load(std::memory_order_relaxed);
+            if(parent == (T)i)
+                labels_[i].store(count++, std::memory_order_relaxed);
+            else
+                // parent < i has already been replaced by its region number
+                labels_[i].store(labels_[(IndexType)parent].load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+        }
+        return count-1;
+    }
+
+    T operator[](T label) const
+    {
+        return labels_[(IndexType)label].load(std::memory_order_relaxed);
+    }
+};
+
 } // namespace detail
 
 } // namespace vigra
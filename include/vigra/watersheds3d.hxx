@@ -540,6 +540,16 @@ unsigned int watersheds3D( SrcIterator s_Iter, SrcShape srcShape, SrcAccessor sa
     }
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor,
+          class Neighborhood3D>
+inline unsigned int watersheds3D( vigra::triple<SrcIterator, SrcShape, SrcAccessor> src, 
+                                  vigra::pair<DestIterator, DestAccessor> dest,
+                                  Neighborhood3D neighborhood3D)
+{
+    return watersheds3D(src.first, src.second, src.third, dest.first, dest.second, neighborhood3D);
+}
+
 template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor>
 inline unsigned int watersheds3DSix( vigra::triple<SrcIterator, SrcShape, SrcAccessor> src, 
@@ -40,6 +40,9 @@
 #include <iostream>
 #include <cstring>
 #include <cstdio>
+#ifdef H5_HAVE_FILTER_DEFLATE
+# include <zlib.h>
+#endif
 
 namespace vigra {
 
@@ -214,6 +217,39 @@ herr_t HDF5_ls_inserter_callback(hid_t loc_id, const char* name,
     return 0;
 }
 
+std::size_t HDF5_deflate_chunk(const char * src, std::size_t srcSize,
+                               int level, ArrayVector<char> & dest)
+{
+#ifdef H5_HAVE_FILTER_DEFLATE
+    // compress2() writes the zlib format, which is exactly what HDF5's
+    // deflate filter stores and expects
+    uLongf destSize = compressBound((uLong)srcSize);
+    if(dest.size() < (std::size_t)destSize)
+        dest.resize((std::size_t)destSize);
+    int status = compress2((Bytef*)dest.data(), &destSize,
+                           (const Bytef*)src, (uLong)srcSize, level);
+    vigra_postcondition(status == Z_OK,
+        "HDF5File::write(): zlib compression of a chunk failed.");
+    return (std::size_t)destSize;
+#else
+    vigra_fail("HDF5File::write(): HDF5 was built without deflate support.");
+    return 0;
+#endif
+}
+
+void HDF5_inflate_chunk(const char * src, std::size_t srcSize,
+                        char * dest, std::size_t destSize)
+{
+#ifdef H5_HAVE_FILTER_DEFLATE
+    uLongf size = (uLongf)destSize;
+    int status = uncompress((Bytef*)dest, &size, (const Bytef*)src, (uLong)srcSize);
+    vigra_postcondition(status == Z_OK && (std::size_t)size == destSize,
+        "HDF5File::read(): zlib decompression of a chunk failed.");
+#else
+    vigra_fail("HDF5File::read(): HDF5 was built without deflate support.");
+#endif
+}
+
 } // namespace vigra
 
 #endif // HasHDF5
@@ -454,6 +454,17 @@ ImageExportInfo & ImageExportInfo::setCanvasSize(const Size2D & size)
     return *this;
 }
 
+vigra::Size2D ImageExportInfo::getTileSize() const
+{
+    return m_tile_size;
+}
+
+ImageExportInfo & ImageExportInfo::setTileSize(const Size2D & size)
+{
+    m_tile_size = size;
+    return *this;
+}
+
 vigra::Diff2D ImageExportInfo::getPosition() const
 {
     return m_pos;
@@ -535,6 +546,9 @@ VIGRA_UNIQUE_PTR<Encoder> encoder( const ImageExportInfo & info )
     enc->setYResolution(info.getYResolution());
     enc->setPosition(info.getPosition());
     enc->setCanvasSize(info.getCanvasSize());
+    if ( info.getTileSize().area() > 0 ) {
+        enc->setTileSize(info.getTileSize());
+    }
 
     if ( info.getICCProfile().size() > 0 ) {
         enc->setICCProfile(info.getICCProfile());
@@ -864,7 +878,27 @@ VolumeImportInfo::VolumeImportInfo(const std::string &filename)
   resolution_(1.f, 1.f, 1.f),
   numBands_(0)
 {
-    // first try image sequence loading
+    // a multi-page TIFF is a volume by itself (only TIFF files are opened and
+    // searched for further pages here, other image files start a slice stack)
+    if(std::ifstream(filename.c_str()).good() &&
+       CodecManager::manager().getFileTypeByMagicString(filename) == "TIFF")
+    {
+        ImageImportInfo info(filename.c_str());
+        if(info.numImages() > 1)
+        {
+            shape_[0] = info.width();
+            shape_[1] = info.height();
+            shape_[2] = info.numImages();
+            pixelType_ = info.getPixelType();
+            numBands_ = info.numBands();
+            splitPathFromFilename(filename, path_, name_);
+            baseName_ = filename;
+            fileType_ = "MULTIPAGE";
+            return;
+        }
+    }
+
+    // then try image sequence loading
     std::string::const_reverse_iterator
         numBeginIt(filename.rbegin()), numEndIt(numBeginIt);
 
@@ -892,6 +926,7 @@ VolumeImportInfo::VolumeImportInfo(const std::string &filename)
                 extension_ = extension;
                 shape_[2] = numbers.size();
                 std::swap(numbers, numbers_);
+                fileType_ = "STACK";
 
                 break;
             }
@@ -962,6 +997,7 @@ VolumeImportInfo::VolumeImportInfo(const std::string &filename)
                 numBands_ = 1; // default to UNSIGNED_CHAR datatype
 
             baseName_ = filename;
+            fileType_ = "RAW";
             if(name_.size() > 0)
             {
                 std::string nameDummy;
@@ -999,6 +1035,7 @@ VolumeImportInfo::VolumeImportInfo(const std::string &baseName, const std::strin
     extension_ = extension;
     shape_[2] = numbers.size();
     std::swap(numbers, numbers_);
+    fileType_ = "STACK";
 }
 
 void VolumeImportInfo::getVolumeInfoFromFirstSlice(const std::string &filename)
@@ -1045,5 +1082,6 @@ MultiArrayIndex VolumeImportInfo::height() const { return shape_[1]; }
 MultiArrayIndex VolumeImportInfo::depth() const { return shape_[2]; }
 const std::string & VolumeImportInfo::name() const { return name_; }
 const std::string & VolumeImportInfo::description() const { return description_; }
+const char * VolumeImportInfo::getFileType() const { return fileType_.c_str(); }
 
 } // namespace vigra
@@ -321,13 +321,22 @@ namespace vigra
 
     void JPEGDecoder::close()
     {
+        // jpeg_finish_decompress() fails when scanlines are left unread,
+        // e.g. below a region of interest, so the decompression is aborted then
+        if ( pimpl->info.output_scanline < pimpl->info.output_height ) {
+            abort();
+            return;
+        }
         // finish any pending decompression
         if (setjmp(pimpl->err.buf))
             vigra_fail( "error in jpeg_finish_decompress()" );
         jpeg_finish_decompress(&pimpl->info);
     }
 
-    void JPEGDecoder::abort() {}
+    void JPEGDecoder::abort()
+    {
+        jpeg_abort_decompress(&pimpl->info);
+    }
 
     struct JPEGEncoderImpl : public JPEGEncoderImplBase
     {
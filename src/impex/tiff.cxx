@@ -64,6 +64,7 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 
 extern "C"
 {
@@ -164,6 +165,8 @@ namespace vigra {
 
         uint32 stripindex, stripheight;
         uint32 width, height;
+        uint32 tilewidth, tileheight; // zero for images stored in strips
+        std::vector<UInt8> tilebuffer;
         uint16 samples_per_pixel, bits_per_sample,
             photometric, planarconfig, fillorder, extra_samples_per_pixel;
         float x_resolution, y_resolution;
@@ -176,6 +179,8 @@ namespace vigra {
 
         TIFFCodecImpl();
         ~TIFFCodecImpl();
+
+        void freeStripBuffers();
     };
 
     TIFFCodecImpl::TIFFCodecImpl()
@@ -185,6 +190,8 @@ namespace vigra {
         stripbuffer = 0;
         strip = 0;
         stripindex = 0;
+        tilewidth = 0;
+        tileheight = 0;
         planarconfig = PLANARCONFIG_CONTIG;
         x_resolution = 0;
         y_resolution = 0;
@@ -192,6 +199,14 @@ namespace vigra {
    }
 
     TIFFCodecImpl::~TIFFCodecImpl()
+    {
+        freeStripBuffers();
+
+        if ( tiff != 0 )
+            TIFFClose(tiff);
+    }
+
+    void TIFFCodecImpl::freeStripBuffers()
     {
         if ( planarconfig == PLANARCONFIG_SEPARATE ) {
             if ( stripbuffer != 0 ) {
@@ -207,9 +222,7 @@ namespace vigra {
                 delete[] stripbuffer;
             }
         }
-
-        if ( tiff != 0 )
-            TIFFClose(tiff);
+        stripbuffer = 0;
     }
 
     class TIFFDecoderImpl : public TIFFCodecImpl
@@ -218,9 +231,26 @@ namespace vigra {
 
         unsigned int scanline;
 
+        // file offsets of the image directories found so far, so that
+        // setImageIndex() can jump to known pages directly
+        std::vector<toff_t> diroffsets;
+        unsigned int imageindex;
+        bool lastdirectoryknown;
+
+        // region of interest (the entire image by default)
+        uint32 roi_x, roi_y, roi_width, roi_height;
+
+        // rows [tilerow_begin, tilerow_end) of the ROI decoded from a row of tiles,
+        // one buffer per sample plane
+        std::vector<std::vector<UInt8> > tilerows;
+        uint32 tilerow_begin, tilerow_end, currentrow;
+
         std::string get_pixeltype_by_sampleformat() const;
         std::string get_pixeltype_by_datatype() const;
 
+        void seekDirectory( unsigned int index );
+        void readTileRow( uint32 row );
+
     public:
 
         TIFFDecoderImpl( const std::string & filename );
@@ -230,9 +260,16 @@ namespace vigra {
         unsigned int getNumImages();
         void setImageIndex( unsigned int index );
         unsigned int getImageIndex();
+        std::vector<UInt64> getImageOffsets();
+        void setImageOffsets( std::vector<UInt64> const & offsets );
+
+        bool setRegionOfInterest( const Diff2D & upperLeft, const Size2D & size );
 
         const void * currentScanlineOfBand( unsigned int band ) const;
         void nextScanline();
+        bool readScanlines( void * dest, unsigned int w, unsigned int h, unsigned int bands,
+                            std::ptrdiff_t pixelStride, std::ptrdiff_t bandStride,
+                            std::ptrdiff_t rowStride, unsigned int offset );
     };
 
     TIFFDecoderImpl::TIFFDecoderImpl( const std::string & filename )
@@ -247,6 +284,31 @@ namespace vigra {
         }
 
         scanline = 0;
+        imageindex = 0;
+        lastdirectoryknown = false;
+        diroffsets.push_back( TIFFCurrentDirOffset(tiff) );
+    }
+
+    void TIFFDecoderImpl::seekDirectory( unsigned int index )
+    {
+        if ( index == imageindex )
+            return;
+
+        if ( index < diroffsets.size() ) {
+            if ( !TIFFSetSubDirectory( tiff, diroffsets[index] ) )
+                vigra_fail( "Invalid TIFF image index" );
+        } else {
+            // continue from the last known directory, recording the new offsets
+            if ( imageindex + 1 != diroffsets.size() &&
+                 !TIFFSetSubDirectory( tiff, diroffsets.back() ) )
+                vigra_fail( "Invalid TIFF image index" );
+            while ( diroffsets.size() <= index ) {
+                if ( !TIFFReadDirectory(tiff) )
+                    vigra_fail( "Invalid TIFF image index" );
+                diroffsets.push_back( TIFFCurrentDirOffset(tiff) );
+            }
+        }
+        imageindex = index;
     }
 
     std::string TIFFDecoderImpl::get_pixeltype_by_sampleformat() const
@@ -324,24 +386,29 @@ namespace vigra {
 
     void TIFFDecoderImpl::init(unsigned int imageIndex)
     {
+        // release the buffers of the previous page while its layout is still known
+        freeStripBuffers();
+
         // set image directory, if necessary:
-        if (imageIndex != TIFFCurrentDirectory(tiff))
-        {
-            if (!TIFFSetDirectory( tiff, (tdir_t)(imageIndex)) )
-                vigra_fail( "Invalid TIFF image index" );
-        }
+        seekDirectory( imageIndex );
 
         // read width and height
         TIFFGetField( tiff, TIFFTAG_IMAGEWIDTH, &width );
         TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &height );
 
         // check for tiled TIFFs
-        uint32 tileWidth, tileHeight;
-        if( TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth ) &&
-            TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tileHeight ) )
-            vigra_precondition( (tileWidth == width) && (tileHeight == height),
-                                "TIFFDecoderImpl::init(): "
-                                "Cannot read tiled TIFFs (not implemented)." );
+        tilewidth = tileheight = 0;
+        if( TIFFIsTiled( tiff ) &&
+            !( TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tilewidth ) &&
+               TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tileheight ) ) )
+            vigra_fail( "TIFFDecoderImpl::init(): Tile size is not set." );
+        tilerows.clear();
+
+        // read the entire image unless a region of interest is set
+        roi_x = roi_y = 0;
+        roi_width = width;
+        roi_height = height;
+        scanline = 0;
 
         // find out strip heights
         stripheight = 1; // now using scanline interface instead of strip interface
@@ -487,6 +554,15 @@ namespace vigra {
             samples_per_pixel = 3;
         }
 
+        // tiles are cropped bytewise, which is impossible for packed bits and
+        // for the float data decoded from LogL/LogLuv
+        vigra_precondition( tilewidth == 0 ||
+                            ( bits_per_sample % 8 == 0 &&
+                              photometric != PHOTOMETRIC_LOGL &&
+                              photometric != PHOTOMETRIC_LOGLUV ),
+                            "TIFFDecoderImpl::init(): tiled bilevel, packed and LogLuv TIFFs"
+                            " are not supported." );
+
         // other fields
         uint16 u16value;
         uint32 u32value;
@@ -541,6 +617,7 @@ namespace vigra {
         }
 
         // ICC Profile
+        Decoder::ICCProfile().swap( iccProfile );
         UInt32 iccProfileLength = 0;
         const unsigned char *iccProfilePtr = NULL;
         if(TIFFGetField(tiff, TIFFTAG_ICCPROFILE,
@@ -576,9 +653,98 @@ namespace vigra {
         stripindex = stripheight;
     }
 
+    bool
+    TIFFDecoderImpl::setRegionOfInterest( const Diff2D & upperLeft, const Size2D & size )
+    {
+        // bilevel and LogLuv rows cannot be cropped bytewise
+        if ( bits_per_sample == 1 || photometric == PHOTOMETRIC_LOGLUV )
+            return false;
+
+        vigra_precondition( upperLeft.x >= 0 && upperLeft.y >= 0 &&
+                            upperLeft.x + size.x <= (int)width &&
+                            upperLeft.y + size.y <= (int)height,
+                            "TIFFDecoderImpl::setRegionOfInterest(): ROI out of range." );
+
+        roi_x = upperLeft.x;
+        roi_y = upperLeft.y;
+        roi_width = size.x;
+        roi_height = size.y;
+
+        tilerows.clear();
+        if ( tilewidth > 0 ) {
+            scanline = roi_y;
+            return true;
+        }
+
+        // strips: compressed strips can only be decoded sequentially, so start
+        // at the strip containing the first ROI row and skip the rows above it
+        uint32 rowsperstrip = height;
+        TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rowsperstrip );
+        for ( scanline = roi_y - roi_y % rowsperstrip; scanline < roi_y; ++scanline ) {
+            if ( planarconfig == PLANARCONFIG_SEPARATE ) {
+                for( unsigned int i = 0; i < samples_per_pixel; ++i )
+                    TIFFReadScanline( tiff, stripbuffer[i], scanline, (tsample_t)i );
+            } else {
+                TIFFReadScanline( tiff, stripbuffer[0], scanline, 0 );
+            }
+        }
+        return true;
+    }
+
+    void TIFFDecoderImpl::readTileRow( uint32 row )
+    {
+        const bool separate = planarconfig == PLANARCONFIG_SEPARATE;
+        const unsigned int planes = separate ? samples_per_pixel : 1;
+        const unsigned int pixelbytes = separate
+                                            ? bits_per_sample / 8
+                                            : samples_per_pixel * ( bits_per_sample / 8 );
+
+        tilerow_begin = row - row % tileheight;
+        tilerow_end = std::min( tilerow_begin + tileheight, height );
+        const uint32 rows = tilerow_end - tilerow_begin;
+
+        tilebuffer.resize( TIFFTileSize(tiff) );
+        tilerows.resize( planes );
+        for ( unsigned int plane = 0; plane < planes; ++plane )
+            tilerows[plane].resize( tileheight * roi_width * pixelbytes );
+
+        // decode only the tiles overlapping the ROI and copy their ROI part
+        const uint32 roi_end = roi_x + roi_width;
+        for ( uint32 x0 = roi_x - roi_x % tilewidth; x0 < roi_end; x0 += tilewidth ) {
+            const uint32 begin = std::max( x0, roi_x ),
+                         end = std::min( x0 + tilewidth, roi_end );
+            for ( unsigned int plane = 0; plane < planes; ++plane ) {
+                if ( TIFFReadTile( tiff, &tilebuffer[0], x0, tilerow_begin, 0,
+                                   (tsample_t)plane ) == -1 )
+                    vigra_fail( "TIFFDecoderImpl::nextScanline(): Unable to read tile." );
+
+                for ( uint32 y = 0; y < rows; ++y )
+                    std::copy( &tilebuffer[0] + ( y * tilewidth + begin - x0 ) * pixelbytes,
+                               &tilebuffer[0] + ( y * tilewidth + end - x0 ) * pixelbytes,
+                               &tilerows[plane][0] + ( y * roi_width + begin - roi_x ) * pixelbytes );
+            }
+        }
+
+        // invert grayscale images that interpret 0 as white
+        if ( photometric == PHOTOMETRIC_MINISWHITE &&
+             samples_per_pixel == 1 && pixeltype == "UINT8" ) {
+            std::vector<UInt8> & buf = tilerows[0];
+            for ( unsigned int i = 0; i < rows * roi_width; ++i )
+                buf[i] = 0xff - buf[i];
+        }
+    }
+
     const void *
     TIFFDecoderImpl::currentScanlineOfBand( unsigned int band ) const
     {
+        if ( tilewidth > 0 ) {
+            const unsigned int bytes = bits_per_sample / 8;
+            const uint32 y = currentrow - tilerow_begin;
+            if ( planarconfig == PLANARCONFIG_SEPARATE )
+                return &tilerows[band][0] + y * roi_width * bytes;
+            else
+                return &tilerows[0][0] + ( band + y * roi_width * samples_per_pixel ) * bytes;
+        }
         if ( bits_per_sample == 1 ) {
             UInt8 * const buf
                 = static_cast< UInt8 * >(stripbuffer[0]);
@@ -588,11 +754,11 @@ namespace vigra {
             if ( planarconfig == PLANARCONFIG_SEPARATE ) {
                 UInt8 * const buf
                     = static_cast< UInt8 * >(stripbuffer[band]);
-                return buf + ( stripindex * width ) * ( bits_per_sample / 8 );
+                return buf + ( stripindex * width + roi_x ) * ( bits_per_sample / 8 );
             } else {
                 UInt8 * const buf
                     = static_cast< UInt8 * >(stripbuffer[0]);
-                return buf + ( band + stripindex * width * samples_per_pixel )
+                return buf + ( band + ( stripindex * width + roi_x ) * samples_per_pixel )
                     * ( bits_per_sample / 8 );
             }
         }
@@ -600,14 +766,22 @@ namespace vigra {
 
     void TIFFDecoderImpl::nextScanline()
     {
+        if ( tilewidth > 0 ) {
+            // decode the next row of tiles when necessary
+            currentrow = scanline++;
+            if ( tilerows.empty() || currentrow >= tilerow_end )
+                readTileRow( currentrow );
+            return;
+        }
+
         // eventually read a new strip
         if ( ++stripindex >= stripheight ) {
             stripindex = 0;
 
             if ( planarconfig == PLANARCONFIG_SEPARATE ) {
-                const tsize_t size = TIFFScanlineSize(tiff);
                 for( unsigned int i = 0; i < samples_per_pixel; ++i )
-                    TIFFReadScanline(tiff, stripbuffer[i], scanline++, size);
+                    TIFFReadScanline(tiff, stripbuffer[i], scanline, (tsample_t)i);
+                ++scanline;
             } else {
                 TIFFReadScanline( tiff, stripbuffer[0], scanline++, 0);
             }
@@ -628,6 +802,32 @@ namespace vigra {
         }
     }
 
+    bool TIFFDecoderImpl::readScanlines( void * dest, unsigned int w, unsigned int h,
+                                         unsigned int bands, std::ptrdiff_t pixelStride,
+                                         std::ptrdiff_t bandStride, std::ptrdiff_t rowStride,
+                                         unsigned int offset )
+    {
+        // let libtiff decode entire interleaved rows straight into the destination
+        // when they need neither cropping nor conversion
+        const std::ptrdiff_t bytes = bits_per_sample / 8;
+        if ( tilewidth > 0 || planarconfig != PLANARCONFIG_CONTIG || bits_per_sample < 8 ||
+             photometric == PHOTOMETRIC_LOGL || photometric == PHOTOMETRIC_LOGLUV ||
+             ( photometric == PHOTOMETRIC_MINISWHITE && samples_per_pixel == 1 && pixeltype == "UINT8" ) ||
+             offset != 0 || roi_x != 0 || w != width || bands != samples_per_pixel ||
+             pixelStride != samples_per_pixel * bytes || ( bands > 1 && bandStride != bytes ) ||
+             TIFFScanlineSize(tiff) != (tsize_t)( width * pixelStride ) )
+            return false;
+
+        UInt8 * row = static_cast< UInt8 * >(dest);
+        for ( unsigned int y = 0; y < h; ++y, row += rowStride )
+            if ( TIFFReadScanline( tiff, row, scanline++, 0 ) == -1 )
+                vigra_fail( "TIFFDecoderImpl::readScanlines(): Unable to read scanline." );
+
+        // the strip buffer no longer holds the current scanline
+        stripindex = stripheight;
+        return true;
+    }
+
     void TIFFDecoder::init( const std::string & filename, unsigned int imageIndex=0 )
     {
         pimpl = new TIFFDecoderImpl(filename);
@@ -673,6 +873,7 @@ namespace vigra {
     void TIFFDecoder::setImageIndex(unsigned int imageIndex)
     {
         pimpl->setImageIndex(imageIndex);
+        iccProfile_ = pimpl->iccProfile;
     }
 
     unsigned int TIFFDecoder::getImageIndex() const
@@ -680,6 +881,16 @@ namespace vigra {
         return pimpl->getImageIndex();
     }
 
+    std::vector<UInt64> TIFFDecoder::getImageOffsets() const
+    {
+        return pimpl->getImageOffsets();
+    }
+
+    void TIFFDecoder::setImageOffsets(std::vector<UInt64> const & offsets)
+    {
+        pimpl->setImageOffsets(offsets);
+    }
+
     vigra::Diff2D TIFFDecoder::getPosition() const
     {
         return pimpl->position;
@@ -714,12 +925,17 @@ namespace vigra {
     unsigned int
     TIFFDecoderImpl::getNumImages()
     {
-        unsigned int currIndex = getImageIndex();
-        TIFFSetDirectory(tiff, 0);
-        int numPages = 1;
-        while (TIFFReadDirectory(tiff)) numPages++;
-        TIFFSetDirectory(tiff, currIndex);
-        return numPages;
+        if ( !lastdirectoryknown ) {
+            // record the offsets of the remaining directories and return to the current one
+            if ( imageindex + 1 != diroffsets.size() &&
+                 !TIFFSetSubDirectory( tiff, diroffsets.back() ) )
+                vigra_fail( "TIFFDecoderImpl::getNumImages(): Unable to read image directory." );
+            while ( TIFFReadDirectory(tiff) )
+                diroffsets.push_back( TIFFCurrentDirOffset(tiff) );
+            TIFFSetSubDirectory( tiff, diroffsets[imageindex] );
+            lastdirectoryknown = true;
+        }
+        return diroffsets.size();
     }
 
     void
@@ -728,10 +944,44 @@ namespace vigra {
         init(imageIndex);
     }
 
+    std::vector<UInt64>
+    TIFFDecoderImpl::getImageOffsets()
+    {
+        getNumImages();
+        return std::vector<UInt64>( diroffsets.begin(), diroffsets.end() );
+    }
+
+    void
+    TIFFDecoderImpl::setImageOffsets( std::vector<UInt64> const & offsets )
+    {
+        // only accept the offsets of this file, whose first directory we already know
+        if ( offsets.size() == 0 || offsets[0] != diroffsets[0] ||
+             offsets.size() < diroffsets.size() )
+            return;
+        diroffsets.assign( offsets.begin(), offsets.end() );
+        lastdirectoryknown = true;
+    }
+
     unsigned int
     TIFFDecoderImpl::getImageIndex()
     {
-        return TIFFCurrentDirectory(tiff);
+        return imageindex;
+    }
+
+    bool TIFFDecoder::setRegionOfInterest( const Diff2D & upperLeft, const Size2D & size )
+    {
+        return pimpl->setRegionOfInterest(upperLeft, size);
+    }
+
+    void TIFFDecoder::readScanlines( void * dest, unsigned int width, unsigned int height,
+                                     unsigned int bands, std::ptrdiff_t pixelStride,
+                                     std::ptrdiff_t bandStride, std::ptrdiff_t rowStride,
+                                     unsigned int offset )
+    {
+        if ( !pimpl->readScanlines( dest, width, height, bands,
+                                    pixelStride, bandStride, rowStride, offset ) )
+            Decoder::readScanlines( dest, width, height, bands,
+                                    pixelStride, bandStride, rowStride, offset );
     }
 
     const void * TIFFDecoder::currentScanlineOfBand( unsigned int band ) const
@@ -797,11 +1047,13 @@ namespace vigra {
 
             if ( ++stripindex >= rows ) {
 
-                // write next strip
+                // write next strip (or row of tiles)
                 stripindex = 0;
 
-                int success = TIFFWriteEncodedStrip( tiff, strip++, stripbuffer[0],
-                                       TIFFVStripSize( tiff, rows ) );
+                int success = tilewidth > 0
+                                  ? writeTileRow( strip++, rows )
+                                  : TIFFWriteEncodedStrip( tiff, strip++, stripbuffer[0],
+                                                           TIFFVStripSize( tiff, rows ) );
                 if(success == -1 && tiffcomp != COMPRESSION_NONE)
                 {
                     throw Encoder::TIFFCompressionException(); // retry without compression
@@ -811,6 +1063,25 @@ namespace vigra {
                         "exportImage(): Unable to write TIFF data.");
             }
         }
+
+        // split the buffered rows into tiles, padding the border tiles with zeros
+        int writeTileRow( unsigned int tilerow, unsigned int rows )
+        {
+            const unsigned int pixelbytes = samples_per_pixel * ( bits_per_sample >> 3 );
+            const UInt8 * buf = ( const UInt8 * ) stripbuffer[0];
+
+            for ( uint32 x0 = 0; x0 < width; x0 += tilewidth ) {
+                const uint32 columns = std::min( tilewidth, width - x0 );
+                std::fill( tilebuffer.begin(), tilebuffer.end(), 0 );
+                for ( unsigned int y = 0; y < rows; ++y )
+                    std::copy( buf + ( y * width + x0 ) * pixelbytes,
+                               buf + ( y * width + x0 + columns ) * pixelbytes,
+                               &tilebuffer[0] + y * tilewidth * pixelbytes );
+                if ( TIFFWriteTile( tiff, &tilebuffer[0], x0, tilerow * tileheight, 0, 0 ) == -1 )
+                    return -1;
+            }
+            return 0;
+        }
     };
 
     void TIFFEncoderImpl::setCompressionType( const std::string & comp,
@@ -846,14 +1117,21 @@ namespace vigra {
         TIFFSetField( tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG );
         TIFFSetField( tiff, TIFFTAG_IMAGEWIDTH, width );
         TIFFSetField( tiff, TIFFTAG_IMAGELENGTH, height );
-        // TIFFDefaultStripSize tries for 8kb strips! Laughable!
-        // This will do a 1MB strip for 8-bit images,
-        // 2MB strip for 16-bit, and so forth.
-        unsigned int estimate =
-            (unsigned int)std::max(static_cast<UIntBiggest>(1),
-                                  (static_cast<UIntBiggest>(1)<<20) / (width * samples_per_pixel));
-        TIFFSetField( tiff, TIFFTAG_ROWSPERSTRIP,
-                      stripheight = TIFFDefaultStripSize( tiff, estimate ) );
+        if ( tilewidth > 0 ) {
+            // buffer one row of tiles at a time
+            TIFFSetField( tiff, TIFFTAG_TILEWIDTH, tilewidth );
+            TIFFSetField( tiff, TIFFTAG_TILELENGTH, tileheight );
+            stripheight = tileheight;
+        } else {
+            // TIFFDefaultStripSize tries for 8kb strips! Laughable!
+            // This will do a 1MB strip for 8-bit images,
+            // 2MB strip for 16-bit, and so forth.
+            unsigned int estimate =
+                (unsigned int)std::max(static_cast<UIntBiggest>(1),
+                                      (static_cast<UIntBiggest>(1)<<20) / (width * samples_per_pixel));
+            TIFFSetField( tiff, TIFFTAG_ROWSPERSTRIP,
+                          stripheight = TIFFDefaultStripSize( tiff, estimate ) );
+        }
         TIFFSetField( tiff, TIFFTAG_SAMPLESPERPIXEL, samples_per_pixel );
         TIFFSetField( tiff, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT );
         TIFFSetField( tiff, TIFFTAG_COMPRESSION, tiffcomp );
@@ -938,9 +1216,16 @@ namespace vigra {
         }
 
         // alloc memory
+        tsize_t buffersize = TIFFStripSize(tiff);
+        if ( tilewidth > 0 ) {
+            vigra_precondition( bits_per_sample >= 8,
+                "TIFFEncoderImpl::finalizeSettings(): Tiles are not supported for bilevel images." );
+            buffersize = (tsize_t)tileheight * width * samples_per_pixel * ( bits_per_sample >> 3 );
+            tilebuffer.resize( TIFFTileSize(tiff) );
+        }
         stripbuffer = new tdata_t[1];
         stripbuffer[0] = 0;
-        stripbuffer[0] = _TIFFmalloc( TIFFStripSize(tiff) );
+        stripbuffer[0] = _TIFFmalloc( buffersize );
         if(stripbuffer[0] == 0)
             throw std::bad_alloc();
 
@@ -1017,6 +1302,15 @@ namespace vigra {
         pimpl->y_resolution = yres;
     }
 
+    void TIFFEncoder::setTileSize( const vigra::Size2D & size )
+    {
+        VIGRA_IMPEX_FINALIZED(pimpl->finalized);
+        vigra_precondition( size.x > 0 && size.y > 0 && size.x % 16 == 0 && size.y % 16 == 0,
+            "TIFFEncoder::setTileSize(): Tile width and height must be positive multiples of 16." );
+        pimpl->tilewidth = size.x;
+        pimpl->tileheight = size.y;
+    }
+
     unsigned int TIFFEncoder::getOffset() const
     {
         return pimpl->samples_per_pixel;
@@ -83,14 +83,20 @@ namespace vigra {
         unsigned int getNumImages() const;
         void setImageIndex(unsigned int);
         unsigned int getImageIndex() const;
+        std::vector<UInt64> getImageOffsets() const;
+        void setImageOffsets(std::vector<UInt64> const &);
 
         Diff2D getPosition() const;
         Size2D getCanvasSize() const;
         float getXResolution() const;
         float getYResolution() const;
 
+        bool setRegionOfInterest( const Diff2D &, const Size2D & );
+
         const void * currentScanlineOfBand( unsigned int ) const;
         void nextScanline();
+        void readScanlines( void *, unsigned int, unsigned int, unsigned int,
+                            std::ptrdiff_t, std::ptrdiff_t, std::ptrdiff_t, unsigned int );
 
         std::string getPixelType() const;
         unsigned int getOffset() const;
@@ -127,6 +133,7 @@ namespace vigra {
         void setCanvasSize( const Size2D & pos );
         void setXResolution( float xres );
         void setYResolution( float yres );
+        void setTileSize( const Size2D & size );
 
         unsigned int getOffset() const;
 
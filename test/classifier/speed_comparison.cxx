@@ -39,10 +39,50 @@ int main(int argc, char ** argv)
     TIC;
     rf_new.learn(features, labels, rf_default(), rf_default(), rf_default(), random);
     TOC;
+    RandomForest<int>    rf_hist(RandomForestOptions().tree_count(255));
+    std::cerr << "Learning New Random Forest with HistogramGiniSplit:" << std::endl;
+    TIC;
+    rf_hist.learn(features, labels, rf_default(), HistogramGiniSplit(), rf_default(), random);
+    TOC;
     std::cerr << "Learning Old Random Forest:" << std::endl;
     TIC;
     rf_old.learn(features, labels, random_old); 
     TOC;
+
+    MultiArray<2, float> test_features(Shp(20000, features.shape(1)));
+    for(int ii = 0; ii < test_features.shape(0); ++ii)
+        for(int jj = 0; jj < test_features.shape(1); ++jj)
+            test_features(ii, jj) = (float)random.uniform53();
+    MultiArray<2, float> prob(Shp(test_features.shape(0), rf_new.class_count())),
+                         prob_compact(prob.shape());
+
+    std::cerr << "Predicting with New Random Forest:" << std::endl;
+    TIC;
+    rf_new.predictProbabilities(test_features, prob);
+    TOC;
+    std::cerr << "Predicting with New Random Forest (tree-major):" << std::endl;
+    TIC;
+    rf_new.predictProbabilities(test_features, prob, 
+                                ParallelOptions().numThreads(ParallelOptions::NoThreads), true);
+    TOC;
+    std::cerr << "Converting to Compact Random Forest:" << std::endl;
+    TIC;
+    CompactRandomForest<int> rf_compact(rf_new);
+    TOC;
+    std::cerr << "Predicting with Compact Random Forest:" << std::endl;
+    TIC;
+    rf_compact.predictProbabilities(test_features, prob_compact);
+    TOC;
+    if(prob != prob_compact)
+    {
+        std::cerr << "Compact Random Forest gave different results!" << std::endl;
+        return 1;
+    }
+    std::cerr << "Predicting with single-precision Compact Random Forest:" << std::endl;
+    CompactRandomForest<int, float> rf_compact_float(rf_new);
+    TIC;
+    rf_compact_float.predictProbabilities(test_features, prob_compact);
+    TOC;
     return 0;
 
 }
@@ -663,6 +663,268 @@ struct ClassifierTest
         std::cerr << "DONE!\n\n";
     }
 
+/**
+        ClassifierTest::RFparallelTest():
+    Learns a forest on the pina_indians dataset with 1 and 4 threads and the same seed.
+    The trees and the out-of-bag error must be identical, the error must be close to the
+    one of the serial version.
+**/
+    void RFparallelTest()
+    {
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        std::cerr << "RFparallelTest(): Learning 100 Trees with 1 and 4 threads.";
+        rf::visitors::OOB_PerTreeError oob_serial, oob1, oob4;
+        vigra::RandomForest<> RF_serial(vigra::RandomForestOptions().tree_count(100)),
+                              RF1(vigra::RandomForestOptions().tree_count(100)),
+                              RF4(vigra::RandomForestOptions().tree_count(100));
+        RF_serial.learn(data.features(ii), data.labels(ii), 
+                        rf::visitors::create_visitor(oob_serial),
+                        rf_default(), rf_default(), vigra::RandomMT19937(42));
+        RF1.learn(data.features(ii), data.labels(ii), 
+                  rf::visitors::create_visitor(oob1),
+                  rf_default(), rf_default(), vigra::RandomMT19937(42),
+                  ParallelOptions().numThreads(ParallelOptions::NoThreads));
+        RF4.learn(data.features(ii), data.labels(ii), 
+                  rf::visitors::create_visitor(oob4),
+                  rf_default(), rf_default(), vigra::RandomMT19937(42),
+                  ParallelOptions().numThreads(4));
+        std::cerr << "DONE!\n";
+
+        std::cerr << "RFparallelTest(): Comparing trees:";
+        shouldEqual(RF1.tree_count(), 100);
+        shouldEqual(RF4.tree_count(), 100);
+        for(int k = 0; k < RF1.tree_count(); ++k)
+        {
+            shouldEqualSequence(RF1.tree(k).topology_.begin(), RF1.tree(k).topology_.end(),
+                                RF4.tree(k).topology_.begin());
+            shouldEqualSequence(RF1.tree(k).parameters_.begin(), RF1.tree(k).parameters_.end(),
+                                RF4.tree(k).parameters_.begin());
+        }
+        shouldEqual(oob1.oobError, oob4.oobError);
+        shouldEqualTolerance(oob4.oobError, oob_serial.oobError, 0.05);
+
+        MultiArray<2, double> prob1(Shape2(data.features(ii).shape(0), RF1.class_count())),
+                              prob4(prob1.shape());
+        RF1.predictProbabilities(data.features(ii), prob1);
+        RF4.predictProbabilities(data.features(ii), prob4);
+        shouldEqualSequence(prob1.begin(), prob1.end(), prob4.begin());
+
+        // the default visitor and seeding
+        vigra::RandomForest<> RF(vigra::RandomForestOptions().tree_count(20));
+        RF.learn(data.features(ii), data.labels(ii), ParallelOptions().numThreads(4));
+        shouldEqual(RF.tree_count(), 20);
+
+        // online learning is only supported by the serial version
+        vigra::RandomForest<> RF_online(vigra::RandomForestOptions().tree_count(20)
+                                                .prepare_online_learning(true));
+        try
+        {
+            RF_online.learn(data.features(ii), data.labels(ii), ParallelOptions().numThreads(4));
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nRandomForest::learn(): online learning is not supported by parallel learning.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        std::cerr << "DONE!\n\n";
+    }
+
+    void RFparallelPredictionTest()
+    {
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        std::cerr << "RFparallelPredictionTest(): Comparing parallel with serial prediction.";
+        for(int weighted = 0; weighted < 2; ++weighted)
+        {
+            vigra::RandomForestOptions options;
+            options.tree_count(50);
+            if(weighted)
+                options.predict_weighted();
+            vigra::RandomForest<> RF(options);
+            RF.learn(data.features(ii), data.labels(ii), 
+                     rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+
+            MultiArrayShape<2>::type shape(data.features(ii).shape(0), RF.class_count());
+            MultiArray<2, double> prob(shape), prob_rows(shape), prob_trees(shape);
+            MultiArray<2, float>  prob_float(shape);
+            RF.predictProbabilities(data.features(ii), prob);
+            RF.predictProbabilities(data.features(ii), prob_rows, 
+                                    ParallelOptions().numThreads(4));
+            shouldEqualSequence(prob.begin(), prob.end(), prob_rows.begin());
+            RF.predictProbabilities(data.features(ii), prob_trees, 
+                                    ParallelOptions().numThreads(4), true);
+            shouldEqualSequence(prob.begin(), prob.end(), prob_trees.begin());
+
+            ParallelOptions serial;
+            serial.numThreads(ParallelOptions::NoThreads);
+            RF.predictProbabilities(data.features(ii), prob_float, serial, true);
+            shouldEqualSequenceTolerance(prob.begin(), prob.end(), prob_float.begin(), 1e-6);
+        }
+        std::cerr << "DONE!\n\n";
+    }
+
+    void RFcompactTest()
+    {
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        std::cerr << "RFcompactTest(): Comparing compact with original forest.";
+        MultiArray<2, float> features(data.features(ii));
+        for(int weighted = 0; weighted < 2; ++weighted)
+        {
+            vigra::RandomForestOptions options;
+            options.tree_count(50);
+            if(weighted)
+                options.predict_weighted();
+            vigra::RandomForest<> RF(options);
+            RF.learn(features, data.labels(ii), 
+                     rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+
+            CompactRandomForest<> compact(RF);
+            shouldEqual(compact.tree_count(), RF.tree_count());
+            shouldEqual(compact.class_count(), RF.class_count());
+            shouldEqual(compact.feature_count(), RF.feature_count());
+            shouldEqual((int)compact.roots().size(), RF.tree_count());
+            shouldEqual(compact.roots()[0], 0);
+
+            // compact nodes are breadth-first: the children of the root follow it immediately
+            shouldEqual(compact.leafIndices()[0], -1);
+            shouldEqual(compact.nodes()[0].child, 1);
+            should(compact.depths()[0] > 0);
+
+            MultiArrayShape<2>::type shape(features.shape(0), RF.class_count());
+            MultiArray<2, double> prob(shape), prob_compact(shape), prob_parallel(shape);
+            RF.predictProbabilities(features, prob);
+            compact.predictProbabilities(features, prob_compact);
+            shouldEqualSequence(prob.begin(), prob.end(), prob_compact.begin());
+            compact.predictProbabilities(features, prob_parallel, ParallelOptions().numThreads(4));
+            shouldEqualSequence(prob.begin(), prob.end(), prob_parallel.begin());
+
+            MultiArray<2, double> labels(Shape2(features.shape(0), 1)), 
+                                  labels_compact(Shape2(features.shape(0), 1));
+            RF.predictLabels(features, labels);
+            compact.predictLabels(features, labels_compact);
+            shouldEqualSequence(labels.begin(), labels.end(), labels_compact.begin());
+        }
+        std::cerr << "DONE!\n\n";
+    }
+
+/**
+        ClassifierTest::RFsinglePrecisionTest():
+    Learns forests on float and UInt8 features. Forests learned on float features and
+    on the same values in double precision must be identical. The single-precision 
+    CompactRandomForest must give the same labels and nearly the same probabilities.
+**/
+    void RFsinglePrecisionTest()
+    {
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        std::cerr << "RFsinglePrecisionTest(): Learning and predicting in single precision.";
+        MultiArray<2, float>  features(data.features(ii));
+        MultiArray<2, double> features_double(features);
+
+        vigra::RandomForest<> RF_float(vigra::RandomForestOptions().tree_count(20)),
+                              RF_double(vigra::RandomForestOptions().tree_count(20));
+        RF_float.learn(features, data.labels(ii), 
+                       rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+        RF_double.learn(features_double, data.labels(ii), 
+                        rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+        for(int k = 0; k < RF_float.tree_count(); ++k)
+        {
+            shouldEqualSequence(RF_float.tree(k).topology_.begin(), RF_float.tree(k).topology_.end(),
+                                RF_double.tree(k).topology_.begin());
+            shouldEqualSequence(RF_float.tree(k).parameters_.begin(), RF_float.tree(k).parameters_.end(),
+                                RF_double.tree(k).parameters_.begin());
+        }
+
+        MultiArrayShape<2>::type shape(features.shape(0), RF_float.class_count());
+        MultiArray<2, double> prob(shape);
+        MultiArray<2, float>  prob_float(shape);
+        RF_float.predictProbabilities(features, prob);
+
+        CompactRandomForest<double, float> compact(RF_float);
+        shouldEqual(compact.leafProbabilities().size() % compact.class_count(), 0u);
+        compact.predictProbabilities(features, prob_float);
+        shouldEqualSequenceTolerance(prob.begin(), prob.end(), prob_float.begin(), 1e-5);
+        compact.predictProbabilities(features, prob_float, ParallelOptions().numThreads(4));
+        shouldEqualSequenceTolerance(prob.begin(), prob.end(), prob_float.begin(), 1e-5);
+
+        MultiArray<2, double> labels(Shape2(features.shape(0), 1)), 
+                              labels_compact(labels.shape());
+        RF_float.predictLabels(features, labels);
+        compact.predictLabels(features, labels_compact);
+        shouldEqualSequence(labels.begin(), labels.end(), labels_compact.begin());
+
+        // UInt8 features
+        MultiArray<2, UInt8> features_uint8(features.shape());
+        for(int k = 0; k < features.size(); ++k)
+            features_uint8[k] = (UInt8)std::min(features[k], 255.0f);
+        vigra::RandomForest<> RF_uint8(vigra::RandomForestOptions().tree_count(20));
+        RF_uint8.learn(features_uint8, data.labels(ii), 
+                       rf_default(), rf_default(), rf_default(), vigra::RandomMT19937(1));
+        CompactRandomForest<double, float> compact_uint8(RF_uint8);
+        RF_uint8.predictProbabilities(features_uint8, prob);
+        compact_uint8.predictProbabilities(features_uint8, prob_float);
+        shouldEqualSequenceTolerance(prob.begin(), prob.end(), prob_float.begin(), 1e-5);
+        std::cerr << "DONE!\n\n";
+    }
+
+/**
+        ClassifierTest::RFhistogramSplitTest():
+    Learns forests with GiniSplit and HistogramGiniSplit on the pina_indians dataset.
+    After rounding, all features have less than 256 distinct values, so that both split 
+    functors must partition the training data in the same way and give the same trees. With fewer bins, the 
+    out-of-bag error must be close to the one of GiniSplit.
+**/
+    void RFhistogramSplitTest()
+    {
+        int ii = data.size() - 3; // this is the pina_indians dataset
+        std::cerr << "RFhistogramSplitTest(): Comparing HistogramGiniSplit with GiniSplit.";
+        MultiArray<2, double> features(data.features(ii));
+        for(int k = 0; k < features.size(); ++k)
+            features[k] = std::floor(features[k]);
+
+        // use all samples in every tree, so that the differing thresholds between 
+        // two adjacent feature values do not matter during prediction
+        vigra::RandomForestOptions options;
+        options.tree_count(20).sample_with_replacement(false).samples_per_tree(1.0);
+        vigra::RandomForest<> RF_gini(options),
+                              RF_hist(options);
+        RF_gini.learn(features, data.labels(ii), 
+                      rf_default(), GiniSplit(), rf_default(), vigra::RandomMT19937(1));
+        RF_hist.learn(features, data.labels(ii), 
+                      rf_default(), HistogramGiniSplit(), rf_default(), vigra::RandomMT19937(1));
+        for(int k = 0; k < RF_gini.tree_count(); ++k)
+            shouldEqualSequence(RF_gini.tree(k).topology_.begin(), RF_gini.tree(k).topology_.end(),
+                                RF_hist.tree(k).topology_.begin());
+
+        MultiArray<2, double> prob_gini(Shape2(features.shape(0), RF_gini.class_count())),
+                              prob_hist(prob_gini.shape());
+        RF_gini.predictProbabilities(features, prob_gini);
+        RF_hist.predictProbabilities(features, prob_hist);
+        shouldEqualSequence(prob_gini.begin(), prob_gini.end(), prob_hist.begin());
+
+        // coarse quantization of the original features, also in parallel
+        rf::visitors::OOB_Error oob_gini, oob_hist;
+        vigra::RandomForest<> RF_gini2(vigra::RandomForestOptions().tree_count(100)),
+                              RF_hist2(vigra::RandomForestOptions().tree_count(100));
+        RF_gini2.learn(data.features(ii), data.labels(ii), 
+                       rf::visitors::create_visitor(oob_gini), 
+                       GiniSplit(), rf_default(), vigra::RandomMT19937(1));
+        RF_hist2.learn(data.features(ii), data.labels(ii), 
+                       rf::visitors::create_visitor(oob_hist), 
+                       HistogramGiniSplit(16), rf_default(), vigra::RandomMT19937(1),
+                       ParallelOptions().numThreads(4));
+        should(std::abs(oob_hist.oob_breiman - oob_gini.oob_breiman) < 0.05);
+
+        try
+        {
+            HistogramGiniSplit split(257);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+        std::cerr << "DONE!\n\n";
+    }
+
     void RFvariableImportanceTest()
     {
         double pina_var_imp[] = 
@@ -946,6 +1208,11 @@ struct ClassifierTestSuite
         add( testCase( &ClassifierTest::RFonlineTest));
         add( testCase( &ClassifierTest::RFoobTest));
         add( testCase( &ClassifierTest::RFnoiseTest));
+        add( testCase( &ClassifierTest::RFparallelTest));
+        add( testCase( &ClassifierTest::RFparallelPredictionTest));
+        add( testCase( &ClassifierTest::RFcompactTest));
+        add( testCase( &ClassifierTest::RFhistogramSplitTest));
+        add( testCase( &ClassifierTest::RFsinglePrecisionTest));
         add( testCase( &ClassifierTest::RFvariableImportanceTest));
         add( testCase( &ClassifierTest::RF_NanCheck));
         add( testCase( &ClassifierTest::RF_InfCheck));
@@ -41,6 +41,7 @@
 #include "unittest.hxx"
 #include "vigra/hdf5impex.hxx"
 #include "vigra/multi_array.hxx"
+#include "vigra/multi_array_chunked_hdf5.hxx"
 
 using namespace vigra;
 
@@ -1005,6 +1006,146 @@ public:
 
 
 
+    void testHDF5FileParallelCompression()
+    {
+        std::string file_name( "testfile_HDF5File_parallel_compression.hdf5");
+
+        // shapes are not multiples of the chunk shape to test border chunks
+        MultiArray<3, float> out_data_1(Shape3(45, 33, 21));
+        for (int i = 0; i < out_data_1.size(); ++i)
+            out_data_1[i] = std::sin(0.01 * i);
+
+        MultiArray<2, TinyVector<UInt16, 3> > out_data_2(Shape2(50, 37));
+        for (int i = 0; i < out_data_2.size(); ++i)
+            out_data_2[i] = TinyVector<UInt16, 3>(i, 2*i, i % 7);
+
+        MultiArray<2, RGBValue<UInt8> > out_data_3(Shape2(20, 30));
+        for (int i = 0; i < out_data_3.size(); ++i)
+            out_data_3[i] = RGBValue<UInt8>(i % 256, 0, (3*i) % 256);
+
+        HDF5File file (file_name, HDF5File::New);
+
+        file.write("/parallel", out_data_1, Shape3(16, 16, 8), 5, ParallelOptions().numThreads(4));
+        file.write("/serial", out_data_1, Shape3(16, 16, 8), 5);
+        file.write("/vector", out_data_2, Shape2(16, 16), 3, ParallelOptions().numThreads(4));
+        file.write("/rgb", out_data_3, Shape2(8, 8), 9, ParallelOptions().numThreads(4));
+        // no compression => ordinary serial code path
+        file.write("/uncompressed", out_data_1, Shape3(16, 16, 8), 0, ParallelOptions().numThreads(4));
+
+        // the files written in parallel must be readable by the HDF5 filter pipeline
+        MultiArray<3, float> in_data_1(out_data_1.shape());
+        file.read("/parallel", in_data_1);
+        should(in_data_1 == out_data_1);
+
+        MultiArray<2, TinyVector<UInt16, 3> > in_data_2(out_data_2.shape());
+        file.read("/vector", in_data_2);
+        should(in_data_2 == out_data_2);
+
+        MultiArray<2, RGBValue<UInt8> > in_data_3(out_data_3.shape());
+        file.read("/rgb", in_data_3);
+        should(in_data_3 == out_data_3);
+
+        // ... and data written by HDF5 must be readable in parallel
+        char const * names[] = { "/parallel", "/serial", "/uncompressed" };
+        for(int k = 0; k < 3; ++k)
+        {
+            MultiArray<3, float> in_data(out_data_1.shape());
+            file.read(names[k], in_data, ParallelOptions().numThreads(4));
+            should(in_data == out_data_1);
+        }
+
+        in_data_2 = TinyVector<UInt16, 3>();
+        file.read("/vector", in_data_2, ParallelOptions().numThreads(4));
+        should(in_data_2 == out_data_2);
+
+        in_data_3 = RGBValue<UInt8>();
+        file.read("/rgb", in_data_3, ParallelOptions().numThreads(4));
+        should(in_data_3 == out_data_3);
+
+        // the reader falls back to HDF5 for type conversions
+        MultiArray<3, double> in_data_double(out_data_1.shape());
+        file.read("/parallel", in_data_double, ParallelOptions().numThreads(4));
+        MultiArray<3, double> out_data_double(out_data_1);
+        should(in_data_double == out_data_double);
+
+        // chunks that were never written contain the fill value
+        MultiArrayShape<3>::type shape(40, 40, 40), chunks(16, 16, 16);
+        file.createDataset<3, int>("/partial", shape, 7, chunks, 5);
+        MultiArray<3, int> block(Shape3(10, 10, 10), 1);
+        file.writeBlock("/partial", Shape3(20, 20, 20), block);
+        MultiArray<3, int> in_partial(shape);
+        file.read("/partial", in_partial, ParallelOptions().numThreads(4));
+        shouldEqual(in_partial(0, 0, 0), 7);
+        shouldEqual(in_partial(39, 39, 39), 7);
+        shouldEqual(in_partial(25, 25, 25), 1);
+        shouldEqual(in_partial(19, 25, 25), 7);
+    }
+
+    void testChunkedArrayHDF5()
+    {
+        std::string file_name( "testfile_HDF5File_chunked.hdf5");
+        typedef MultiArrayShape<3>::type Shape;
+
+        MultiArray<3, float> data(Shape(40, 30, 20));
+        for (int i = 0; i < data.size(); ++i)
+            data[i] = i + 0.5f;
+
+        HDF5File file (file_name, HDF5File::New);
+        {
+            ChunkedArrayHDF5<3, float> array(file, "/chunked", data.shape(), Shape(8, 8, 8),
+                                             ChunkedArrayOptions().fillValue(1.0).cacheMax(4).compression(5));
+            shouldEqual(array.getItem(Shape(39, 29, 19)), 1.0f);
+            array.commitSubarray(Shape(0, 0, 0), data.subarray(Shape(0, 0, 0), Shape(40, 30, 10)));
+            should(array.cacheSize() <= 4);
+            array.setItem(Shape(1, 2, 3), -1.0f);
+        }
+        data(1, 2, 3) = -1.0f;
+        data.subarray(Shape(0, 0, 10), Shape(40, 30, 20)) = 1.0f;
+
+        // reopen the dataset via ChunkedArrayHDF5 and HDF5File
+        ChunkedArrayHDF5<3, float> array(file, "/chunked", Shape(8, 8, 8));
+        shouldEqual(array.shape(), data.shape());
+        MultiArray<3, float> res(data.shape());
+        array.checkoutSubarray(Shape(0, 0, 0), res);
+        should (res == data);
+
+        MultiArray<3, float> in_data(data.shape());
+        file.read("/chunked", in_data);
+        should (in_data == data);
+    }
+
+    void testChunkedArrayHDF5Parallel()
+    {
+        std::string file_name( "testfile_HDF5File_chunked_parallel.hdf5");
+        typedef MultiArrayShape<3>::type Shape;
+
+        MultiArray<3, int> data(Shape(32, 24, 16));
+        for (int i = 0; i < data.size(); ++i)
+            data[i] = i;
+
+        // two arrays on the same file, used concurrently with small caches
+        // (much I/O), must not call into HDF5 at the same time
+        HDF5File file (file_name, HDF5File::New);
+        ChunkedArrayHDF5<3, int> source(file, "/source", data.shape(), Shape(8),
+                                        ChunkedArrayOptions().cacheMax(2)),
+                                 dest(file, "/dest", data.shape(), Shape(8),
+                                      ChunkedArrayOptions().cacheMax(2).compression(3));
+        source.commitSubarray(Shape(), data);
+        parallel_foreach(ParallelOptions().numThreads(4), data.shape(2),
+            [&](int, std::ptrdiff_t z)
+            {
+                MultiArray<3, int> slice(Shape(32, 24, 1));
+                source.checkoutSubarray(Shape(0, 0, z), slice);
+                slice += 1;
+                dest.commitSubarray(Shape(0, 0, z), slice);
+            });
+        dest.flush();
+
+        MultiArray<3, int> res(data.shape());
+        dest.checkoutSubarray(Shape(), res);
+        data += 1;
+        should (res == data);
+    }
 
     void testHDF5FileBrowsing()
     {
@@ -1300,6 +1441,9 @@ struct HDF5ImportExportTestSuite : public vigra::test_suite
         add(testCase(&HDF5ExportImportTest::testHDF5FileBlockAccess));
         add(testCase(&HDF5ExportImportTest::testHDF5FileChunks));
         add(testCase(&HDF5ExportImportTest::testHDF5FileCompression));
+        add(testCase(&HDF5ExportImportTest::testHDF5FileParallelCompression));
+        add(testCase(&HDF5ExportImportTest::testChunkedArrayHDF5));
+        add(testCase(&HDF5ExportImportTest::testChunkedArrayHDF5Parallel));
         add(testCase(&HDF5ExportImportTest::testHDF5FileBrowsing));
         add(testCase(&HDF5ExportImportTest::testHDF5FileAttributes));
         add(testCase(&HDF5ExportImportTest::testHDF5FileTutorial));
@@ -218,6 +218,71 @@ public:
 #endif
     }
 
+    void checkRegion(const char * fileName, vigra::Diff2D ul, vigra::Diff2D lr)
+    {
+        vigra::ImageImportInfo info (fileName);
+        Image res (lr - ul);
+
+        importImageRegion (info, ul, lr, destImage (res));
+
+        for (int y = 0; y < res.height (); ++y)
+            for (int x = 0; x < res.width (); ++x)
+                should (res (x, y) == img (ul.x + x, ul.y + y));
+    }
+
+    void testImportRegion()
+    {
+        vigra::Diff2D shape (img.width (), img.height ());
+
+        // codec without random access
+        checkRegion ("lenna.xv", vigra::Diff2D (10, 20), vigra::Diff2D (70, 25));
+        checkRegion ("lenna.xv", vigra::Diff2D (0, 0), shape);
+
+        try
+        {
+            vigra::ImageImportInfo info ("lenna.xv");
+            Image res (10, 10);
+            importImageRegion (info, shape - vigra::Diff2D (5, 5), shape + vigra::Diff2D (5, 5), destImage (res));
+            failTest ("no exception thrown");
+        }
+        catch (vigra::PreconditionViolation & e)
+        {
+            std::string expected ("\nPrecondition violation!\nimportImageRegion(): region of interest out of range.");
+            std::string message (e.what ());
+            should (0 == expected.compare (message.substr (0, expected.size ())));
+        }
+
+#if defined(HasJPEG)
+        // codec that must finish decompression although the rows below the ROI are not read
+        exportImage (srcImageRange (img), vigra::ImageExportInfo ("res.jpg").setCompression ("JPEG QUALITY=100"));
+        vigra::ImageImportInfo jpeginfo ("res.jpg");
+        Image jpegfull (jpeginfo.width (), jpeginfo.height ()), jpegres (60, 5);
+        importImage (jpeginfo, destImage (jpegfull));
+        importImageRegion (jpeginfo, vigra::Diff2D (10, 20), vigra::Diff2D (70, 25), destImage (jpegres));
+        for (int y = 0; y < jpegres.height (); ++y)
+            for (int x = 0; x < jpegres.width (); ++x)
+                shouldEqual (jpegres (x, y), jpegfull (x + 10, y + 20));
+#endif
+
+#if defined(HasTIFF)
+        vigra::ImageExportInfo stripinfo ("resstrips.tif");
+        stripinfo.setCompression ("LZW");
+        exportImage (srcImageRange (img), stripinfo);
+        checkRegion ("resstrips.tif", vigra::Diff2D (10, 20), vigra::Diff2D (70, 25));
+        checkRegion ("resstrips.tif", vigra::Diff2D (3, 0), vigra::Diff2D (4, shape.y));
+
+        vigra::ImageExportInfo tileinfo ("restiles.tif");
+        tileinfo.setCompression ("LZW").setTileSize (vigra::Size2D (32, 16));
+        exportImage (srcImageRange (img), tileinfo);
+
+        // full image, ROIs crossing tile borders, and border tiles
+        checkRegion ("restiles.tif", vigra::Diff2D (0, 0), shape);
+        checkRegion ("restiles.tif", vigra::Diff2D (10, 20), vigra::Diff2D (70, 25));
+        checkRegion ("restiles.tif", vigra::Diff2D (31, 15), vigra::Diff2D (33, 17));
+        checkRegion ("restiles.tif", shape - vigra::Diff2D (40, 19), shape);
+#endif
+    }
+
     void testTIFFSequence()
     {
 #if defined(HasTIFF)
@@ -648,6 +713,75 @@ class PNGInt16Test
     }
 };
 
+class BulkImportTest
+{
+  public:
+    template <class T>
+    void checkImport(const char * fileName, const char * pixelType)
+    {
+        typedef RGBValue<T> Pixel;
+        typedef TinyVector<T, 3> Vector;
+
+        BasicImage<Pixel> img(7, 5);
+        for (int y = 0; y < img.height(); ++y)
+            for (int x = 0; x < img.width(); ++x)
+                img(x, y) = Pixel(1000*y + x, 2000 + x*y, 30000 - 100*x - y);
+
+        exportImage(srcImageRange(img), ImageExportInfo(fileName));
+        ImageImportInfo info(fileName);
+        shouldEqual(std::string(info.getPixelType()), std::string(pixelType));
+
+        // BasicImage and MultiArrayView destinations are filled by Decoder::readScanlines()
+        BasicImage<Pixel> res(img.size());
+        importImage(info, destImage(res));
+        for (int y = 0; y < img.height(); ++y)
+            for (int x = 0; x < img.width(); ++x)
+                shouldEqual(res(x, y), img(x, y));
+
+        MultiArray<2, Vector> array(Shape2(7, 5)), transposed(Shape2(5, 7));
+        importImage(info, destImage(array));
+        MultiArrayView<2, Vector, StridedArrayTag> view(transposed.transpose());
+        importImage(info, destImage(view));
+        for (int y = 0; y < img.height(); ++y)
+            for (int x = 0; x < img.width(); ++x)
+            {
+                shouldEqual(array(x, y), Vector(img(x, y)));
+                shouldEqual(view(x, y), Vector(img(x, y)));
+            }
+
+        MultiArray<2, Vector> region(Shape2(4, 2));
+        importImageRegion(info, Diff2D(2, 1), Diff2D(6, 3), destImage(region));
+        for (int y = 0; y < 2; ++y)
+            for (int x = 0; x < 4; ++x)
+                shouldEqual(region(x, y), Vector(img(x + 2, y + 1)));
+
+        // planar destination with explicit strides
+        MultiArray<3, T> planes(Shape3(7, 5, 3));
+        VIGRA_UNIQUE_PTR<Decoder> dec(decoder(info));
+        dec->readScanlines(planes.data(), 7, 5, 3,
+                           planes.stride(0)*sizeof(T), planes.stride(2)*sizeof(T),
+                           planes.stride(1)*sizeof(T));
+        dec->close();
+        for (int y = 0; y < img.height(); ++y)
+            for (int x = 0; x < img.width(); ++x)
+                for (int b = 0; b < 3; ++b)
+                    shouldEqual(planes(x, y, b), img(x, y)[b]);
+    }
+
+    void testInterleaved()
+    {
+        checkImport<UInt16>("res.ppm", "UINT16");
+#if defined(HasTIFF)
+        checkImport<UInt16>("res.tif", "UINT16");
+#endif
+    }
+
+    void testPlanar()
+    {
+        checkImport<Int16>("res.xv", "INT16");
+    }
+};
+
 class FloatImageExportImportTest
 {
     typedef vigra::DImage Image;
@@ -1649,6 +1783,7 @@ struct ImageImportExportTestSuite : public vigra::test_suite
         add(testCase(&ByteImageExportImportTest::testJPEG));
         add(testCase(&ByteImageExportImportTest::testTIFF));
         add(testCase(&ByteImageExportImportTest::testTIFFSequence));
+        add(testCase(&ByteImageExportImportTest::testImportRegion));
         add(testCase(&ByteImageExportImportTest::testBMP));
         add(testCase(&ByteImageExportImportTest::testPGM));
         add(testCase(&ByteImageExportImportTest::testPNM));
@@ -1676,6 +1811,10 @@ struct ImageImportExportTestSuite : public vigra::test_suite
         add(testCase(&PNGInt16Test::testByteOrder));
 #endif
 
+        // decoding into memory via Decoder::readScanlines()
+        add(testCase(&BulkImportTest::testInterleaved));
+        add(testCase(&BulkImportTest::testPlanar));
+
         add(testCase(&CanvasSizeTest::testTIFFCanvasSize));
 
         // grayscale float images
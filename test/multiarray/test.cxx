@@ -44,6 +44,8 @@
 #include "vigra/multi_tensorutilities.hxx"
 #include "vigra/functorexpression.hxx"
 #include "vigra/multi_math.hxx"
+#include "vigra/multi_array_chunked.hxx"
+#include "vigra/multi_array_mmap.hxx"
 #include "vigra/algorithm.hxx"
 #include "vigra/random.hxx"
 #include "vigra/timing.hxx"
@@ -1409,6 +1411,81 @@ struct MultiImpexTest
         shouldEqual(result(0,1,3), 4);
 #endif // _WIN32
     }
+
+    void testParallelImpex()
+    {
+#if defined(HasPNG)
+        const char * ext = ".png";
+#else
+        const char * ext = ".pnm";
+#endif
+        Array volume(Shape(5,4,9));
+        for(int k=0; k<volume.size(); ++k)
+            volume[k] = (unsigned char)(k % 251);
+
+        exportVolume(volume, VolumeExportInfo("impex/parallel", ext), ParallelOptions().numThreads(4));
+
+        VolumeImportInfo info("impex/parallel", ext);
+        shouldEqual(info.shape(), volume.shape());
+
+        Array result(info.shape());
+        importVolume(info, result, ParallelOptions().numThreads(4));
+        shouldEqualSequence(result.begin(), result.end(), volume.begin());
+
+        // z-range and ROI
+        Shape roiBegin(1,2,3), roiEnd(4,4,8);
+        Array roi(roiEnd - roiBegin);
+        importVolume(info, roi, roiBegin, roiEnd, ParallelOptions().numThreads(3));
+        should(roi == volume.subarray(roiBegin, roiEnd));
+
+        // only z-range
+        roiBegin = Shape(0,0,7);
+        roiEnd = volume.shape();
+        roi.reshape(roiEnd - roiBegin);
+        importVolume(info, roi, roiBegin, roiEnd, ParallelOptions().numThreads(ParallelOptions::NoThreads));
+        should(roi == volume.subarray(roiBegin, roiEnd));
+
+        try
+        {
+            importVolume(info, roi, Shape(0,0,7), Shape(5,4,10));
+            failTest("no exception thrown");
+        }
+        catch(vigra::ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nimportVolume(): ROI out of range.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testMultiPageImpex()
+    {
+#if defined(HasTIFF)
+        Array volume(Shape(5,4,13));
+        for(int k=0; k<volume.size(); ++k)
+            volume[k] = (unsigned char)(k % 251);
+
+        exportVolume(volume, VolumeExportInfo("impex/multipage", ".tif").setFileType("MULTIPAGE"));
+
+        VolumeImportInfo info("impex/multipage.tif");
+        shouldEqual(std::string(info.getFileType()), std::string("MULTIPAGE"));
+        shouldEqual(info.shape(), volume.shape());
+
+        Array result;
+        importVolume(result, "impex/multipage.tif");
+        shouldEqual(result.shape(), volume.shape());
+        shouldEqualSequence(result.begin(), result.end(), volume.begin());
+
+        result.init(0);
+        importVolume(info, result, ParallelOptions().numThreads(4));
+        shouldEqualSequence(result.begin(), result.end(), volume.begin());
+
+        Shape roiBegin(1,2,3), roiEnd(4,4,11);
+        Array roi(roiEnd - roiBegin);
+        importVolume(info, roi, roiBegin, roiEnd, ParallelOptions().numThreads(3));
+        should(roi == volume.subarray(roiBegin, roiEnd));
+#endif
+    }
 };
 
 template <class IMAGE>
@@ -1984,6 +2061,77 @@ struct MultiArrayPointoperatorsTest
                 for(x=0; x<img.shape(0); ++x)
                     shouldEqual(res(x,y,z), 3.0*img(x,y,z));
     }
+
+    void testParallel()
+    {
+        Image3D big(Size3(31, 23, 17)), ref(big.shape()), res(big.shape());
+        for(int i=0; i<big.elementCount(); ++i)
+            big.data()[i] = 0.5f*i;
+        ParallelOptions options = ParallelOptions().numThreads(4);
+        
+        // contiguous arrays use the flat loop
+        transformMultiArray(srcMultiArrayRange(big), destMultiArray(ref), Arg1() + Arg1());
+        transformMultiArray(big, res, Arg1() + Arg1(), options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        res.init(0.0f);
+        transformMultiArray(big, res, Arg1() + Arg1());
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        // strided arrays are split along the outermost dimension
+        View3D sub = big.subarray(Size3(1,2,3), Size3(30,22,16)),
+               subres = res.subarray(Size3(1,2,3), Size3(30,22,16));
+        Image3D subref(sub.shape());
+        res.init(0.0f);
+        transformMultiArray(srcMultiArrayRange(sub), destMultiArray(subref), Arg1() * Param(3.0f));
+        transformMultiArray(sub, subres, Arg1() * Param(3.0f), options);
+        shouldEqualSequence(subres.begin(), subres.end(), subref.begin());
+        shouldEqual(res(0,0,0), 0.0f);
+        
+        subres.init(0.0f);
+        transformMultiArray(srcMultiArrayRange(sub), destMultiArray(subres), Arg1() * Param(3.0f),
+                            options);
+        shouldEqualSequence(subres.begin(), subres.end(), subref.begin());
+        
+        // expand mode falls back to sequential execution
+        res.init(0.0f);
+        transformMultiArray(big.subarray(Size3(0,0,0), Size3(31,23,1)), res, Arg1() + Arg1(), options);
+        for(int z=0; z<res.shape(2); ++z)
+            shouldEqualSequence(res.bindOuter(z).begin(), res.bindOuter(z).end(), ref.bindOuter(0).begin());
+        
+        combineTwoMultiArrays(srcMultiArrayRange(big), srcMultiArray(big), destMultiArray(ref),
+                              Arg1() * Arg2());
+        combineTwoMultiArrays(big, big, res, Arg1() * Arg2(), options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        res.init(0.0f);
+        combineTwoMultiArrays(big.transpose(), big.transpose(), res.transpose(), Arg1() * Arg2(), options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        res.init(0.0f);
+        combineTwoMultiArrays(srcMultiArrayRange(big), srcMultiArray(big), destMultiArray(res),
+                              Arg1() * Arg2(), options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        combineThreeMultiArrays(srcMultiArrayRange(big), srcMultiArray(big), srcMultiArray(ref), 
+                                destMultiArray(res), Arg1() + Arg2() - Arg3());
+        Image3D res3(big.shape());
+        combineThreeMultiArrays(big, big, ref, res3, Arg1() + Arg2() - Arg3(), options);
+        shouldEqualSequence(res3.begin(), res3.end(), res.begin());
+        
+        res3.init(0.0f);
+        combineThreeMultiArrays(big.transpose(), big.transpose(), ref.transpose(), res3.transpose(), 
+                                Arg1() + Arg2() - Arg3(), options);
+        shouldEqualSequence(res3.begin(), res3.end(), res.begin());
+        
+        try
+        {
+            combineThreeMultiArrays(big, big, sub, res3, Arg1() + Arg2() - Arg3(), options);
+            failTest("combineThreeMultiArrays() failed to throw exception.");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
     
     void testInitMultiArrayBorder(){
         typedef vigra::MultiArray<1,int> IntLine;
@@ -2649,9 +2797,378 @@ public:
                     shouldEqualTolerance(a(x,y,z), std::atan2(4.0, 3.0), 1e-16);
     }
 
+    void testParallel()
+    {
+        using namespace vigra::multi_math;
+        
+        Shape3 s(37, 23, 19);
+        array3_type gx(s), gy(s), gz(s), ref, res;
+        for(int i=0; i<gx.size(); ++i)
+        {
+            gx[i] = 0.5*i;
+            gy[i] = -1.0 - i;
+            gz[i] = std::sin(0.1*i);
+        }
+        ParallelOptions options = ParallelOptions().numThreads(4);
+        
+        // contiguous operands: flat loop, target is resized
+        ref = sqrt(sq(gx) + sq(gy) + sq(gz));
+        assign(res, sqrt(sq(gx) + sq(gy) + sq(gz)), options);
+        shouldEqual(res.shape(), s);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        // strided operands: chunks along the outermost axis
+        array3_type t(gx.transpose().shape()), tref(t.shape());
+        tref = gx.transpose() * 2.0 - gy.transpose();
+        assign(t, gx.transpose() * 2.0 - gy.transpose(), options);
+        shouldEqualSequence(t.begin(), t.end(), tref.begin());
+        
+        MultiArrayView<3, scalar_type, StridedArrayTag> tv = t.transpose();
+        tv.init(0.0);
+        assign(tv, gx * 2.0 - gy, options);
+        shouldEqualSequence(t.begin(), t.end(), tref.begin());
+        
+        // singleton expansion
+        MultiArray<1, double> ss((Shape1(s[1])));
+        linearSequence(ss.begin(), ss.end(), 1.0);
+        ref = ss.insertSingletonDimension(0).insertSingletonDimension(2) + gz;
+        assign(res, ss.insertSingletonDimension(0).insertSingletonDimension(2) + gz, options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        // computed assignment
+        ref += sq(gx);
+        plusAssign(res, sq(gx), options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        ref -= 2.0*gy;
+        minusAssign(res, 2.0*gy, options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        ref *= gz + 2.0;
+        multiplyAssign(res, gz + 2.0, options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        ref /= abs(gy);
+        divideAssign(res, abs(gy), options);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+        
+        try
+        {
+            assign(r5, gx + gy, options);
+            failTest("shape mismatch exception not thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+
 };
 
 
+// temporary file whose writes can be made to fail
+struct FailingChunkedArray
+: public ChunkedArrayTmpFile<3, int>
+{
+    typedef ChunkedArrayTmpFile<3, int> base_type;
+
+    FailingChunkedArray(shape_type const & shape, shape_type const & chunk_shape,
+                        ChunkedArrayOptions const & options)
+    : base_type(shape, chunk_shape, options),
+      fail(false)
+    {}
+
+    virtual void storeChunk(shape_type const & chunkIndex, view_type const & chunk)
+    {
+        vigra_postcondition(!fail, "FailingChunkedArray: write error.");
+        base_type::storeChunk(chunkIndex, chunk);
+    }
+
+    bool fail;
+};
+
+struct ChunkedArrayTest
+{
+    typedef MultiArrayShape<3>::type Shape;
+    typedef ChunkedArrayTmpFile<3, int> ChunkedArrayType;
+
+    MultiArray<3, int> ref;
+
+    ChunkedArrayTest()
+    : ref(Shape(50, 40, 30))
+    {
+        linearSequence(ref.begin(), ref.end());
+    }
+
+    void testBasics()
+    {
+        ChunkedArrayType array(ref.shape(), Shape(16, 16, 16),
+                               ChunkedArrayOptions().fillValue(3));
+
+        shouldEqual(array.shape(), ref.shape());
+        shouldEqual(array.chunkShape(), Shape(16));
+        shouldEqual(array.chunkArrayShape(), Shape(4, 3, 2));
+        shouldEqual(array.chunkShape(Shape(3, 2, 1)), Shape(2, 8, 14));
+        shouldEqual(array.cacheMaxSize(), 4);
+        shouldEqual(array.cacheSize(), 0);
+
+        shouldEqual(array.getItem(Shape(49, 39, 29)), 3);
+        array.setItem(Shape(1, 2, 3), 42);
+        array.setItem(Shape(49, 39, 29), 43);
+        shouldEqual(array.getItem(Shape(1, 2, 3)), 42);
+        shouldEqual(array.getItem(Shape(49, 39, 29)), 43);
+        shouldEqual(array.getItem(Shape(0, 0, 0)), 3);
+
+        try
+        {
+            array.getItem(Shape(50, 0, 0));
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+
+    void testSubarray()
+    {
+        ChunkedArrayType array(ref.shape(), Shape(16, 8, 4),
+                               ChunkedArrayOptions().cacheMax(5));
+        array.commitSubarray(Shape(), ref);
+        should(array.cacheSize() <= 5);
+
+        MultiArray<3, int> res(ref.shape());
+        array.checkoutSubarray(Shape(), res);
+        should(array.cacheSize() <= 5);
+        should(res == ref);
+
+        // unaligned blocks
+        Shape start(3, 7, 5), stop(41, 33, 28);
+        MultiArray<3, int> block(stop - start);
+        array.checkoutSubarray(start, block);
+        should(block == ref.subarray(start, stop));
+
+        block *= -1;
+        array.commitSubarray(start, block);
+        ref.subarray(start, stop) *= -1;
+        array.checkoutSubarray(Shape(), res);
+        should(res == ref);
+
+        // strided views
+        MultiArray<3, int> transposed(Shape(30, 40, 50));
+        MultiArrayView<3, int, StridedArrayTag> view = transposed.transpose();
+        array.checkoutSubarray(Shape(), view);
+        should(view == ref);
+    }
+
+    void testChunkIterator()
+    {
+        ChunkedArrayType array(ref.shape(), Shape(16, 8, 4),
+                               ChunkedArrayOptions().cacheMax(3));
+        array.commitSubarray(Shape(), ref);
+
+        Shape start(5, 3, 2), stop(45, 37, 25);
+        double sum = 0.0;
+        int count = 0;
+        ChunkedArrayType::chunk_iterator i   = array.chunk_cbegin(start, stop),
+                                         end = array.chunk_end(start, stop);
+        for(; i != end; ++i, ++count)
+        {
+            should(array.cacheSize() <= 3);
+            should(*i == ref.subarray(i.chunkStart(), i.chunkStop()));
+            sum += i->sum<double>();
+        }
+        shouldEqual(count, 3*5*7);
+        shouldEqual(sum, ref.subarray(start, stop).sum<double>());
+
+        // write through the iterator
+        for(i = array.chunk_begin(start, stop); i != end; ++i)
+        {
+            ChunkedArrayType::chunk_iterator::view_type v = *i;
+            v += 1;
+        }
+        ref.subarray(start, stop) += 1;
+        MultiArray<3, int> res(ref.shape());
+        array.checkoutSubarray(Shape(), res);
+        should(res == ref);
+    }
+
+    void testErrors()
+    {
+        try
+        {
+            ChunkedArrayType array(Shape(10, 0, 10), Shape(4));
+            failTest("no exception thrown for zero shape");
+        }
+        catch(PreconditionViolation &)
+        {}
+        try
+        {
+            ChunkedArrayType array(Shape(10), Shape(4, 0, 4));
+            failTest("no exception thrown for zero chunk shape");
+        }
+        catch(PreconditionViolation &)
+        {}
+
+        FailingChunkedArray array(Shape(8), Shape(4), ChunkedArrayOptions().cacheMax(1));
+        array.setItem(Shape(0, 0, 0), 1);
+        array.fail = true;
+        try
+        {
+            // evicting the modified first chunk fails
+            array.setItem(Shape(4, 0, 0), 2);
+            failTest("no exception thrown for write error");
+        }
+        catch(PostconditionViolation &)
+        {}
+        shouldEqual(array.cacheSize(), 2);
+        try
+        {
+            array.flush();
+            failTest("flush(): no exception thrown for write error");
+        }
+        catch(PostconditionViolation &)
+        {}
+
+        // the chunk requested by the failed call must not remain locked
+        array.fail = false;
+        array.setItem(Shape(0, 4, 0), 3);
+        shouldEqual(array.cacheSize(), 1);
+        shouldEqual(array.getItem(Shape(0, 0, 0)), 1);
+        shouldEqual(array.getItem(Shape(4, 0, 0)), 0);
+        shouldEqual(array.getItem(Shape(0, 4, 0)), 3);
+        array.flush();
+    }
+
+    void testFlushWhileAcquired()
+    {
+        ChunkedArrayType array(Shape(8), Shape(4), ChunkedArrayOptions().cacheMax(1));
+        ChunkedArrayType::view_type chunk = array.acquireChunk(Shape(), true);
+        chunk[Shape(1, 2, 3)] = 1;
+        array.flush();
+        // modifications after flush() must not be lost, although the chunk has been stored
+        chunk[Shape(1, 2, 3)] = 2;
+        chunk[Shape(3, 3, 3)] = 4;
+        array.releaseChunk(Shape());
+
+        // evict the chunk by loading another one, then read it back from the file
+        shouldEqual(array.getItem(Shape(4, 4, 4)), 0);
+        shouldEqual(array.cacheSize(), 1);
+        shouldEqual(array.getItem(Shape(1, 2, 3)), 2);
+        shouldEqual(array.getItem(Shape(3, 3, 3)), 4);
+    }
+
+    void testParallel()
+    {
+        ChunkedArrayType array(ref.shape(), Shape(8, 8, 8),
+                               ChunkedArrayOptions().cacheMax(4));
+        parallel_foreach(ParallelOptions().numThreads(4), ref.shape(2),
+            [&](int, std::ptrdiff_t z)
+            {
+                Shape start(0, 0, z), stop(ref.shape(0), ref.shape(1), z+1);
+                array.commitSubarray(start, ref.subarray(start, stop));
+            });
+        should(array.cacheSize() <= 4 + 4);
+
+        MultiArray<3, int> res(ref.shape());
+        parallel_foreach(ParallelOptions().numThreads(4), ref.shape(2),
+            [&](int, std::ptrdiff_t z)
+            {
+                Shape start(0, 0, z), stop(ref.shape(0), ref.shape(1), z+1);
+                MultiArrayView<3, int, StridedArrayTag> slice = res.subarray(start, stop);
+                array.checkoutSubarray(start, slice);
+            });
+        should(res == ref);
+    }
+};
+
+struct MappedMultiArrayTest
+{
+    typedef MultiArrayShape<3>::type Shape;
+    typedef MappedMultiArray<3, float> MappedArray;
+
+    MultiArray<3, float> ref;
+    std::string filename;
+    int header;
+
+    MappedMultiArrayTest()
+    : ref(Shape(20, 30, 10)),
+      filename("mmap_test.raw"),
+      header(8)
+    {
+        linearSequence(ref.begin(), ref.end(), 0.5f);
+
+        std::ofstream f(filename.c_str(), std::ios::binary);
+        f.write("header.", header);
+        f.write((char const *)ref.data(), ref.size()*sizeof(float));
+    }
+
+    ~MappedMultiArrayTest()
+    {
+        std::remove(filename.c_str());
+    }
+
+    MultiArray<3, float> readFile()
+    {
+        MultiArray<3, float> res(ref.shape());
+        std::ifstream f(filename.c_str(), std::ios::binary);
+        f.seekg(header);
+        f.read((char *)res.data(), res.size()*sizeof(float));
+        return res;
+    }
+
+    void testReadOnly()
+    {
+        MappedArray array(filename, ref.shape(), MappedArray::ReadOnly, header);
+        shouldEqual(array.shape(), ref.shape());
+        shouldEqual(array.mode(), MappedArray::ReadOnly);
+        should(array == ref);
+        should(array.subarray(Shape(3, 4, 5), Shape(10, 20, 8)) == ref.subarray(Shape(3, 4, 5), Shape(10, 20, 8)));
+
+        // changes are private
+        array(1, 2, 3) = -1.0f;
+        shouldEqual(array(1, 2, 3), -1.0f);
+        array.flush();
+        should(readFile() == ref);
+
+        try
+        {
+            MappedArray tooLarge(filename, Shape(20, 30, 11));
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+
+        try
+        {
+            MappedArray misaligned(filename, Shape(20, 30, 9), MappedArray::ReadOnly, 7);
+            failTest("no exception thrown for misaligned byteOffset");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+
+    void testReadWrite()
+    {
+        {
+            MappedArray array(filename, ref.shape(), MappedArray::ReadWrite, header);
+            should(array == ref);
+            array.bindOuter(2) = 42.0f;
+            ref.bindOuter(2) = 42.0f;
+            array.flush();
+            should(readFile() == ref);
+            array(1, 2, 3) = -1.0f;
+            ref(1, 2, 3) = -1.0f;
+        }
+        should(readFile() == ref);
+
+        {
+            MappedMultiArray<2, UInt8> created("mmap_test_created.raw", Shape2(50, 20), 
+                                               MappedMultiArray<2, UInt8>::Create, 100);
+            shouldEqual(created(49, 19), 0);
+            created = MultiArray<2, UInt8>(Shape2(50, 20), 3);
+        }
+        MappedMultiArray<2, UInt8> reopened("mmap_test_created.raw", Shape2(50, 20),
+                                            MappedMultiArray<2, UInt8>::ReadOnly, 100);
+        shouldEqual(reopened(0, 0), 3);
+        shouldEqual(reopened(49, 19), 3);
+        std::remove("mmap_test_created.raw");
+    }
+};
+
 struct ImageViewTestSuite
 : public vigra::test_suite
 {
@@ -2696,12 +3213,22 @@ struct MultiArrayTestSuite
         add( testCase( &MultiArrayTest::test_bindAt ) );
         add( testCase( &MultiArrayTest::test_bind ) );
         add( testCase( &MultiArrayTest::test_reshape) );
+        add( testCase( &ChunkedArrayTest::testBasics) );
+        add( testCase( &ChunkedArrayTest::testSubarray) );
+        add( testCase( &ChunkedArrayTest::testChunkIterator) );
+        add( testCase( &ChunkedArrayTest::testErrors) );
+        add( testCase( &ChunkedArrayTest::testFlushWhileAcquired) );
+        add( testCase( &ChunkedArrayTest::testParallel) );
+        add( testCase( &MappedMultiArrayTest::testReadOnly) );
+        add( testCase( &MappedMultiArrayTest::testReadWrite) );
         add( testCase( &MultiArrayTest::test_subarray ) );
         add( testCase( &MultiArrayTest::test_stridearray ) );
         add( testCase( &MultiArrayTest::test_copy_int_float ) );
         add( testCase( &MultiArrayTest::test_expandElements ) );
 
         add( testCase( &MultiImpexTest::testImpex ) );
+        add( testCase( &MultiImpexTest::testParallelImpex ) );
+        add( testCase( &MultiImpexTest::testMultiPageImpex ) );
     }
 };
 
@@ -2752,6 +3279,7 @@ struct MultiArrayPointOperatorsTestSuite
         add( testCase( &MultiArrayPointoperatorsTest::testCombine2OuterReduce ) );
         add( testCase( &MultiArrayPointoperatorsTest::testCombine2InnerReduce ) );
         add( testCase( &MultiArrayPointoperatorsTest::testCombine3 ) );
+        add( testCase( &MultiArrayPointoperatorsTest::testParallel ) );
         add( testCase( &MultiArrayPointoperatorsTest::testInitMultiArrayBorder ) );
         add( testCase( &MultiArrayPointoperatorsTest::testTensorUtilities ) );
 
@@ -2763,6 +3291,7 @@ struct MultiArrayPointOperatorsTestSuite
         add( testCase( &MultiMathTest::testNonscalarValues ) );
         add( testCase( &MultiMathTest::testMixedExpressions ) );
         add( testCase( &MultiMathTest::testComplex ) );
+        add( testCase( &MultiMathTest::testParallel ) );
     }
 }; // struct MultiArrayPointOperatorsTestSuite
 
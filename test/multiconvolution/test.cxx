@@ -470,6 +470,76 @@ struct MultiArraySeparableConvolutionTest
         shouldEqualSequenceTolerance(st.data(), st.data()+size, rst.data(), epsilon);
     }
 
+    void testParallel()
+    {
+        makeRandom(srcImage);
+
+        ArrayVector<Kernel1D<double> > kernels(3);
+        kernels[0].initGaussian(1.0);
+        kernels[1].initAveraging(1);
+        kernels[2].initGaussian(2.0);
+
+        // the parallel result must be bit-identical to the serial one, 
+        // also when the last block is smaller than the kernel radius
+        Image3D res(shape), pres(shape);
+        separableConvolveMultiArray(srcMultiArrayRange(srcImage), destMultiArray(res), 
+                                    kernels.begin());
+        separableConvolveMultiArray(srcMultiArrayRange(srcImage), destMultiArray(pres), 
+                                    kernels.begin(), 
+                                    ConvolutionOptions<3>().numThreads(4).blockShape(Size3(29, 23, 16)));
+        shouldEqualSequence(pres.begin(), pres.end(), res.begin());
+
+        Size3 start(5, 10, 20), stop(55, 60, 30);
+        Image3D subarray(stop-start);
+        separableConvolveMultiArray(srcMultiArrayRange(srcImage), destMultiArray(subarray), 
+                                    kernels.begin(), 
+                                    ConvolutionOptions<3>().numThreads(3).blockShape(Size3(16)).subarray(start, stop));
+        shouldEqualSequence(subarray.begin(), subarray.end(), res.subarray(start, stop).begin());
+
+        // the serial subarray convolution processes the axes in a different order,
+        // so it only agrees up to rounding
+        Image3D ssubarray(stop-start);
+        separableConvolveMultiArray(srcMultiArrayRange(srcImage), destMultiArray(ssubarray), 
+                                    kernels.begin(), start, stop);
+        shouldEqualSequenceTolerance(subarray.begin(), subarray.end(), ssubarray.begin(), 1e-6);
+
+        MultiArray<3, unsigned char> bytes(shape), bres(shape), bpres(shape);
+        makeRandom(bytes);
+        gaussianSmoothMultiArray(srcMultiArrayRange(bytes), destMultiArray(bres), 2.0);
+        gaussianSmoothMultiArray(srcMultiArrayRange(bytes), destMultiArray(bpres), 2.0, 
+                                 ConvolutionOptions<3>().numThreads(4).blockShape(Size3(20)));
+        shouldEqualSequence(bpres.begin(), bpres.end(), bres.begin());
+
+        Image3x3 grad(shape), pgrad(shape);
+        gaussianGradientMultiArray(srcMultiArrayRange(srcImage), destMultiArray(grad), 1.5);
+        gaussianGradientMultiArray(srcMultiArrayRange(srcImage), destMultiArray(pgrad), 1.5, 
+                                   ConvolutionOptions<3>().numThreads(ParallelOptions::Auto).blockShape(Size3(32, 32, 8)));
+        shouldEqualSequence(pgrad.begin(), pgrad.end(), grad.begin());
+
+        MultiArray<3, TinyVector<PixelType, 6> > hessian(shape), phessian(shape);
+        hessianOfGaussianMultiArray(srcMultiArrayRange(srcImage), destMultiArray(hessian), 1.0);
+        hessianOfGaussianMultiArray(srcMultiArrayRange(srcImage), destMultiArray(phessian), 1.0, 
+                                    ConvolutionOptions<3>().numThreads(2));
+        shouldEqualSequence(phessian.begin(), phessian.end(), hessian.begin());
+
+        // in-place operation falls back to the serial computation
+        Image3D inplace(srcImage);
+        separableConvolveMultiArray(srcMultiArrayRange(inplace), destMultiArray(inplace), 
+                                    kernels.begin(), 
+                                    ConvolutionOptions<3>().numThreads(4).blockShape(Size3(16)));
+        shouldEqualSequence(inplace.begin(), inplace.end(), res.begin());
+
+        kernels[1].setBorderTreatment(BORDER_TREATMENT_WRAP);
+        try
+        {
+            separableConvolveMultiArray(srcMultiArrayRange(srcImage), destMultiArray(pres), 
+                                        kernels.begin(), ConvolutionOptions<3>().numThreads(2));
+            failTest("separableConvolveMultiArray(): no exception thrown for BORDER_TREATMENT_WRAP.");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+
     //--------------------------------------------
 
     const Size3 shape;
@@ -532,6 +602,7 @@ struct MultiArraySeparableConvolutionTestSuite
                 add( testCase( &MultiArraySeparableConvolutionTest::test_InplaceN ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_Inplace1 ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::testSmoothing ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::testParallel ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_gradient1 ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_laplacian ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_hessian ) );
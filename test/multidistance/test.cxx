@@ -1151,6 +1151,90 @@ struct MultiDistanceTest
         separableMultiDistance(srcMultiArrayRange(img2), destMultiArray(res), true);
         shouldEqualSequence(res.begin(), res.end(), desired);
     }
+
+    void testDistanceParallel()
+    {
+        typedef MultiArrayShape<3>::type Shape;
+        MultiArrayView<3, double> vol(Shape(12,10,35), volume_data);
+        TinyVector<double, 3> pixelPitch(1.2, 1.0, 2.4);
+        
+        MultiArray<3, double> res1(vol.shape()), res2(vol.shape());
+
+        // multi-threaded results are identical to the sequential ones
+        separableMultiDistSquared(srcMultiArrayRange(vol), destMultiArray(res1), false);
+        separableMultiDistSquared(vol, res2, false, ParallelOptions().numThreads(4));
+        shouldEqualSequence(res1.begin(), res1.end(), res2.begin());
+        shouldEqualSequence(res2.begin(), res2.end(), ref_dist2);
+
+        separableMultiDistance(srcMultiArrayRange(vol), destMultiArray(res1), true, pixelPitch);
+        separableMultiDistance(vol, res2, true, pixelPitch, ParallelOptions().numThreads(4));
+        shouldEqualSequence(res1.begin(), res1.end(), res2.begin());
+
+        // in-place on a transposed (strided) view
+        res2 = vol;
+        MultiArrayView<3, double, StridedArrayTag> pres2(res2.transpose());
+        separableMultiDistance(pres2, pres2, true, 
+                               TinyVector<double, 3>(pixelPitch[2], pixelPitch[1], pixelPitch[0]), 
+                               ParallelOptions().numThreads(3));
+        shouldEqualSequenceTolerance(res1.begin(), res1.end(), res2.begin(), 1e-12);
+
+        // single precision results are computed in the destination directly
+        MultiArray<3, float> fres(vol.shape());
+        separableMultiDistSquared(vol, fres, false, ParallelOptions().numThreads(4));
+        shouldEqualSequence(fres.begin(), fres.end(), ref_dist2);
+
+        separableMultiDistance(vol, fres, true, pixelPitch, ParallelOptions().numThreads(4));
+        shouldEqualSequenceTolerance(fres.begin(), fres.end(), res1.begin(), 1e-5);
+    }
+
+    template <class Array>
+    void testVectorDistanceImpl(MultiArrayView<3, double> const & vol, bool background,
+                                Array const & pixelPitch)
+    {
+        typedef MultiArrayShape<3>::type Shape;
+        MultiArray<3, double> dist(vol.shape());
+        MultiArray<3, TinyVector<int, 3> > offsets(vol.shape()), offsets2(vol.shape());
+        
+        separableMultiDistSquared(vol, dist, background, pixelPitch);
+        separableVectorDistance(vol, offsets, background, pixelPitch);
+        separableVectorDistance(vol, offsets2, background, pixelPitch, ParallelOptions().numThreads(4));
+        shouldEqualSequence(offsets.begin(), offsets.end(), offsets2.begin());
+        
+        for(int k=0; k<vol.size(); ++k)
+        {
+            Shape p;
+            detail::ScanOrderToCoordinate<3>::exec(k, vol.shape(), p);
+            Shape target = p + offsets[p];
+            should(vol.isInside(target));
+            // the offsets point to a target pixel at the correct distance
+            if(background)
+                should(vol[target] != 0.0);
+            else
+                should(vol[target] == 0.0);
+            shouldEqualTolerance(squaredNorm(pixelPitch*offsets[p]), dist[p], 1e-10);
+        }
+    }
+
+    void testVectorDistance()
+    {
+        typedef MultiArrayShape<3>::type Shape;
+        MultiArrayView<3, double> vol(Shape(12,10,35), volume_data);
+        
+        testVectorDistanceImpl(vol, true, TinyVector<double, 3>(1.0));
+        testVectorDistanceImpl(vol, false, TinyVector<double, 3>(1.0));
+        testVectorDistanceImpl(vol, true, TinyVector<double, 3>(1.2, 1.0, 2.4));
+        testVectorDistanceImpl(vol, false, TinyVector<double, 3>(1.2, 1.0, 2.4));
+
+        // 1D
+        MultiArray<2, TinyVector<int, 2> > res(img2.shape());
+        static const int desired[] = {3, 2, 1, 0, -1, -2, -3};
+        separableVectorDistance(img2, res, true);
+        for(int k=0; k<7; ++k)
+        {
+            shouldEqual(res[k][0], desired[k]);
+            shouldEqual(res[k][1], 0);
+        }
+    }
 };
 
 
@@ -1166,6 +1250,8 @@ struct SimpleAnalysisTestSuite
         add( testCase( &MultiDistanceTest::testDistanceVolumesAnisoptopic));
         add( testCase( &MultiDistanceTest::distanceTransform2DCompare));
         add( testCase( &MultiDistanceTest::distanceTest1D));
+        add( testCase( &MultiDistanceTest::testDistanceParallel));
+        add( testCase( &MultiDistanceTest::testVectorDistance));
     }
 };
 
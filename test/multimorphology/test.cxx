@@ -34,6 +34,8 @@
 /************************************************************************/
 
 #include <iostream>
+#include <algorithm>
+#include <vector>
 #include "unittest.hxx"
 #include "vigra/stdimage.hxx"
 #include "vigra/multi_morphology.hxx"
@@ -282,6 +284,205 @@ struct MultiMorphologyTest
         multiGrayscaleErosion(srcMultiArrayRange(in), destMultiArray(tmp),2);
         multiGrayscaleDilation(srcMultiArrayRange(tmp), destMultiArray(res),2);
     }
+
+    // brute-force reference for the van Herk / Gil-Werman functions
+    template <unsigned int N, class T>
+    static void lineMorphologyReference(MultiArray<N, T> const & in, MultiArray<N, T> & res,
+                                        typename MultiArrayShape<N>::type const & step,
+                                        int radius, bool dilation)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+        for(MultiArrayIndex k = 0; k < in.size(); ++k)
+        {
+            Shape p;
+            detail::ScanOrderToCoordinate<N>::exec(k, in.shape(), p);
+            T v = in[p];
+            for(int j = -radius; j <= radius; ++j)
+            {
+                Shape q = p + j*step;
+                if(!in.isInside(q))
+                    continue;
+                v = dilation ? std::max(v, in[q]) : std::min(v, in[q]);
+            }
+            res[p] = v;
+        }
+    }
+
+    void boxMorphologyTest()
+    {
+        typedef MultiArrayShape<3>::type Shape;
+        Shape shape(13, 9, 11);
+        MultiArray<3, int> in(shape), ref(shape), tmp(shape), res(shape);
+        int seed = 42;
+        for(MultiArrayIndex k = 0; k < in.size(); ++k)
+        {
+            seed = (1103515245*seed + 12345) & 0x7fffffff;
+            in[k] = seed % 100;
+        }
+
+        Shape radius(2, 0, 3);
+
+        lineMorphologyReference(in, tmp, Shape(1,0,0), radius[0], false);
+        lineMorphologyReference(tmp, ref, Shape(0,0,1), radius[2], false);
+        multiBoxErosion(in, res, radius);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        // in-place
+        res = in;
+        multiBoxErosion(res, res, radius);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        lineMorphologyReference(ref, tmp, Shape(1,0,0), radius[0], true);
+        lineMorphologyReference(tmp, ref, Shape(0,0,1), radius[2], true);
+        multiBoxOpening(in, res, radius);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        lineMorphologyReference(in, tmp, Shape(1,0,0), radius[0], true);
+        lineMorphologyReference(tmp, ref, Shape(0,0,1), radius[2], true);
+        multiBoxDilation(in, res, radius);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        lineMorphologyReference(ref, tmp, Shape(1,0,0), radius[0], false);
+        lineMorphologyReference(tmp, ref, Shape(0,0,1), radius[2], false);
+        multiBoxClosing(in, res, radius);
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        // radius larger than the array: global extrema
+        multiBoxErosion(in, res, Shape(50));
+        int minimum = *std::min_element(in.begin(), in.end());
+        for(MultiArrayIndex k = 0; k < res.size(); ++k)
+            shouldEqual(res[k], minimum);
+
+        // zero radius copies the data
+        MultiArray<3, double> resd(shape);
+        multiBoxDilation(in, resd, Shape());
+        shouldEqualSequence(resd.begin(), resd.end(), in.begin());
+    }
+
+    void lineMorphologyTest()
+    {
+        typedef MultiArrayShape<3>::type Shape;
+        Shape shape(12, 10, 7);
+        MultiArray<3, int> in(shape), ref(shape), res(shape);
+        int seed = 7;
+        for(MultiArrayIndex k = 0; k < in.size(); ++k)
+        {
+            seed = (1103515245*seed + 12345) & 0x7fffffff;
+            in[k] = seed % 1000 - 500;
+        }
+
+        Shape steps[] = { Shape(1,0,0), Shape(0,-1,0), Shape(1,1,0), Shape(1,-1,1), Shape(2,1,0) };
+        int radii[] = { 0, 1, 3, 20 };
+        for(int s = 0; s < 5; ++s)
+        {
+            for(int r = 0; r < 4; ++r)
+            {
+                lineMorphologyReference(in, ref, steps[s], radii[r], false);
+                multiLineErosion(in, res, steps[s], radii[r]);
+                shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+                lineMorphologyReference(in, ref, steps[s], radii[r], true);
+                multiLineDilation(in, res, steps[s], radii[r]);
+                shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+                MultiArray<3, int> tmp(shape);
+                lineMorphologyReference(ref, tmp, steps[s], radii[r], false);
+                multiLineClosing(in, res, steps[s], radii[r]);
+                shouldEqualSequence(res.begin(), res.end(), tmp.begin());
+            }
+        }
+
+        MultiArray<2, float> img(Shape2(15, 1), 1.0f), imgres(Shape2(15, 1));
+        img(7, 0) = 5.0f;
+        multiLineOpening(img, imgres, Shape2(1, 0), 1);
+        shouldEqual(imgres(7, 0), 1.0f);
+        multiLineClosing(img, imgres, Shape2(1, 0), 1);
+        shouldEqual(imgres(7, 0), 5.0f);
+        shouldEqual(imgres(6, 0), 1.0f);
+    }
+
+    template <class T>
+    static void boxRankOrderReference(MultiArray<3, T> const & in, MultiArray<3, T> & res,
+                                      MultiArrayShape<3>::type const & radius, double rank)
+    {
+        typedef MultiArrayShape<3>::type Shape;
+        for(MultiArrayIndex k = 0; k < in.size(); ++k)
+        {
+            Shape p;
+            detail::ScanOrderToCoordinate<3>::exec(k, in.shape(), p);
+            std::vector<T> values;
+            Shape start = p - radius, stop = p + radius + Shape(1);
+            for(MultiArrayIndex z = std::max<MultiArrayIndex>(start[2], 0); z < std::min(stop[2], in.shape(2)); ++z)
+                for(MultiArrayIndex y = std::max<MultiArrayIndex>(start[1], 0); y < std::min(stop[1], in.shape(1)); ++y)
+                    for(MultiArrayIndex x = std::max<MultiArrayIndex>(start[0], 0); x < std::min(stop[0], in.shape(0)); ++x)
+                        values.push_back(in(x, y, z));
+            std::sort(values.begin(), values.end());
+            std::size_t needed = std::max<std::size_t>((std::size_t)std::ceil(rank*values.size()), 1);
+            res[p] = values[needed - 1];
+        }
+    }
+
+    void boxRankOrderFilterTest()
+    {
+        typedef MultiArrayShape<3>::type Shape;
+        int seed = 3;
+
+        MultiArray<2, UInt8> img(Shape2(23, 17)), imgres(img.shape());
+        for(MultiArrayIndex k = 0; k < img.size(); ++k)
+        {
+            seed = (1103515245*seed + 12345) & 0x7fffffff;
+            img[k] = seed % 256;
+        }
+        MultiArray<3, UInt8> img3(img.insertSingletonDimension(2)), ref(img3.shape());
+
+        double ranks[] = { 0.0, 0.3, 0.5, 1.0 };
+        Shape2 radii[] = { Shape2(0, 0), Shape2(1, 2), Shape2(3, 3), Shape2(30, 1) };
+        for(int r = 0; r < 4; ++r)
+        {
+            for(int k = 0; k < 4; ++k)
+            {
+                boxRankOrderReference(img3, ref, Shape(radii[k][0], radii[k][1], 0), ranks[r]);
+                multiBoxRankOrderFilter(img, imgres, radii[k], ranks[r]);
+                shouldEqualSequence(imgres.begin(), imgres.end(), ref.begin());
+            }
+        }
+
+        // parallel execution splits the image into row blocks
+        boxRankOrderReference(img3, ref, Shape(2, 2, 0), 0.5);
+        multiBoxMedian(img, imgres, Shape2(2), ParallelOptions().numThreads(4));
+        shouldEqualSequence(imgres.begin(), imgres.end(), ref.begin());
+
+        MultiArray<2, UInt16> img16(Shape2(300, 9)), img16res(img16.shape());
+        for(MultiArrayIndex k = 0; k < img16.size(); ++k)
+        {
+            seed = (1103515245*seed + 12345) & 0x7fffffff;
+            img16[k] = seed % 65536;
+        }
+        MultiArray<3, UInt16> img16_3(img16.insertSingletonDimension(2)), ref16(img16_3.shape());
+        boxRankOrderReference(img16_3, ref16, Shape(4, 2, 0), 0.5);
+        multiBoxMedian(img16, img16res, Shape2(4, 2), ParallelOptions().numThreads(2));
+        shouldEqualSequence(img16res.begin(), img16res.end(), ref16.begin());
+        boxRankOrderReference(img16_3, ref16, Shape(1, 3, 0), 0.8);
+        multiBoxRankOrderFilter(img16, img16res, Shape2(1, 3), 0.8);
+        shouldEqualSequence(img16res.begin(), img16res.end(), ref16.begin());
+        // the threads share the histogram memory, so more threads get narrower stripes
+        img16res.init(0);
+        multiBoxRankOrderFilter(img16, img16res, Shape2(1, 3), 0.8, ParallelOptions().numThreads(8));
+        shouldEqualSequence(img16res.begin(), img16res.end(), ref16.begin());
+
+        MultiArray<3, UInt8> vol(Shape(11, 8, 9)), volres(vol.shape()), volref(vol.shape());
+        for(MultiArrayIndex k = 0; k < vol.size(); ++k)
+        {
+            seed = (1103515245*seed + 12345) & 0x7fffffff;
+            vol[k] = seed % 256;
+        }
+        boxRankOrderReference(vol, volref, Shape(2, 1, 2), 0.5);
+        multiBoxMedian(vol, volres, Shape(2, 1, 2));
+        shouldEqualSequence(volres.begin(), volres.end(), volref.begin());
+        volres.init(0);
+        multiBoxMedian(vol, volres, Shape(2, 1, 2), ParallelOptions().numThreads(3));
+        shouldEqualSequence(volres.begin(), volres.end(), volref.begin());
+    }
     
     IntImage img, img2, lin;
     IntVolume vol;
@@ -302,6 +503,9 @@ struct MorphologyTestSuite
         add( testCase( &MultiMorphologyTest::grayDilationTest2D));
         add( testCase( &MultiMorphologyTest::grayErosionAndDilationTest2D));
         add( testCase( &MultiMorphologyTest::grayClosingTest2D));
+        add( testCase( &MultiMorphologyTest::boxMorphologyTest));
+        add( testCase( &MultiMorphologyTest::lineMorphologyTest));
+        add( testCase( &MultiMorphologyTest::boxRankOrderFilterTest));
     }
 };
 
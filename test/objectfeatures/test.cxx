@@ -1411,6 +1411,130 @@ struct AccumulatorTest
             shouldEqual(W(3, 0, 1), get<AutoRangeHistogram<3> >(c,3));
         }
     }
+
+    void testParallel()
+    {
+        using namespace vigra::acc;
+        
+        ParallelOptions options = ParallelOptions().numThreads(4);
+        
+        {
+            typedef AccumulatorChain<double, Select<Mean, Variance, Minimum, Maximum> > A;
+            
+            MultiArray<1, double> data(Shape1(10000));
+            for(int k=0; k<data.size(); ++k)
+                data[k] = std::sin(0.1*k) + 0.001*k;
+            
+            A a, b;
+            extractFeatures(data.begin(), data.end(), a);
+            extractFeatures(data.begin(), data.end(), b, options);
+            
+            shouldEqual(get<Count>(a), get<Count>(b));
+            shouldEqual(get<Minimum>(a), get<Minimum>(b));
+            shouldEqual(get<Maximum>(a), get<Maximum>(b));
+            shouldEqualTolerance(get<Mean>(a), get<Mean>(b), 1e-12);
+            shouldEqualTolerance(get<Variance>(a), get<Variance>(b), 1e-12);
+
+            // results are reproducible for a fixed number of threads
+            for(int k=0; k<10; ++k)
+            {
+                A c;
+                extractFeatures(data.begin(), data.end(), c, options);
+                shouldEqual(get<Mean>(c), get<Mean>(b));
+                shouldEqual(get<Variance>(c), get<Variance>(b));
+            }
+        }
+        
+        {
+            typedef CoupledIteratorType<3, double, int>::type Iterator;
+            typedef Iterator::value_type Handle;
+            typedef AccumulatorChainArray<Handle, Select<DataArg<1>, LabelArg<2>, 
+                                                         Mean, Variance, Maximum, Coord<Mean>, 
+                                                         Global<Count>, Global<Mean> > > A;
+            
+            Shape3 shape(40, 30, 20);
+            MultiArray<3, double> data(shape);
+            MultiArray<3, int> labels(shape);
+            for(int z=0; z<shape[2]; ++z)
+                for(int y=0; y<shape[1]; ++y)
+                    for(int x=0; x<shape[0]; ++x)
+                    {
+                        data(x,y,z) = x + 0.5*y - z;
+                        labels(x,y,z) = x / 10 + 4*(y / 10) + 12*(z / 7);
+                    }
+            Iterator start = createCoupledIterator(data, labels),
+                     end   = start.getEndIterator();
+            
+            A a, b;
+            a.ignoreLabel(5);
+            b.ignoreLabel(5);
+            extractFeatures(start, end, a);
+            extractFeatures(start, end, b, options);
+            
+            shouldEqual(a.maxRegionLabel(), 35);
+            shouldEqual(b.maxRegionLabel(), 35);
+            shouldEqual(get<Global<Count> >(a), get<Global<Count> >(b));
+            shouldEqualTolerance(get<Global<Mean> >(a), get<Global<Mean> >(b), 1e-12);
+            shouldEqual(get<Count>(b, 5), 0.0);
+            for(int k=0; k<=a.maxRegionLabel(); ++k)
+            {
+                shouldEqual(get<Count>(a, k), get<Count>(b, k));
+                if(get<Count>(a, k) == 0.0)
+                    continue;
+                shouldEqual(get<Maximum>(a, k), get<Maximum>(b, k));
+                shouldEqualTolerance(get<Mean>(a, k), get<Mean>(b, k), 1e-12);
+                shouldEqualTolerance(get<Variance>(a, k), get<Variance>(b, k), 1e-10);
+                shouldEqualSequenceTolerance(get<Coord<Mean> >(a, k).begin(), get<Coord<Mean> >(a, k).end(), 
+                                             get<Coord<Mean> >(b, k).begin(), 1e-12);
+            }
+            
+            // two passes required => sequential fallback gives identical results
+            typedef DynamicAccumulatorChainArray<Handle, Select<DataArg<1>, LabelArg<2>, 
+                                                                Mean, Skewness> > D;
+            D c, d;
+            c.activate<Skewness>();
+            d.activate<Skewness>();
+            shouldEqual(d.passesRequired(), 2u);
+            extractFeatures(start, end, c);
+            extractFeatures(start, end, d, options);
+            for(int k=0; k<=c.maxRegionLabel(); ++k)
+            {
+                shouldEqual(get<Count>(c, k), get<Count>(d, k));
+                shouldEqual(get<Skewness>(c, k), get<Skewness>(d, k));
+            }
+            
+            // only Mean is active => parallel execution
+            D e;
+            e.activate<Mean>();
+            extractFeatures(start, end, e, options);
+            for(int k=0; k<=a.maxRegionLabel(); ++k)
+            {
+                if(get<Count>(a, k) == 0.0)
+                    continue;
+                shouldEqualTolerance(get<Mean>(a, k), get<Mean>(e, k), 1e-12);
+            }
+        }
+
+        {
+            // mergeability is determined at compile time from the tags in the chain
+            typedef AccumulatorChain<TinyVector<double, 2>, Select<Variance, Principal<Variance>, Skewness> > M;
+            typedef AccumulatorChain<TinyVector<double, 2>, Select<Variance, Principal<Minimum> > > N;
+            should(vigra::acc::detail::AccumulatorsSupportMerge<M::AccumulatorTags>::value);
+            should(!vigra::acc::detail::AccumulatorsSupportMerge<N::AccumulatorTags>::value);
+            should(vigra::acc::detail::AccumulatorSupportsMerge<Coord<Central<PowerSum<2> > > >::value);
+            should(!vigra::acc::detail::AccumulatorSupportsMerge<Coord<Principal<PowerSum<3> > > >::value);
+
+            // chains that can't be merged are processed sequentially
+            MultiArray<1, TinyVector<double, 2> > data(Shape1(1000));
+            for(int k=0; k<data.size(); ++k)
+                data[k] = TinyVector<double, 2>(std::sin(0.1*k), std::cos(0.3*k));
+            N a, b;
+            extractFeatures(data.begin(), data.end(), a);
+            extractFeatures(data.begin(), data.end(), b, options);
+            shouldEqual(get<Principal<Minimum> >(a), get<Principal<Minimum> >(b));
+            shouldEqual(get<Variance>(a), get<Variance>(b));
+        }
+    }
 };
 
 struct FeaturesTestSuite : public vigra::test_suite
@@ -1427,6 +1551,7 @@ struct FeaturesTestSuite : public vigra::test_suite
         add(testCase(&AccumulatorTest::testHistogram));
         add(testCase(&AccumulatorTest::testLabelDispatch));
         add(testCase(&AccumulatorTest::testIndexSpecifiers));
+        add(testCase(&AccumulatorTest::testParallel));
     }
 };
 
@@ -288,6 +288,37 @@ struct SeededRegionGrowing3DTest
         shouldEqualSequence(res.begin(), res.end(), vol3.begin());
     }
     
+    void integerCostTest()
+    {
+        // integer costs use a bucket queue, which must give the same result as the heap
+        IntVolume::difference_type shape(12, 10, 8);
+        MultiArray<3, Int16> ivol(shape);
+        DoubleVolume dvol(shape);
+        IntVolume seeds(shape), ires(shape), dres(shape);
+        for(int k=0; k<ivol.size(); ++k)
+        {
+            ivol[k] = (Int16)(100*((k*7 + k/13) % 5) - 200);
+            dvol[k] = ivol[k];
+        }
+        seeds[IntVolume::difference_type(1, 1, 1)] = 1;
+        seeds[IntVolume::difference_type(10, 8, 6)] = 2;
+        seeds[IntVolume::difference_type(6, 0, 7)] = 3;
+
+        SRGType types[] = { CompleteGrow, KeepContours, StopAtThreshold };
+        for(int k=0; k<3; ++k)
+        {
+            vigra::ArrayOfRegionStatistics<SeedRgDirectValueFunctor<Int16> > icost(3);
+            vigra::ArrayOfRegionStatistics<DirectCostFunctor> dcost(3);
+            seededRegionGrowing3D(srcMultiArrayRange(ivol), srcMultiArray(seeds),
+                                  destMultiArray(ires), icost, types[k], 
+                                  NeighborCode3DSix(), 0.0);
+            seededRegionGrowing3D(srcMultiArrayRange(dvol), srcMultiArray(seeds),
+                                  destMultiArray(dres), dcost, types[k], 
+                                  NeighborCode3DSix(), 0.0);
+            shouldEqualSequence(ires.begin(), ires.end(), dres.begin());
+        }
+    }
+    
     IntVolume    vol1;
     DoubleVolume vol2;
     IntVolume    vol3;
@@ -306,6 +337,7 @@ struct SeededRegionGrowing3DTestSuite
         add( testCase( &SeededRegionGrowing3DTest::voronoiTest));
         add( testCase( &SeededRegionGrowing3DTest::voronoiTestWithBorder));
         add( testCase( &SeededRegionGrowing3DTest::simpleTest));
+        add( testCase( &SeededRegionGrowing3DTest::integerCostTest));
     }
 };
 
@@ -51,6 +51,7 @@
 #include "vigra/affinegeometry.hxx"
 #include "vigra/affine_registration.hxx"
 #include "vigra/impex.hxx"
+#include "vigra/random.hxx"
 
 #ifdef HasFFTW3
 # include "vigra/slanted_edge_mtf.hxx"
@@ -1691,6 +1692,42 @@ struct RegionGrowingTest
         shouldEqualSequence(res.begin(), res.end(), reference);
     }
 
+    void integerCostTest()
+    {
+        // integer costs use a bucket queue, which must give the same result as the heap
+        int w = 50, h = 40;
+        vigra::BImage bimg(w, h);
+        Image dimg(w, h);
+        vigra::IImage iseeds(w, h), bres(w, h), dres(w, h);
+        vigra::MersenneTwister random(7);
+        for(int y=0; y<h; ++y)
+        {
+            for(int x=0; x<w; ++x)
+            {
+                // few gray levels, so that many candidates have equal cost
+                bimg(x,y) = (unsigned char)(50*random.uniformInt(4));
+                dimg(x,y) = bimg(x,y);
+            }
+        }
+        iseeds = 0;
+        for(int k=1; k<=10; ++k)
+            iseeds(random.uniformInt(w), random.uniformInt(h)) = k;
+
+        SRGType types[] = { CompleteGrow, KeepContours, StopAtThreshold };
+        for(int k=0; k<3; ++k)
+        {
+            vigra::ArrayOfRegionStatistics<SeedRgDirectValueFunctor<unsigned char> > bcost(10);
+            vigra::ArrayOfRegionStatistics<DirectCostFunctor> dcost(10);
+            int bmax = seededRegionGrowing(srcImageRange(bimg), srcImage(iseeds), destImage(bres),
+                                           bcost, types[k], FourNeighborCode(), 100.0);
+            int dmax = seededRegionGrowing(srcImageRange(dimg), srcImage(iseeds), destImage(dres),
+                                           dcost, types[k], FourNeighborCode(), 100.0);
+            shouldEqual(bmax, 10);
+            shouldEqual(dmax, 10);
+            shouldEqualSequence(bres.begin(), bres.end(), dres.begin());
+        }
+    }
+
     Image img, seeds;
 };
 
@@ -2214,6 +2251,7 @@ struct SimpleAnalysisTestSuite
         add( testCase( &WatershedsTest::watersheds4Test));
         add( testCase( &RegionGrowingTest::voronoiTest));
         add( testCase( &RegionGrowingTest::voronoiWithBorderTest));
+        add( testCase( &RegionGrowingTest::integerCostTest));
         add( testCase( &InterestOperatorTest::cornerResponseFunctionTest));
         add( testCase( &InterestOperatorTest::foerstnerCornerTest));
         add( testCase( &InterestOperatorTest::rohrCornerTest));
@@ -0,0 +1,210 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include <iostream>
+#include <numeric>
+#include <vector>
+#include <stdexcept>
+#include "unittest.hxx"
+#include "vigra/threadpool.hxx"
+#include "vigra/multi_array.hxx"
+
+using namespace vigra;
+
+struct ThreadPoolTest
+{
+    void testParallelOptions()
+    {
+        ParallelOptions opt;
+        shouldEqual(opt.getNumThreads(), (int)ParallelOptions::Auto);
+        shouldEqual(opt.getActualNumThreads(), ParallelOptions::hardwareNumThreads());
+        shouldEqual(opt.numThreads(3).getActualNumThreads(), 3);
+        shouldEqual(opt.numThreads(ParallelOptions::NoThreads).getActualNumThreads(), 0);
+
+        ParallelOptions::setDefaultNumThreads(5);
+        shouldEqual(ParallelOptions::defaultNumThreads(), 5);
+        shouldEqual(ParallelOptions().getActualNumThreads(), 5);
+        ParallelOptions::setDefaultNumThreads(ParallelOptions::Auto);
+        shouldEqual(ParallelOptions::defaultNumThreads(), ParallelOptions::hardwareNumThreads());
+
+        // unknown special values must not become the default
+        try
+        {
+            ParallelOptions::setDefaultNumThreads(-3);
+            failTest("ParallelOptions::setDefaultNumThreads(): no exception thrown for n = -3.");
+        }
+        catch(PreconditionViolation &)
+        {}
+        shouldEqual(ParallelOptions::defaultNumThreads(), ParallelOptions::hardwareNumThreads());
+        shouldEqual(ParallelOptions().numThreads(-3).getActualNumThreads(), ParallelOptions::hardwareNumThreads());
+    }
+
+    void testEnqueue()
+    {
+        ThreadPool pool(4);
+        shouldEqual(pool.numThreads(), 4u);
+        shouldEqual(pool.currentThreadIndex(), -1);
+
+        std::vector<threading::future<int> > results;
+        for(int k=0; k<100; ++k)
+            results.push_back(pool.enqueue([k](int id) { return k*k + 0*id; }));
+        for(int k=0; k<100; ++k)
+            shouldEqual(results[k].get(), k*k);
+
+        threading::atomic_long count(0);
+        for(int k=0; k<100; ++k)
+            pool.enqueue([&count](int id) 
+            {
+                vigra_invariant(0 <= id && id < 4, "invalid thread index");
+                ++count; 
+            });
+        pool.waitFinished();
+        shouldEqual(count.load(), 100);
+
+        threading::future<void> error = pool.enqueue([](int) { throw std::runtime_error("task failed"); });
+        try
+        {
+            error.get();
+            failTest("ThreadPool: exception was not propagated.");
+        }
+        catch(std::runtime_error & e)
+        {
+            shouldEqual(std::string(e.what()), std::string("task failed"));
+        }
+    }
+
+    void testNoThreads()
+    {
+        ThreadPool pool(ParallelOptions().numThreads(ParallelOptions::NoThreads));
+        shouldEqual(pool.numThreads(), 0u);
+        threading::future<int> res = pool.enqueue([](int id) { return id + 42; });
+        shouldEqual(res.get(), 42);
+    }
+
+    void testParallelForeach()
+    {
+        int n = 10000;
+        std::vector<int> data(n);
+        std::iota(data.begin(), data.end(), 0);
+
+        parallel_foreach(ParallelOptions().numThreads(4), data.begin(), data.end(),
+            [](int, int & v) { v = 2*v; });
+        for(int k=0; k<n; ++k)
+            shouldEqual(data[k], 2*k);
+
+        // per-thread partial sums
+        ThreadPool pool(3);
+        std::vector<long> sums(pool.numThreads(), 0);
+        parallel_foreach(pool, n, [&](int id, std::ptrdiff_t i) { sums[id] += data[i]; });
+        shouldEqual(std::accumulate(sums.begin(), sums.end(), 0L), (long)n*(n-1));
+
+        // serial execution
+        std::vector<int> ids;
+        parallel_foreach(ParallelOptions().numThreads(ParallelOptions::NoThreads), 10, 
+            [&](int id, std::ptrdiff_t) { ids.push_back(id); });
+        shouldEqual(ids.size(), 10u);
+        shouldEqual(std::accumulate(ids.begin(), ids.end(), 0), 0);
+
+        // nested calls are executed serially by the calling worker
+        threading::atomic_long count(0);
+        parallel_foreach(pool, 20, [&](int, std::ptrdiff_t) 
+        {
+            parallel_foreach(pool, 10, [&](int, std::ptrdiff_t) { ++count; });
+        });
+        shouldEqual(count.load(), 200);
+
+        try
+        {
+            parallel_foreach(pool, 100, [](int, std::ptrdiff_t i) 
+            { 
+                if(i == 50) 
+                    throw std::runtime_error("item failed");
+            });
+            failTest("parallel_foreach(): exception was not propagated.");
+        }
+        catch(std::runtime_error &)
+        {}
+    }
+
+    void testParallelForeachBlock()
+    {
+        Shape3 shape(30, 20, 11);
+        MultiArray<3, int> visits(shape);
+        ThreadPool pool(4);
+
+        parallel_foreach_block(pool, shape, Shape3(8, 7, 0),
+            [&](int, Shape3 const & begin, Shape3 const & end)
+            {
+                shouldEqual(end[2] - begin[2], 11);
+                visits.subarray(begin, end) += 1;
+            });
+        for(int k=0; k<visits.size(); ++k)
+            shouldEqual(visits[k], 1);
+
+        Shape3 start(3, 4, 5), stop(25, 15, 6);
+        parallel_foreach_block(ParallelOptions().numThreads(2), start, stop, Shape3(4),
+            [&](int, Shape3 const & begin, Shape3 const & end)
+            {
+                visits.subarray(begin, end) += 1;
+            });
+        shouldEqual(visits.sum<int>(), (int)(prod(shape) + prod(stop - start)));
+        shouldEqual(visits.subarray(start, stop).sum<int>(), (int)(2*prod(stop - start)));
+    }
+};
+
+struct ThreadPoolTestSuite
+: public vigra::test_suite
+{
+    ThreadPoolTestSuite()
+    : vigra::test_suite("ThreadPoolTestSuite")
+    {
+        add( testCase( &ThreadPoolTest::testParallelOptions));
+        add( testCase( &ThreadPoolTest::testEnqueue));
+        add( testCase( &ThreadPoolTest::testNoThreads));
+        add( testCase( &ThreadPoolTest::testParallelForeach));
+        add( testCase( &ThreadPoolTest::testParallelForeachBlock));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ThreadPoolTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -39,6 +39,9 @@
 #include "unittest.hxx"
 
 #include "vigra/labelvolume.hxx"
+#include "vigra/blockwise_labeling.hxx"
+#include "vigra/random.hxx"
+#include <map>
 
 using namespace vigra;
 
@@ -383,6 +386,124 @@ struct VolumeLabelingTest
 
     }
 
+    void labelingThinVolumeTest()
+    {
+        // volumes of width or height 1 must not access voxels outside the volume
+        static const int in[] = { 0, 1, 0, 1 }, out[] = { 1, 2, 3, 4 };
+        IntVolume res(IntVolume::difference_type(1, 1, 4));
+        for(int k = 0; k < 3; ++k)
+        {
+            IntVolume::difference_type shape(1, 1, 1);
+            shape[k] = 4;
+            IntVolume vol(shape, in);
+            res.reshape(shape);
+            should(4 == labelVolume(srcMultiArrayRange(vol), destMultiArray(res), NeighborCode3DTwentySix()));
+            shouldEqualSequence(res.begin(), res.end(), out);
+            should(4 == labelVolumeSix(srcMultiArrayRange(vol), destMultiArray(res)));
+            shouldEqualSequence(res.begin(), res.end(), out);
+        }
+    }
+
+    // check that both labelings define the same partition
+    template <class Array1, class Array2>
+    void checkSamePartition(Array1 const & l1, Array2 const & l2, unsigned int count)
+    {
+        std::map<int, int> m1, m2;
+        for(int k = 0; k < l1.size(); ++k)
+        {
+            should(l1[k] >= 1 && (unsigned int)l1[k] <= count);
+            if(m1.find(l1[k]) == m1.end())
+                m1[l1[k]] = l2[k];
+            if(m2.find(l2[k]) == m2.end())
+                m2[l2[k]] = l1[k];
+            shouldEqual(m1[l1[k]], l2[k]);
+            shouldEqual(m2[l2[k]], l1[k]);
+        }
+        shouldEqual(m1.size(), count);
+    }
+
+    template <class Neighborhood>
+    void labelingBlockwiseTestImpl(Neighborhood neighborhood)
+    {
+        typedef IntVolume::difference_type Shape;
+        IntVolume data(Shape(37, 29, 23)), ref(data.shape()), res(data.shape());
+        RandomMT19937 random(42);
+        for(int k = 0; k < data.size(); ++k)
+            data[k] = random.uniformInt(3);
+
+        unsigned int count = labelVolume(srcMultiArrayRange(data), destMultiArray(ref), neighborhood);
+        should(count > 10);
+
+        shouldEqual(count, labelVolumeBlockwise(data, res, neighborhood, Shape(8), 
+                                                ParallelOptions().numThreads(4)));
+        checkSamePartition(ref, res, count);
+
+        res.init(0);
+        shouldEqual(count, labelVolumeBlockwise(data, res, neighborhood, std::equal_to<int>(), 
+                                                Shape(5, 7, 3), ParallelOptions().numThreads(ParallelOptions::NoThreads)));
+        checkSamePartition(ref, res, count);
+
+        // a single block gives the same result as labelVolume()
+        shouldEqual(count, labelVolumeBlockwise(data, res, neighborhood, Shape(100)));
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        // chunked arrays
+        ChunkedArrayTmpFile<3, int> chunkedData(data.shape(), Shape(10, 9, 8)),
+                                    chunkedRes(data.shape(), Shape(10, 9, 8), 
+                                               ChunkedArrayOptions().cacheMax(4));
+        chunkedData.commitSubarray(Shape(), data);
+        shouldEqual(count, labelVolumeBlockwise(chunkedData, chunkedRes, neighborhood, 
+                                                ParallelOptions().numThreads(4)));
+        chunkedRes.checkoutSubarray(Shape(), res);
+        checkSamePartition(ref, res, count);
+    }
+
+    void labelingBlockwiseTest()
+    {
+        labelingBlockwiseTestImpl(NeighborCode3DSix());
+        labelingBlockwiseTestImpl(NeighborCode3DTwentySix());
+    }
+
+    void concurrentUnionFindTest()
+    {
+        int size = 10000, unions = 8000;
+        MersenneTwister random(42);
+        ArrayVector<int> first(unions), second(unions);
+        for(int k=0; k<unions; ++k)
+        {
+            first[k]  = random.uniformInt(size);
+            second[k] = random.uniformInt(size);
+        }
+
+        detail::UnionFindArray<int> serial(size);
+        for(int k=0; k<unions; ++k)
+            serial.makeUnion(first[k], second[k]);
+        ArrayVector<int> roots(size), regions(size);
+        for(int k=0; k<size; ++k)
+            roots[k] = serial.find(k);
+        int maxRegion = serial.makeContiguous();
+        for(int k=0; k<size; ++k)
+            regions[k] = serial[k];
+
+        for(int round=0; round<5; ++round)
+        {
+            detail::ConcurrentUnionFindArray<int> concurrent(size);
+            shouldEqual(concurrent.size(), size);
+            parallel_foreach(ParallelOptions().numThreads(4), unions,
+                [&](int, std::ptrdiff_t k)
+                {
+                    concurrent.makeUnion(first[k], second[k]);
+                    concurrent.find(second[k]);
+                });
+            // unions link to the smaller index, so the roots must coincide
+            for(int k=0; k<size; ++k)
+                shouldEqual(concurrent.find(k), roots[k]);
+            shouldEqual(concurrent.makeContiguous(), maxRegion);
+            for(int k=0; k<size; ++k)
+                shouldEqual(concurrent[k], regions[k]);
+        }
+    }
+
     IntVolume vol1, vol2, vol3;
     DoubleVolume vol4, vol5, vol6;
 };
@@ -405,6 +526,9 @@ struct VolumeLabelingTestSuite
         add( testCase( &VolumeLabelingTest::labelingTwentySixTest3));
         add( testCase( &VolumeLabelingTest::labelingTwentySixWithBackgroundTest1));
         add( testCase( &VolumeLabelingTest::labelingAllTest));
+        add( testCase( &VolumeLabelingTest::labelingThinVolumeTest));
+        add( testCase( &VolumeLabelingTest::labelingBlockwiseTest));
+        add( testCase( &VolumeLabelingTest::concurrentUnionFindTest));
     }
 };
 
@@ -39,9 +39,12 @@
 #include "unittest.hxx"
 
 #include "vigra/watersheds3d.hxx"
+#include "vigra/blockwise_watersheds.hxx"
 #include "vigra/multi_array.hxx"
+#include "vigra/random.hxx"
 #include "list"
 
+#include <map>
 #include <stdlib.h>
 #include <time.h>
 
@@ -457,6 +460,73 @@ struct Watersheds3dTest
     }
 
 
+    template <class Array1, class Array2>
+    void checkSamePartition(Array1 const & l1, Array2 const & l2, unsigned int count)
+    {
+        std::map<int, int> m1, m2;
+        for(int k = 0; k < l1.size(); ++k)
+        {
+            should(l1[k] >= 1 && (unsigned int)l1[k] <= count);
+            if(m1.find(l1[k]) == m1.end())
+                m1[l1[k]] = l2[k];
+            if(m2.find(l2[k]) == m2.end())
+                m2[l2[k]] = l1[k];
+            shouldEqual(m1[l1[k]], l2[k]);
+            shouldEqual(m2[l2[k]], l1[k]);
+        }
+        shouldEqual(m1.size(), count);
+    }
+
+    template <class Neighborhood>
+    void testWatersheds3dBlockwiseImpl(Neighborhood neighborhood, int levels)
+    {
+        typedef IntVolume::difference_type Shape;
+        MultiArray<3, float> data(Shape(37, 29, 23));
+        IntVolume ref(data.shape()), res(data.shape()), res2(data.shape());
+        RandomMT19937 random(42);
+        for(int k = 0; k < data.size(); ++k)
+            data[k] = (levels == 0)
+                          ? (float)random.uniform()
+                          : (float)random.uniformInt(levels);
+
+        unsigned int count = watersheds3D(srcMultiArrayRange(data), destMultiArray(ref), neighborhood);
+        should(count > 10);
+
+        shouldEqual(count, watersheds3DBlockwise(data, res, neighborhood, Shape(8), 
+                                                 ParallelOptions().numThreads(4)));
+        checkSamePartition(ref, res, count);
+
+        // the labels don't depend on the number of threads
+        shouldEqual(count, watersheds3DBlockwise(data, res2, neighborhood, Shape(8), 
+                                                 ParallelOptions().numThreads(ParallelOptions::NoThreads)));
+        shouldEqualSequence(res.begin(), res.end(), res2.begin());
+
+        shouldEqual(count, watersheds3DBlockwise(data, res, neighborhood, Shape(5, 7, 3)));
+        checkSamePartition(ref, res, count);
+
+        // a single block gives the same result as watersheds3D()
+        shouldEqual(count, watersheds3DBlockwise(data, res, neighborhood, Shape(100)));
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+        // chunked arrays
+        ChunkedArrayTmpFile<3, float> chunkedData(data.shape(), Shape(10, 9, 8));
+        ChunkedArrayTmpFile<3, int>   chunkedRes(data.shape(), Shape(10, 9, 8), 
+                                                 ChunkedArrayOptions().cacheMax(4));
+        chunkedData.commitSubarray(Shape(), data);
+        shouldEqual(count, watersheds3DBlockwise(chunkedData, chunkedRes, neighborhood, 
+                                                 ParallelOptions().numThreads(4)));
+        chunkedRes.checkoutSubarray(Shape(), res);
+        checkSamePartition(ref, res, count);
+    }
+
+    void testWatersheds3dBlockwise()
+    {
+        // without and with plateaus
+        testWatersheds3dBlockwiseImpl(NeighborCode3DSix(), 0);
+        testWatersheds3dBlockwiseImpl(NeighborCode3DTwentySix(), 0);
+        testWatersheds3dBlockwiseImpl(NeighborCode3DSix(), 4);
+        testWatersheds3dBlockwiseImpl(NeighborCode3DTwentySix(), 4);
+    }
 };
 
 
@@ -472,6 +542,7 @@ struct SimpleAnalysisTestSuite
         add( testCase( &Watersheds3dTest::testWatersheds3dSix2));
         add( testCase( &Watersheds3dTest::testWatersheds3dGradient1));
         add( testCase( &Watersheds3dTest::testWatersheds3dGradient2));
+        add( testCase( &Watersheds3dTest::testWatersheds3dBlockwise));
     }
 };
 
@@ -129,6 +129,7 @@ standardArrayType = arraytypes.VigraArray
 defaultAxistags = arraytypes.VigraArray.defaultAxistags
 
 from impex import readImage, readVolume
+from vigranumpycore import setNumThreads, getNumThreads
 
 def readHDF5(filenameOrGroup, pathInFile, order=None):
     '''Read an array from an HDF5 file.
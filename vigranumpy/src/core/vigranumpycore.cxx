@@ -44,6 +44,7 @@
 #include <vigra/functorexpression.hxx>
 #include <vigra/mathutil.hxx>
 #include <vigra/utilities.hxx>
+#include <vigra/threadpool.hxx>
 #include <vector>
 
 namespace python = boost::python;
@@ -56,6 +57,16 @@ UInt32 pychecksum(python::str const & s)
     return checksum(PyString_AsString(s.ptr()), size);
 }
 
+void pySetNumThreads(int n)
+{
+    ParallelOptions::setDefaultNumThreads(n);
+}
+
+int pyGetNumThreads()
+{
+    return ParallelOptions::defaultNumThreads();
+}
+
 void registerNumpyArrayConverters();
 void defineAxisTags();
 
@@ -71,4 +82,11 @@ BOOST_PYTHON_MODULE_INIT(vigranumpycore)
     defineAxisTags();
     
     def("checksum", &pychecksum, args("data"));
+    
+    def("setNumThreads", &pySetNumThreads, args("n"),
+        "Set the default number of threads used by VIGRA's parallel algorithms.\n"
+        "Pass -1 to use the number of hardware threads (the initial setting),\n"
+        "-2 to use half of them, and 0 to switch multi-threading off.\n");
+    def("getNumThreads", &pyGetNumThreads,
+        "Get the default number of threads used by VIGRA's parallel algorithms.\n");
 }